@@ -58,6 +58,52 @@ public sealed class PathfinderNativeIntegrationTests
         Assert.Equal(goals[1].Target.RoomName, result.Path[^1].RoomName);
     }
 
+    [Fact]
+    public async Task PortalSearch_CrossesPortalUntilItExpires()
+    {
+        if (!NativeAvailable)
+            Assert.Skip("Native pathfinder unavailable on this platform.");
+
+        var service = CreateService();
+        var token = TestContext.Current.CancellationToken;
+        await service.InitializeAsync([ColumnRoomTerrain("W0N0", 0), ColumnRoomTerrain("W0N1", 1), ColumnRoomTerrain("W0N2", 2)], token);
+        Assert.True(IsNativeReady(service), "Native pathfinder should be active for portal test.");
+
+        var origin = new RoomPosition(12, 25, "W0N0");
+        PathfinderGoal[] goals = [new(new RoomPosition(12, 25, "W0N2"))];
+        var options = new PathfinderOptions(MaxRooms: 16, MaxOps: 100_000, HeuristicWeight: 1.0);
+        var expiring = new PathfinderPortal(new RoomPosition(10, 25, "W0N0"), new RoomPosition(10, 25, "W0N2"), ExpiresTick: 50);
+        var permanent = new PathfinderPortal(new RoomPosition(40, 25, "W0N0"), new RoomPosition(40, 25, "W0N2"));
+
+        var walking = PathfinderNative.Search(origin, goals, options);
+        Assert.False(walking.Incomplete);
+        Assert.Equal(100, walking.Cost);
+
+        try {
+            PathfinderNative.LoadPortals([expiring, permanent]);
+            var crossing = PathfinderNative.Search(origin, goals, options);
+            Assert.False(crossing.Incomplete);
+            Assert.Equal(goals[0].Target, crossing.Path[0]);
+            Assert.Equal(4, crossing.Cost);
+            Assert.Equal(1, CountHops(origin, crossing.Path, expiring));
+            Assert.Equal(0, CountHops(origin, crossing.Path, permanent));
+
+            PathfinderNative.ExpirePortals(50);
+            var afterExpiry = PathfinderNative.Search(origin, goals, options);
+            Assert.False(afterExpiry.Incomplete);
+            Assert.Equal(goals[0].Target, afterExpiry.Path[0]);
+            Assert.Equal(0, CountHops(origin, afterExpiry.Path, expiring));
+            Assert.Equal(1, CountHops(origin, afterExpiry.Path, permanent));
+            Assert.Equal(56, afterExpiry.Cost);
+        }
+        finally {
+            PathfinderNative.LoadPortals([]);
+        }
+
+        var cleared = PathfinderNative.Search(origin, goals, options);
+        Assert.Equal(walking.Cost, cleared.Cost);
+    }
+
     [Theory]
     [MemberData(nameof(RegressionCaseData))]
     public async Task NativePathfinderMatchesRecordedBaseline(string caseName)
@@ -92,6 +138,28 @@ public sealed class PathfinderNativeIntegrationTests
     private static TerrainRoomData PlainTerrain(string roomName)
         => CreateTerrain(roomName, _ => _ => false);
 
+    // Plain room in a north-south column of three, walled off from everything but its column neighbours
+    private static TerrainRoomData ColumnRoomTerrain(string roomName, int indexFromSouth)
+        => CreateTerrain(
+            roomName,
+            y => x => x is 0 or 49 || (y == 49 && indexFromSouth == 0) || (y == 0 && indexFromSouth == 2));
+
+    // Counts the steps of a path (stored end first) that jump from the portal's source straight to its
+    // destination
+    private static int CountHops(RoomPosition origin, IReadOnlyList<RoomPosition> path, PathfinderPortal portal)
+    {
+        var hops = 0;
+        var previous = origin;
+        for (var i = path.Count - 1; i >= 0; i--) {
+            var step = path[i];
+            if (previous == portal.Source && step == portal.Destination)
+                hops++;
+            previous = step;
+        }
+
+        return hops;
+    }
+
     private static TerrainRoomData ColumnWallTerrain(string roomName, int columnX, int gapStartY, int gapLength)
         => CreateTerrain(
             roomName,
@@ -13,6 +13,8 @@ public sealed record RoomPosition(int X, int Y, string RoomName);
 
 public sealed record PathfinderGoal(RoomPosition Target, int? Range = null);
 
+public sealed record PathfinderPortal(RoomPosition Source, RoomPosition Destination, int ExpiresTick = 0);
+
 public sealed record PathfinderOptions(
     bool Flee = false,
     int MaxRooms = 1,
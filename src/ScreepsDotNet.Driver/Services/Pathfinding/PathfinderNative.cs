@@ -9,6 +9,7 @@ internal static class PathfinderNative
 {
     private const string LibraryBaseName = "libscreepspathfinder";
     private const int CostMatrixSize = 2500;
+    private const int MaxSearchRooms = 1024; // screeps::k_max_rooms
 
     private static readonly Lock SyncRoot = new();
     private static bool _loadAttempted;
@@ -19,6 +20,10 @@ internal static class PathfinderNative
     private static SearchDelegate? _search;
     private static FreeResultDelegate? _freeResult;
     private static SetRoomCallbackDelegate? _setRoomCallback;
+    private static LoadPortalsDelegate? _loadPortals;
+    private static ExpirePortalsDelegate? _expirePortals;
+    // A null world handle addresses the native library's default world
+    private static readonly IntPtr DefaultWorld = IntPtr.Zero;
 
     private static readonly RoomCallbackNative RoomCallbackThunk = HandleRoomCallback;
     private static readonly AsyncLocal<RoomCallbackContext?> RoomCallbackState = new();
@@ -50,9 +55,11 @@ internal static class PathfinderNative
                     _search = GetDelegate<SearchDelegate>(handle, "ScreepsPathfinder_Search");
                     _freeResult = GetDelegate<FreeResultDelegate>(handle, "ScreepsPathfinder_FreeResult");
                     _setRoomCallback = GetDelegate<SetRoomCallbackDelegate>(handle, "ScreepsPathfinder_SetRoomCallback");
+                    _loadPortals = GetDelegate<LoadPortalsDelegate>(handle, "ScreepsPathfinder_LoadPortals");
+                    _expirePortals = GetDelegate<ExpirePortalsDelegate>(handle, "ScreepsPathfinder_ExpirePortals");
                     _available = _loadTerrain is not null && _search is not null && _freeResult is not null;
                     if (_available) {
-                        _setRoomCallback?.Invoke(RoomCallbackThunk, IntPtr.Zero);
+                        _setRoomCallback?.Invoke(DefaultWorld, RoomCallbackThunk, IntPtr.Zero);
                         logger?.LogInformation("Loaded native pathfinder library from {Path}.", candidate);
                         return true;
                     }
@@ -106,7 +113,7 @@ internal static class PathfinderNative
                 Array.Resize(ref terrainRooms, populated);
 
             using var pinnedRooms = new PinnedArray<ScreepsTerrainRoom>(terrainRooms);
-            var result = _loadTerrain(pinnedRooms.Pointer, terrainRooms.Length);
+            var result = _loadTerrain(DefaultWorld, pinnedRooms.Pointer, terrainRooms.Length);
             if (result != 0)
                 throw new InvalidOperationException($"Native terrain load failed with error code {result}.");
         }
@@ -118,6 +125,40 @@ internal static class PathfinderNative
         }
     }
 
+    // Replaces the portal table; an empty list clears it. Portals with ExpiresTick 0 never expire.
+    public static void LoadPortals(IReadOnlyList<PathfinderPortal> portals)
+    {
+        if (!_available || _loadPortals is null)
+            throw new InvalidOperationException("Native pathfinder is not initialized.");
+
+        ArgumentNullException.ThrowIfNull(portals);
+        var nativePortals = new ScreepsPortalNative[portals.Count];
+        for (var i = 0; i < portals.Count; i++) {
+            var portal = portals[i] ?? throw new ArgumentException("Portal entries cannot be null.", nameof(portals));
+            nativePortals[i] = new ScreepsPortalNative
+            {
+                Source = new ScreepsPathfinderPoint { X = portal.Source.X, Y = portal.Source.Y, RoomName = portal.Source.RoomName },
+                Destination = new ScreepsPathfinderPoint { X = portal.Destination.X, Y = portal.Destination.Y, RoomName = portal.Destination.RoomName },
+                ExpiresTick = portal.ExpiresTick
+            };
+        }
+
+        var result = _loadPortals(DefaultWorld, nativePortals, nativePortals.Length);
+        if (result != 0)
+            throw new InvalidOperationException($"Native portal load failed with error code {result}.");
+    }
+
+    // Drops the portals expiring at or before `tick`.
+    public static void ExpirePortals(int tick)
+    {
+        if (!_available || _expirePortals is null)
+            throw new InvalidOperationException("Native pathfinder is not initialized.");
+
+        var result = _expirePortals(DefaultWorld, tick);
+        if (result != 0)
+            throw new InvalidOperationException($"Native portal expiry failed with error code {result}.");
+    }
+
     public static PathfinderResult Search(RoomPosition origin, IReadOnlyList<PathfinderGoal> goals, PathfinderOptions options)
     {
         if (!_available || _search is null || _freeResult is null)
@@ -138,18 +179,19 @@ internal static class PathfinderNative
         var optionsNative = new ScreepsPathfinderOptionsNative
         {
             Flee = options.Flee,
-            MaxRooms = Math.Clamp(options.MaxRooms, 1, 64),
+            MaxRooms = Math.Clamp(options.MaxRooms, 1, MaxSearchRooms),
             MaxOps = Math.Max(options.MaxOps, 1),
             MaxCost = options.MaxCost is { } maxCost and > 0 ? maxCost : int.MaxValue,
             PlainCost = Math.Max(options.PlainCost, 1),
             SwampCost = Math.Max(options.SwampCost, 1),
-            HeuristicWeight = Math.Clamp(options.HeuristicWeight, 1.0, 9.0)
+            HeuristicWeight = Math.Clamp(options.HeuristicWeight, 1.0, 9.0),
+            SkipRoomCallback = options.RoomCallback is null
         };
 
         using var callbackScope = RoomCallbackScope.Enter(options.RoomCallback);
         using var goalBuffer = ConvertGoals(goals);
         var nativeResult = new ScreepsPathfinderResultNative();
-        var code = _search(ref nativeOrigin, goalBuffer.Pointer, goalBuffer.Count, ref optionsNative, ref nativeResult);
+        var code = _search(DefaultWorld, ref nativeOrigin, goalBuffer.Pointer, goalBuffer.Count, ref optionsNative, ref nativeResult);
         if (code != 0)
             throw new InvalidOperationException($"Native pathfinder search failed with error code {code}.");
 
@@ -158,7 +200,7 @@ internal static class PathfinderNative
             return new PathfinderResult(path, nativeResult.Operations, nativeResult.Cost, nativeResult.Incomplete);
         }
         finally {
-            _freeResult(ref nativeResult);
+            _freeResult(DefaultWorld, ref nativeResult);
         }
     }
 
@@ -300,10 +342,11 @@ internal static class PathfinderNative
     }
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    private delegate int LoadTerrainDelegate(IntPtr rooms, int count);
+    private delegate int LoadTerrainDelegate(IntPtr world, IntPtr rooms, int count);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     private delegate int SearchDelegate(
+        IntPtr world,
         ref ScreepsPathfinderPoint origin,
         IntPtr goals,
         int goalCount,
@@ -311,10 +354,16 @@ internal static class PathfinderNative
         ref ScreepsPathfinderResultNative result);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    private delegate void FreeResultDelegate(ref ScreepsPathfinderResultNative result);
+    private delegate void FreeResultDelegate(IntPtr world, ref ScreepsPathfinderResultNative result);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
-    private delegate void SetRoomCallbackDelegate(RoomCallbackNative? callback, IntPtr userData);
+    private delegate void SetRoomCallbackDelegate(IntPtr world, RoomCallbackNative? callback, IntPtr userData);
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private delegate int LoadPortalsDelegate(IntPtr world, [In] ScreepsPortalNative[] portals, int count);
+
+    [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+    private delegate int ExpirePortalsDelegate(IntPtr world, int tick);
 
     [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
     private delegate bool RoomCallbackNative(
@@ -342,6 +391,14 @@ internal static class PathfinderNative
         public string RoomName;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ScreepsPortalNative
+    {
+        public ScreepsPathfinderPoint Source;
+        public ScreepsPathfinderPoint Destination;
+        public int ExpiresTick;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     private struct ScreepsPathfinderGoal
     {
@@ -362,6 +419,16 @@ internal static class PathfinderNative
         public int PlainCost;
         public int SwampCost;
         public double HeuristicWeight;
+        [MarshalAs(UnmanagedType.I1)]
+        public bool SkipRoomCallback;
+        [MarshalAs(UnmanagedType.I1)]
+        public bool WaypointsOnly;
+        [MarshalAs(UnmanagedType.I1)]
+        public bool IgnoreCreeps;
+        public int ParallelThreads;
+        [MarshalAs(UnmanagedType.I1)]
+        public bool LearnHeuristic;
+        public int HeuristicVersion;
     }
 
     [StructLayout(LayoutKind.Sequential)]
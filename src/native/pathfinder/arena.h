@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// Bump allocator for search- and tick-scoped memory. Allocations are never freed individually;
+	// reset() rewinds every chunk at once and keeps them, so once an arena has grown to its
+	// working-set size it stops touching the global allocator.
+	class arena_t {
+		private:
+			struct chunk_t {
+				std::unique_ptr<uint8_t[]> memory;
+				size_t size;
+			};
+			static constexpr size_t k_default_chunk_size = 64 * 1024;
+			std::vector<chunk_t> chunks;
+			size_t current = 0; // chunk being bumped
+			size_t offset = 0; // first free byte in chunks[current]
+			size_t chunk_size;
+
+		public:
+			explicit arena_t(size_t chunk_size = k_default_chunk_size) : chunk_size(chunk_size) {}
+
+			arena_t(const arena_t&) = delete;
+			arena_t& operator=(const arena_t&) = delete;
+
+			void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+				while (current < chunks.size()) {
+					uintptr_t base = reinterpret_cast<uintptr_t>(chunks[current].memory.get());
+					size_t aligned = (base + offset + alignment - 1) / alignment * alignment - base;
+					if (aligned + bytes <= chunks[current].size) {
+						offset = aligned + bytes;
+						return chunks[current].memory.get() + aligned;
+					}
+					++current;
+					offset = 0;
+				}
+				size_t size = std::max(chunk_size, bytes + alignment);
+				chunks.push_back(chunk_t{std::make_unique<uint8_t[]>(size), size});
+				current = chunks.size() - 1;
+				offset = 0;
+				return allocate(bytes, alignment);
+			}
+
+			template <class type_t>
+			type_t* allocate_array(size_t count) {
+				return static_cast<type_t*>(allocate(sizeof(type_t) * count, alignof(type_t)));
+			}
+
+			// Position of the next allocation; rewind() to it drops everything allocated since
+			struct mark_t {
+				size_t chunk;
+				size_t offset;
+			};
+
+			mark_t mark() const {
+				return mark_t{current, offset};
+			}
+
+			void rewind(mark_t position) {
+				current = position.chunk;
+				offset = position.offset;
+			}
+
+			// Invalidates every allocation made since the last reset; chunks are kept for reuse
+			void reset() {
+				current = 0;
+				offset = 0;
+			}
+
+			// Returns every chunk to the global allocator
+			void release() {
+				chunks.clear();
+				chunks.shrink_to_fit();
+				reset();
+			}
+
+			bool owns(const void* pointer) const {
+				auto address = static_cast<const uint8_t*>(pointer);
+				for (const chunk_t& chunk : chunks) {
+					if (address >= chunk.memory.get() && address < chunk.memory.get() + chunk.size) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			size_t reserved_bytes() const {
+				size_t total = 0;
+				for (const chunk_t& chunk : chunks) {
+					total += chunk.size;
+				}
+				return total;
+			}
+	};
+}
@@ -0,0 +1,2213 @@
+// Micro-benchmarks for the native pathfinder. Worlds are generated deterministically so runs are
+// comparable across commits:
+//
+//   pathfinder_bench [scenario ...] [--iterations N] [--seed N] [--trace FILE]
+//
+// Without arguments every scenario runs once with the default iteration count. With --trace, a build
+// configured with SCREEPS_PATHFINDER_TRACE writes the expansion trace of the last search to FILE for
+// scripts/render-trace-heatmap.js. Scenarios that check their results against a reference count what
+// disagreed; the exit status is 1 when any of them did.
+#include "cooperative.h"
+#include "cost_matrix_builder.h"
+#include "cost_matrix_registry.h"
+#include "min_cut.h"
+#include "parallel_search.h"
+#include "path_validation.h"
+#include "pathfinder_exports.h"
+#include "pf.h"
+#include "precompute_cache.h"
+#include "room_analysis.h"
+#include "room_route.h"
+#include "search_queue.h"
+#include "terrain_pack.h"
+#include "terrain_query.h"
+#include "threat_map.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace screeps;
+
+namespace {
+
+	constexpr uint8_t k_world_origin = 120;
+
+	//
+	// Deterministic synthetic world: a square block of rooms with mixed terrain styles, loaded into `target`
+	class bench_world_t {
+		public:
+			bench_world_t(int size, uint32_t seed, world_t& target = world_t::default_world()) : size_(size), rng_(seed) {
+				for (int rx = 0; rx < size; ++rx) {
+					for (int ry = 0; ry < size; ++ry) {
+						rooms_.push_back(generate_room(rx, ry));
+					}
+				}
+				std::vector<terrain_room_plain> plain;
+				for (int rx = 0; rx < size; ++rx) {
+					for (int ry = 0; ry < size; ++ry) {
+						const auto& bits = rooms_[rx * size + ry];
+						plain.push_back(terrain_room_plain{
+							static_cast<uint8_t>(k_world_origin + rx),
+							static_cast<uint8_t>(k_world_origin + ry),
+							bits.data(),
+							bits.size()
+						});
+					}
+				}
+				target.load_terrain(plain.data(), plain.size());
+			}
+
+			int size() const {
+				return size_;
+			}
+
+			std::mt19937& rng() {
+				return rng_;
+			}
+
+			// Random walkable-looking position inside room (rx, ry) relative to the world origin
+			world_position_t random_pos(int rx, int ry) {
+				uint32_t xx = (k_world_origin + rx) * 50 + 2 + rng_() % 46;
+				uint32_t yy = (k_world_origin + ry) * 50 + 2 + rng_() % 46;
+				return world_position_t(xx, yy);
+			}
+
+		private:
+			int size_;
+			std::mt19937 rng_;
+			std::vector<std::vector<uint8_t>> rooms_;
+
+			std::vector<uint8_t> generate_room(int rx, int ry) {
+				uint8_t codes[2500];
+				int style = (rx * 7 + ry * 3) % 4;
+				for (int xx = 0; xx < 50; ++xx) {
+					for (int yy = 0; yy < 50; ++yy) {
+						int roll = rng_() % 100;
+						uint8_t code = 0;
+						if (style == 0) {
+							code = roll < 10 ? 1 : (roll < 20 ? 2 : 0);
+						} else if (style == 1) {
+							code = (xx % 8 == 4 && (yy + rx) % 13 != 0) ? 1 : (roll < 5 ? 2 : 0);
+						} else if (style == 2) {
+							code = roll < 30 ? 2 : (roll < 33 ? 1 : 0);
+						} else {
+							code = (yy % 10 == 5 && (xx + ry) % 17 > 2) ? 1 : 0;
+						}
+						if (xx == 0 || yy == 0 || xx == 49 || yy == 49) {
+							code = (xx + yy) % 9 < 3 ? 1 : 0;
+						}
+						// Seal the outside of the world so no search asks for terrain that was never loaded
+						if ((rx == 0 && xx == 0) || (ry == 0 && yy == 0) || (rx == size_ - 1 && xx == 49) || (ry == size_ - 1 && yy == 49)) {
+							code = 1;
+						}
+						codes[xx * 50 + yy] = code;
+					}
+				}
+				std::vector<uint8_t> bits(k_terrain_bytes, 0);
+				for (int ii = 0; ii < 2500; ++ii) {
+					bits[ii / 4] |= codes[ii] << (ii % 4 * 2);
+				}
+				return bits;
+			}
+	};
+
+	struct bench_totals_t {
+		uint64_t searches = 0;
+		uint64_t operations = 0;
+		uint64_t path_tiles = 0;
+		double seconds = 0;
+		// Results that disagreed with a reference or broke an invariant; any of them fails the run
+		uint64_t failures = 0;
+	};
+
+	struct scenario_t {
+		const char* name;
+		const char* description;
+		std::function<bench_totals_t(bench_world_t&, path_finder_t&, int)> run;
+	};
+
+	search_options_native default_options() {
+		return search_options_native{1, 5, 16, 20000, std::numeric_limits<uint32_t>::max(), false, 1.2};
+	}
+
+	template <class make_request_t>
+	bench_totals_t run_searches(path_finder_t& pf, int iterations, make_request_t make_request) {
+		bench_totals_t totals;
+		search_result_native result;
+		auto start = std::chrono::steady_clock::now();
+		for (int ii = 0; ii < iterations; ++ii) {
+			std::vector<goal_t> goals;
+			search_options_native options = default_options();
+			world_position_t origin = make_request(goals, options);
+			search_request_native request{origin, goals.data(), goals.size(), options};
+			pf.search_native(request, result);
+			++totals.searches;
+			totals.operations += result.operations;
+			totals.path_tiles += result.path.size();
+		}
+		totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return totals;
+	}
+
+	struct bench_request_t {
+		world_position_t origin;
+		std::vector<goal_t> goals;
+		search_options_native options;
+	};
+
+	bench_totals_t run_requests(path_finder_t& pf, const std::vector<bench_request_t>& requests) {
+		bench_totals_t totals;
+		search_result_native result;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& entry : requests) {
+			search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+			pf.search_native(request, result);
+			++totals.searches;
+			totals.operations += result.operations;
+			totals.path_tiles += result.path.size();
+		}
+		totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return totals;
+	}
+
+	// Sparse road overlay handed out for every room while a "+matrix" shape runs
+	uint8_t bench_cost_matrix[2500];
+
+	bool bench_room_callback(uint8_t, uint8_t, room_callback_result* result, void*) {
+		result->cost_matrix = bench_cost_matrix;
+		result->cost_matrix_length = sizeof(bench_cost_matrix);
+		result->block_room = false;
+		return true;
+	}
+
+	// Runs each request shape through the specialized kernel and through the most general one
+	bench_totals_t run_kernel_shapes(bench_world_t& world, path_finder_t& pf, int iterations) {
+		for (int ii = 0; ii < 2500; ++ii) {
+			bench_cost_matrix[ii] = ii % 50 == 25 || ii / 50 == 25 ? 1 : 0;
+		}
+		struct shape_t {
+			const char* name;
+			bool flee;
+			int goal_count;
+			double weight;
+			bool cost_matrix;
+		};
+		const shape_t shapes[] = {
+			{"seek/1/1.2", false, 1, 1.2, false},
+			{"seek/1/1.2+matrix", false, 1, 1.2, true},
+			{"seek/3/1.2", false, 3, 1.2, false},
+			{"seek/1/1.37", false, 1, 1.37, false},
+			{"flee/2/1.2", true, 2, 1.2, false},
+		};
+		bench_totals_t totals;
+		for (const shape_t& shape : shapes) {
+			std::vector<bench_request_t> requests;
+			for (int ii = 0; ii < iterations; ++ii) {
+				bench_request_t request{world_position_t::null(), {}, default_options()};
+				int rx = 1 + world.rng()() % (world.size() - 4);
+				int ry = 1 + world.rng()() % (world.size() - 4);
+				request.origin = world.random_pos(rx, ry);
+				for (int gg = 0; gg < shape.goal_count; ++gg) {
+					if (shape.flee) {
+						request.goals.emplace_back(world_position_t(request.origin.xx + 2 - gg * 4, request.origin.yy + 1), 10);
+					} else {
+						request.goals.emplace_back(world.random_pos(rx + world.rng()() % 3, ry + world.rng()() % 3), 1);
+					}
+				}
+				request.options.flee = shape.flee;
+				request.options.heuristic_weight = shape.weight;
+				request.options.max_rooms = 16;
+				requests.push_back(std::move(request));
+			}
+			// Alternate the two kernels and keep the best of three runs each to damp machine noise
+			world_t::default_world().set_room_callback(shape.cost_matrix ? bench_room_callback : nullptr, nullptr);
+			bench_totals_t generic, specialized;
+			for (int round = 0; round < 3; ++round) {
+				pf.set_kernel_specialization(false);
+				bench_totals_t run = run_requests(pf, requests);
+				if (round == 0 || run.seconds < generic.seconds) {
+					generic = run;
+				}
+				pf.set_kernel_specialization(true);
+				run = run_requests(pf, requests);
+				if (round == 0 || run.seconds < specialized.seconds) {
+					specialized = run;
+				}
+			}
+			std::printf("  %-18s generic %9.2f us  specialized %9.2f us  gain %5.1f%%  (%llu ops)\n",
+				shape.name,
+				generic.seconds * 1e6 / generic.searches,
+				specialized.seconds * 1e6 / specialized.searches,
+				(1 - specialized.seconds / generic.seconds) * 100,
+				static_cast<unsigned long long>(specialized.operations));
+			totals.searches += specialized.searches;
+			totals.operations += specialized.operations;
+			totals.path_tiles += specialized.path_tiles;
+			totals.seconds += specialized.seconds;
+		}
+		world_t::default_world().set_room_callback(nullptr, nullptr);
+		return totals;
+	}
+
+	// maxRooms 1 searches through the multi-room kernels vs the padded room grid, best of three runs
+	// each; every result must match
+	bench_totals_t run_room_grid(bench_world_t& world, path_finder_t& pf, int iterations) {
+		struct shape_t {
+			const char* name;
+			bool flee;
+			bool cost_matrix;
+		};
+		const shape_t shapes[] = {
+			{"seek", false, false},
+			{"seek+matrix", false, true},
+			{"flee", true, false},
+		};
+		bench_totals_t totals;
+		size_t mismatches = 0;
+		for (const shape_t& shape : shapes) {
+			std::vector<bench_request_t> requests;
+			for (int ii = 0; ii < iterations; ++ii) {
+				bench_request_t request{world_position_t::null(), {}, default_options()};
+				int rx = world.rng()() % world.size();
+				int ry = world.rng()() % world.size();
+				request.origin = world.random_pos(rx, ry);
+				if (shape.flee) {
+					request.goals.emplace_back(world_position_t(request.origin.xx + 2, request.origin.yy + 1), 10);
+				} else {
+					request.goals.emplace_back(world.random_pos(rx, ry), 1);
+				}
+				request.options.flee = shape.flee;
+				request.options.max_rooms = 1;
+				requests.push_back(std::move(request));
+			}
+			world_t::default_world().set_room_callback(shape.cost_matrix ? bench_room_callback : nullptr, nullptr);
+			bench_totals_t general, grid;
+			for (int round = 0; round < 3; ++round) {
+				pf.set_room_grid(false);
+				bench_totals_t run = run_requests(pf, requests);
+				if (round == 0 || run.seconds < general.seconds) {
+					general = run;
+				}
+				pf.set_room_grid(true);
+				run = run_requests(pf, requests);
+				if (round == 0 || run.seconds < grid.seconds) {
+					grid = run;
+				}
+			}
+			search_result_native expected, actual;
+			for (const bench_request_t& entry : requests) {
+				search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+				pf.set_room_grid(false);
+				pf.search_native(request, expected);
+				pf.set_room_grid(true);
+				pf.search_native(request, actual);
+				mismatches += expected.cost != actual.cost || expected.operations != actual.operations || expected.path.size() != actual.path.size() ||
+					!std::equal(expected.path.begin(), expected.path.end(), actual.path.begin(), [](world_position_t left, world_position_t right) {
+						return left.id == right.id;
+					});
+			}
+			std::printf("  %-18s general %9.2f us  grid %9.2f us  gain %5.1f%%  (%llu ops)\n",
+				shape.name,
+				general.seconds * 1e6 / general.searches,
+				grid.seconds * 1e6 / grid.searches,
+				(1 - grid.seconds / general.seconds) * 100,
+				static_cast<unsigned long long>(grid.operations));
+			totals.searches += grid.searches;
+			totals.operations += grid.operations;
+			totals.path_tiles += grid.path_tiles;
+			totals.seconds += grid.seconds;
+		}
+		world_t::default_world().set_room_callback(nullptr, nullptr);
+		std::printf("  %zu mismatches\n", mismatches);
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Counts room callbacks so the corridor scenario can report how many rooms each search touched,
+	// and blocks the rooms in the context set like a callback avoiding hostile rooms would
+	uint64_t bench_callback_count = 0;
+
+	bool bench_counting_callback(uint8_t room_x, uint8_t room_y, room_callback_result* result, void* context) {
+		++bench_callback_count;
+		result->cost_matrix = nullptr;
+		result->cost_matrix_length = 0;
+		result->block_room = context != nullptr && static_cast<const room_set_t*>(context)->contains(map_position_t(room_x, room_y));
+		return true;
+	}
+
+	// Long searches with and without the room-route corridor limiting which rooms are loaded. A column
+	// of hostile rooms the callback blocks stands between origins and goals: the unrestricted search
+	// floods along the wall before it finds the way around, while the router plans the detour up front
+	// and the corridor keeps the search on it.
+	bench_totals_t run_corridor(bench_world_t& world, path_finder_t& pf, int iterations) {
+		const int wall_x = world.size() / 2;
+		const int wall_top = 4;
+		const int wall_bottom = 10;
+		room_set_t hostile;
+		for (int ry = wall_top; ry <= wall_bottom; ++ry) {
+			hostile.insert(map_position_t(k_world_origin + wall_x, k_world_origin + ry));
+		}
+		int runs = std::max(1, iterations / 10);
+		std::vector<bench_request_t> requests;
+		for (int ii = 0; ii < runs; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int ry = wall_top + 1 + world.rng()() % (wall_bottom - wall_top - 1);
+			request.origin = world.random_pos(wall_x - 1 - world.rng()() % 3, ry);
+			request.goals.emplace_back(world.random_pos(wall_x + 1 + world.rng()() % 3, ry), 1);
+			request.options.max_rooms = 64;
+			request.options.max_ops = 200000;
+			requests.push_back(std::move(request));
+		}
+
+		room_router_t router;
+		room_route_options_t route_options;
+		route_options.blocked = &hostile;
+		std::vector<room_set_t> corridors(requests.size());
+		std::vector<map_position_t> route;
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			if (router.find_route(world_t::default_world(), requests[ii].origin.map_position(), requests[ii].goals[0].pos.map_position(), route_options, route) == route_status::Success) {
+				room_router_t::build_corridor(route, 1, corridors[ii]);
+			}
+		}
+
+		world_t::default_world().set_room_callback(bench_counting_callback, &hostile);
+		bench_totals_t totals[2];
+		uint64_t callbacks[2] = { 0, 0 };
+		size_t incomplete[2] = { 0, 0 };
+		search_result_native result;
+		for (int with_corridor = 0; with_corridor < 2; ++with_corridor) {
+			bench_callback_count = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < requests.size(); ++ii) {
+				const auto& entry = requests[ii];
+				search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+				request.corridor = with_corridor ? &corridors[ii] : nullptr;
+				pf.search_native(request, result);
+				++totals[with_corridor].searches;
+				totals[with_corridor].operations += result.operations;
+				totals[with_corridor].path_tiles += result.path.size();
+				incomplete[with_corridor] += result.incomplete;
+			}
+			totals[with_corridor].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			callbacks[with_corridor] = bench_callback_count;
+		}
+		world_t::default_world().set_room_callback(nullptr, nullptr);
+		for (int with_corridor = 0; with_corridor < 2; ++with_corridor) {
+			std::printf("  %-18s %9.2f us/search %9.1f rooms/search %9llu ops %9llu tiles %5zu incomplete\n",
+				with_corridor ? "corridor (margin 1)" : "unrestricted",
+				totals[with_corridor].seconds * 1e6 / totals[with_corridor].searches,
+				double(callbacks[with_corridor]) / totals[with_corridor].searches,
+				static_cast<unsigned long long>(totals[with_corridor].operations),
+				static_cast<unsigned long long>(totals[with_corridor].path_tiles),
+				incomplete[with_corridor]);
+		}
+		return totals[1];
+	}
+
+	// The many-room workload run inline and then through the worker pool, submitted up front and
+	// drained in bulk the way the tick pipeline uses it
+	bench_totals_t run_async(bench_world_t& world, path_finder_t& pf, int iterations) {
+		std::vector<bench_request_t> requests;
+		for (int ii = 0; ii < iterations; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int span = world.size() - 6;
+			int rx = world.rng()() % span;
+			int ry = world.rng()() % span;
+			request.origin = world.random_pos(rx, ry);
+			request.goals.emplace_back(world.random_pos(rx + 3 + world.rng()() % 4, ry + world.rng()() % 4), 1);
+			request.options.max_rooms = 64;
+			request.options.max_ops = 100000;
+			requests.push_back(std::move(request));
+		}
+		bench_totals_t inline_totals = run_requests(pf, requests);
+
+		size_t worker_count = std::max(1u, std::thread::hardware_concurrency());
+		search_queue_t queue(world_t::default_world(), worker_count, requests.size());
+		bench_totals_t totals;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& entry : requests) {
+			queue.submit(entry.origin, entry.goals.data(), entry.goals.size(), entry.options, search_priority::Normal);
+		}
+		size_t received = 0;
+		while (received < requests.size()) {
+			received += queue.poll(requests.size() - received, std::chrono::milliseconds(100),
+				[&](search_ticket_t, bool, search_status, const search_result_native& result) {
+					++totals.searches;
+					totals.operations += result.operations;
+					totals.path_tiles += result.path.size();
+				});
+		}
+		totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::printf("  %-18s %9.2f us/search\n  %-18s %9.2f us/search  (%zu workers, speedup %.2fx)\n",
+			"inline",
+			inline_totals.seconds * 1e6 / inline_totals.searches,
+			"queued",
+			totals.seconds * 1e6 / totals.searches,
+			worker_count,
+			inline_totals.seconds / totals.seconds);
+		return totals;
+	}
+
+	// What FillResult does with a finished search: one ABI point per path entry, with its room name
+	// formatted the way the exports do
+	void convert_result(const std::vector<world_position_t>& path, std::unique_ptr<ScreepsPathfinderPoint[]>& points) {
+		points.reset(new ScreepsPathfinderPoint[path.size()]);
+		for (size_t ii = 0; ii < path.size(); ++ii) {
+			map_position_t room = path[ii].map_position();
+			points[ii].x = static_cast<int>(path[ii].xx % 50);
+			points[ii].y = static_cast<int>(path[ii].yy % 50);
+			std::snprintf(points[ii].roomName, sizeof(points[ii].roomName), "%c%d%c%d",
+				room.xx <= 127 ? 'W' : 'E', room.xx <= 127 ? 127 - room.xx : room.xx - 128,
+				room.yy <= 127 ? 'N' : 'S', room.yy <= 127 ? 127 - room.yy : room.yy - 128);
+		}
+	}
+
+	// Long searches returning full tile paths vs jump points only. The search itself costs the same
+	// either way, so result handling is timed apart from it: the conversion into ABI points (repeated
+	// to rise above timer noise) and the bytes handed across for marshalling. Then the cost of
+	// expanding the first steps from the origin on demand.
+	bench_totals_t run_waypoints(bench_world_t& world, path_finder_t& pf, int iterations) {
+		std::vector<bench_request_t> requests;
+		int runs = std::max(1, iterations / 10);
+		for (int ii = 0; ii < runs; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int span = world.size() - 8;
+			int rx = world.rng()() % span;
+			int ry = world.rng()() % span;
+			request.origin = world.random_pos(rx, ry);
+			request.goals.emplace_back(world.random_pos(rx + 6 + world.rng()() % 2, ry + 4 + world.rng()() % 4), 1);
+			request.options.max_rooms = 64;
+			request.options.max_ops = 200000;
+			requests.push_back(std::move(request));
+		}
+
+		const int conversion_repeats = 20;
+		bench_totals_t totals[2];
+		double convert_seconds[2] = {};
+		std::vector<std::vector<world_position_t>> paths[2];
+		search_result_native result;
+		for (int waypoints_only = 0; waypoints_only < 2; ++waypoints_only) {
+			for (auto& entry : requests) {
+				entry.options.waypoints_only = waypoints_only != 0;
+				search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+				auto start = std::chrono::steady_clock::now();
+				pf.search_native(request, result);
+				totals[waypoints_only].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				++totals[waypoints_only].searches;
+				totals[waypoints_only].operations += result.operations;
+				totals[waypoints_only].path_tiles += result.path.size();
+				paths[waypoints_only].push_back(result.path);
+			}
+			std::unique_ptr<ScreepsPathfinderPoint[]> points;
+			auto start = std::chrono::steady_clock::now();
+			for (int repeat = 0; repeat < conversion_repeats; ++repeat) {
+				for (const auto& path : paths[waypoints_only]) {
+					convert_result(path, points);
+				}
+			}
+			convert_seconds[waypoints_only] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / conversion_repeats;
+		}
+
+		double expand_seconds = 0;
+		world_position_t steps[5];
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			const std::vector<world_position_t>& path = paths[1][ii];
+			auto start = std::chrono::steady_clock::now();
+			// The next steps from the origin are the last tiles of the path
+			size_t tiles = path_expander_t::tile_count(world_t::default_world(), requests[ii].origin, path.data(), path.size());
+			path_expander_t expander(world_t::default_world(), requests[ii].origin, path.data(), path.size());
+			expander.seek(tiles > 5 ? tiles - 5 : 0);
+			expander.next(steps, 5);
+			expand_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		for (int waypoints_only = 0; waypoints_only < 2; ++waypoints_only) {
+			const bench_totals_t& run = totals[waypoints_only];
+			std::printf("  %-18s %9.2f us search %7.1f entries %8.0f result bytes %8.2f us conversion\n",
+				waypoints_only ? "waypoints only" : "full path",
+				run.seconds * 1e6 / run.searches,
+				double(run.path_tiles) / run.searches,
+				double(run.path_tiles) * sizeof(ScreepsPathfinderPoint) / run.searches,
+				convert_seconds[waypoints_only] * 1e6 / run.searches);
+		}
+		std::printf("  %-18s %.1fx fewer entries and bytes, %.1fx faster conversion, next 5 steps in %.2f us\n",
+			"",
+			double(totals[0].path_tiles) / std::max<uint64_t>(totals[1].path_tiles, 1),
+			convert_seconds[0] / std::max(convert_seconds[1], 1e-12),
+			expand_seconds * 1e6 / totals[1].searches);
+		return totals[1];
+	}
+
+	// Straightforward per-tile versions of the room analysis kernels, used as the baseline and to check
+	// that the bit-row kernels produce identical grids
+	void reference_distance_transform(const room_grid_t& grid, uint8_t* out) {
+		for (int xx = 0; xx < 50; ++xx) {
+			for (int yy = 0; yy < 50; ++yy) {
+				out[xx * 50 + yy] = grid.walkable(xx, yy) ? 255 : 0;
+			}
+		}
+		auto relax = [&](int xx, int yy, int nx, int ny) {
+			uint8_t neighbour = nx < 0 || ny < 0 || nx >= 50 || ny >= 50 ? 0 : out[nx * 50 + ny];
+			out[xx * 50 + yy] = std::min<int>(out[xx * 50 + yy], neighbour + 1);
+		};
+		for (int xx = 0; xx < 50; ++xx) {
+			for (int yy = 0; yy < 50; ++yy) {
+				relax(xx, yy, xx - 1, yy - 1);
+				relax(xx, yy, xx - 1, yy);
+				relax(xx, yy, xx - 1, yy + 1);
+				relax(xx, yy, xx, yy - 1);
+			}
+		}
+		for (int xx = 49; xx >= 0; --xx) {
+			for (int yy = 49; yy >= 0; --yy) {
+				relax(xx, yy, xx + 1, yy + 1);
+				relax(xx, yy, xx + 1, yy);
+				relax(xx, yy, xx + 1, yy - 1);
+				relax(xx, yy, xx, yy + 1);
+			}
+		}
+	}
+
+	void reference_flood_fill(const room_grid_t& grid, const room_tile_t* sources, size_t count, unsigned max_range, uint8_t* out) {
+		std::memset(out, 255, 2500);
+		std::vector<room_tile_t> queue(sources, sources + count);
+		for (size_t ii = 0; ii < count; ++ii) {
+			out[sources[ii].xx * 50 + sources[ii].yy] = 0;
+		}
+		for (size_t head = 0; head < queue.size(); ++head) {
+			room_tile_t tile = queue[head];
+			uint8_t distance = out[tile.xx * 50 + tile.yy];
+			if (distance >= max_range) {
+				continue;
+			}
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					int nx = tile.xx + dx;
+					int ny = tile.yy + dy;
+					if (nx < 0 || ny < 0 || nx >= 50 || ny >= 50 || !grid.walkable(nx, ny) || out[nx * 50 + ny] != 255) {
+						continue;
+					}
+					out[nx * 50 + ny] = distance + 1;
+					queue.push_back(room_tile_t{static_cast<uint8_t>(nx), static_cast<uint8_t>(ny)});
+				}
+			}
+		}
+	}
+
+	// Distance transform and a 3-source flood fill for every room of the world, bit-row kernels vs the
+	// per-tile references
+	bench_totals_t run_analysis(bench_world_t& world, path_finder_t&, int iterations) {
+		int rounds = std::max(1, iterations / 100);
+		std::vector<room_grid_t> grids(world.size() * world.size());
+		std::vector<std::array<room_tile_t, 3>> sources(grids.size());
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				room_grid_t& grid = grids[rx * world.size() + ry];
+				grid.load(world_t::default_world(), map_position_t(k_world_origin + rx, k_world_origin + ry), nullptr);
+				for (auto& source : sources[rx * world.size() + ry]) {
+					source = room_tile_t{static_cast<uint8_t>(5 + world.rng()() % 40), static_cast<uint8_t>(5 + world.rng()() % 40)};
+				}
+			}
+		}
+		uint8_t fast[2500];
+		uint8_t slow[2500];
+		size_t mismatches = 0;
+		double seconds[2][2] = {};
+		for (int round = 0; round < rounds; ++round) {
+			for (size_t ii = 0; ii < grids.size(); ++ii) {
+				auto start = std::chrono::steady_clock::now();
+				grids[ii].distance_transform(true, fast);
+				auto middle = std::chrono::steady_clock::now();
+				reference_distance_transform(grids[ii], slow);
+				auto end = std::chrono::steady_clock::now();
+				seconds[0][0] += std::chrono::duration<double>(middle - start).count();
+				seconds[0][1] += std::chrono::duration<double>(end - middle).count();
+				mismatches += std::memcmp(fast, slow, 2500) != 0;
+
+				start = std::chrono::steady_clock::now();
+				grids[ii].flood_fill(sources[ii].data(), sources[ii].size(), 30, fast);
+				middle = std::chrono::steady_clock::now();
+				reference_flood_fill(grids[ii], sources[ii].data(), sources[ii].size(), 30, slow);
+				end = std::chrono::steady_clock::now();
+				seconds[1][0] += std::chrono::duration<double>(middle - start).count();
+				seconds[1][1] += std::chrono::duration<double>(end - middle).count();
+				mismatches += std::memcmp(fast, slow, 2500) != 0;
+			}
+		}
+		size_t runs = grids.size() * rounds;
+		const char* names[2] = {"distance", "flood (30)"};
+		for (int kernel = 0; kernel < 2; ++kernel) {
+			std::printf("  %-18s bit rows %7.2f us/room  per-tile %7.2f us/room  (%.1fx)\n",
+				names[kernel],
+				seconds[kernel][0] * 1e6 / runs,
+				seconds[kernel][1] * 1e6 / runs,
+				seconds[kernel][1] / seconds[kernel][0]);
+		}
+		std::printf("  %-18s %zu grids differ from the reference\n", "", mismatches);
+		bench_totals_t totals;
+		totals.searches = runs * 2;
+		totals.seconds = seconds[0][0] + seconds[1][0];
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Edmonds-Karp on the same split-node graph as room_min_cut_t, one BFS augmenting path at a time;
+	// returns the cut cost or -1 when the protected tiles are open to an exit
+	int64_t reference_min_cut(const room_grid_t& grid, const std::vector<room_tile_t>& protected_tiles) {
+		struct edge_t {
+			int to;
+			int capacity;
+		};
+		const int source = 5000;
+		const int sink = 5001;
+		const int unbounded = 1 << 28;
+		std::vector<edge_t> edges;
+		std::vector<std::vector<int>> adjacent(5002);
+		auto add = [&](int from, int to, int capacity) {
+			adjacent[from].push_back(edges.size());
+			edges.push_back(edge_t{to, capacity});
+			adjacent[to].push_back(edges.size());
+			edges.push_back(edge_t{from, 0});
+		};
+		auto border = [](int xx, int yy) { return xx == 0 || yy == 0 || xx == 49 || yy == 49; };
+		std::vector<bool> fixed(2500);
+		for (int xx = 0; xx < 50; ++xx) {
+			for (int yy = 0; yy < 50; ++yy) {
+				if (!border(xx, yy) || !grid.walkable(xx, yy)) {
+					continue;
+				}
+				for (int nx = std::max(xx - 1, 0); nx <= std::min(xx + 1, 49); ++nx) {
+					for (int ny = std::max(yy - 1, 0); ny <= std::min(yy + 1, 49); ++ny) {
+						fixed[nx * 50 + ny] = true;
+					}
+				}
+			}
+		}
+		for (const room_tile_t& tile : protected_tiles) {
+			fixed[tile.xx * 50 + tile.yy] = true;
+			add(source, 2 * (tile.xx * 50 + tile.yy), unbounded);
+		}
+		for (int xx = 0; xx < 50; ++xx) {
+			for (int yy = 0; yy < 50; ++yy) {
+				if (!grid.walkable(xx, yy)) {
+					continue;
+				}
+				int tile = xx * 50 + yy;
+				add(2 * tile, 2 * tile + 1, fixed[tile] || border(xx, yy) ? unbounded : 1);
+				if (border(xx, yy)) {
+					add(2 * tile + 1, sink, unbounded);
+				}
+				for (int nx = std::max(xx - 1, 0); nx <= std::min(xx + 1, 49); ++nx) {
+					for (int ny = std::max(yy - 1, 0); ny <= std::min(yy + 1, 49); ++ny) {
+						if ((nx != xx || ny != yy) && grid.walkable(nx, ny)) {
+							add(2 * tile + 1, 2 * (nx * 50 + ny), unbounded);
+						}
+					}
+				}
+			}
+		}
+		int64_t flow = 0;
+		std::vector<int> via(5002);
+		while (flow < unbounded) {
+			std::fill(via.begin(), via.end(), -1);
+			std::vector<int> queue{source};
+			via[source] = -2;
+			for (size_t head = 0; head < queue.size() && via[sink] == -1; ++head) {
+				for (int ee : adjacent[queue[head]]) {
+					if (edges[ee].capacity > 0 && via[edges[ee].to] == -1) {
+						via[edges[ee].to] = ee;
+						queue.push_back(edges[ee].to);
+					}
+				}
+			}
+			if (via[sink] == -1) {
+				return flow;
+			}
+			int bottleneck = unbounded;
+			for (int node = sink; node != source; node = edges[via[node] ^ 1].to) {
+				bottleneck = std::min(bottleneck, edges[via[node]].capacity);
+			}
+			for (int node = sink; node != source; node = edges[via[node] ^ 1].to) {
+				edges[via[node]].capacity -= bottleneck;
+				edges[via[node] ^ 1].capacity += bottleneck;
+			}
+			flow += bottleneck;
+		}
+		return -1;
+	}
+
+	// Rampart line around a 7x7 base somewhere inside every room, Dinic vs Edmonds-Karp
+	bench_totals_t run_min_cut(bench_world_t& world, path_finder_t&, int iterations) {
+		int rounds = std::max(1, iterations / 1000);
+		room_min_cut_t solver;
+		std::vector<room_tile_t> cut;
+		bench_totals_t totals;
+		double reference_seconds = 0;
+		size_t mismatches = 0;
+		size_t open = 0;
+		uint64_t cut_tiles = 0;
+		for (int round = 0; round < rounds; ++round) {
+			for (int rx = 0; rx < world.size(); ++rx) {
+				for (int ry = 0; ry < world.size(); ++ry) {
+					map_position_t room(k_world_origin + rx, k_world_origin + ry);
+					room_grid_t grid;
+					grid.load(world_t::default_world(), room, nullptr);
+					int cx = 12 + world.rng()() % 26;
+					int cy = 12 + world.rng()() % 26;
+					std::vector<room_tile_t> base;
+					for (int xx = cx - 3; xx <= cx + 3; ++xx) {
+						for (int yy = cy - 3; yy <= cy + 3; ++yy) {
+							if (grid.walkable(xx, yy)) {
+								base.push_back(room_tile_t{static_cast<uint8_t>(xx), static_cast<uint8_t>(yy)});
+							}
+						}
+					}
+					if (base.empty()) {
+						continue;
+					}
+					uint32_t cost = 0;
+					auto start = std::chrono::steady_clock::now();
+					min_cut_status status = solver.solve(world_t::default_world(), room, nullptr, base.data(), base.size(), cut, &cost);
+					auto middle = std::chrono::steady_clock::now();
+					int64_t expected = reference_min_cut(grid, base);
+					auto end = std::chrono::steady_clock::now();
+					totals.seconds += std::chrono::duration<double>(middle - start).count();
+					reference_seconds += std::chrono::duration<double>(end - middle).count();
+					++totals.searches;
+					if (status == min_cut_status::NoCut) {
+						++open;
+						mismatches += expected != -1;
+						continue;
+					}
+					mismatches += expected != cost || cut.size() != cost;
+					cut_tiles += cut.size();
+				}
+			}
+		}
+		std::printf("  %-18s dinic %8.2f us/room  edmonds-karp %8.2f us/room  (%.1fx)\n",
+			"7x7 base",
+			totals.seconds * 1e6 / std::max<uint64_t>(totals.searches, 1),
+			reference_seconds * 1e6 / std::max<uint64_t>(totals.searches, 1),
+			reference_seconds / std::max(totals.seconds, 1e-9));
+		std::printf("  %-18s %.1f tiles/cut, %zu rooms open to an exit, %zu cuts differ from the reference\n",
+			"",
+			double(cut_tiles) / std::max<uint64_t>(totals.searches - open, 1),
+			open,
+			mismatches);
+		totals.path_tiles = cut_tiles;
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Cached paths from 2-4 room searches, re-priced in bulk after cost matrices block tiles in a
+	// quarter of the rooms, vs searching every path again
+	bench_totals_t run_validate(bench_world_t& world, path_finder_t& pf, int iterations) {
+		int path_count = std::max(1, iterations / 4);
+		std::vector<bench_request_t> requests;
+		std::vector<uint32_t> steps;
+		std::vector<uint32_t> offsets{0};
+		std::vector<cost_t> costs;
+		search_result_native result;
+		double search_seconds = 0;
+		while (int(requests.size()) < path_count) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int rx = world.rng()() % (world.size() - 4);
+			int ry = world.rng()() % (world.size() - 4);
+			request.origin = world.random_pos(rx, ry);
+			request.goals.emplace_back(world.random_pos(rx + 2 + world.rng()() % 3, ry + world.rng()() % 3), 1);
+			request.options.max_rooms = 16;
+			search_request_native native{request.origin, request.goals.data(), request.goals.size(), request.options};
+			auto start = std::chrono::steady_clock::now();
+			pf.search_native(native, result);
+			if (result.incomplete || result.path.empty()) {
+				continue;
+			}
+			search_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			// Search results run from the goal back; caches keep walking order
+			for (auto it = result.path.rbegin(); it != result.path.rend(); ++it) {
+				steps.push_back(uint32_t(it->xx) | uint32_t(it->yy) << 16);
+			}
+			offsets.push_back(steps.size());
+			costs.push_back(result.cost);
+			requests.push_back(std::move(request));
+		}
+
+		path_validator_t validator;
+		cost_matrix_registry_t matrices;
+		std::vector<path_check_t> checks(requests.size());
+		validator.validate(world_t::default_world(), steps.data(), offsets.data(), requests.size(), &matrices, 1, 5, checks.data());
+		size_t mismatches = 0;
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			mismatches += checks[ii].first_blocked != -1 || checks[ii].cost != costs[ii];
+		}
+
+		uint8_t matrix[2500];
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				if (world.rng()() % 4 != 0) {
+					continue;
+				}
+				for (int ii = 0; ii < 2500; ++ii) {
+					matrix[ii] = world.rng()() % 100 == 0 ? 255 : (world.rng()() % 10 == 0 ? 3 : 0);
+				}
+				matrices.set(map_position_t(k_world_origin + rx, k_world_origin + ry), matrix);
+			}
+		}
+		int rounds = 20;
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < rounds; ++round) {
+			validator.validate(world_t::default_world(), steps.data(), offsets.data(), requests.size(), &matrices, 1, 5, checks.data());
+		}
+		double validate_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / rounds;
+		size_t broken = std::count_if(checks.begin(), checks.end(), [](const path_check_t& check) { return check.first_blocked >= 0; });
+
+		std::printf("  %-18s %8.3f us/path (%.1f steps)  re-search %8.2f us/path  (%.0fx)\n  %-18s %zu of %zu paths blocked, %zu intact paths mispriced\n",
+			"validate",
+			validate_seconds * 1e6 / requests.size(),
+			double(steps.size()) / requests.size(),
+			search_seconds * 1e6 / requests.size(),
+			search_seconds / validate_seconds,
+			"",
+			broken,
+			requests.size(),
+			mismatches);
+		bench_totals_t totals;
+		totals.searches = requests.size();
+		totals.path_tiles = steps.size();
+		totals.seconds = validate_seconds;
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Vertex and swap collisions between the planned tiles of a batch, tick by tick
+	size_t count_collisions(const std::vector<cooperative_agent_t>& agents, const std::vector<room_tile_t>& steps, const std::vector<int>& counts, unsigned window) {
+		auto at = [&](size_t agent, unsigned tick) {
+			int used = std::max(counts[agent], 0);
+			if (tick == 0 || used == 0) {
+				return agents[agent].origin;
+			}
+			return steps[agent * window + std::min<unsigned>(tick, used) - 1];
+		};
+		auto same = [](room_tile_t left, room_tile_t right) {
+			return left.xx == right.xx && left.yy == right.yy;
+		};
+		size_t collisions = 0;
+		for (unsigned tick = 1; tick <= window; ++tick) {
+			for (size_t aa = 0; aa < agents.size(); ++aa) {
+				for (size_t bb = aa + 1; bb < agents.size(); ++bb) {
+					collisions += same(at(aa, tick), at(bb, tick)) || (same(at(aa, tick), at(bb, tick - 1)) && same(at(bb, tick), at(aa, tick - 1)));
+				}
+			}
+		}
+		return collisions;
+	}
+
+	// 24 creeps with crossing goals per room: planned one by one against an empty table (what
+	// independent searches amount to) vs one cooperative batch
+	bench_totals_t run_cooperative(bench_world_t& world, path_finder_t&, int iterations) {
+		const unsigned window = 16;
+		const size_t agent_count = 24;
+		int rounds = std::max(1, iterations / 200);
+		cooperative_planner_t planner;
+		reservation_table_t independent_table;
+		reservation_table_t cooperative_table;
+		cooperative_options_t options;
+		options.window = window;
+		options.plain_cost = 2;
+		options.swamp_cost = 10;
+		std::vector<cooperative_agent_t> agents;
+		std::vector<room_tile_t> steps(agent_count * window);
+		std::vector<int> counts(agent_count);
+		size_t collisions[2] = {};
+		size_t stuck = 0;
+		double seconds[2] = {};
+		uint64_t batches = 0;
+		uint32_t tick = 0;
+		for (int round = 0; round < rounds; ++round) {
+			for (int rx = 0; rx < world.size(); ++rx) {
+				for (int ry = 0; ry < world.size(); ++ry) {
+					map_position_t room(k_world_origin + rx, k_world_origin + ry);
+					room_grid_t grid;
+					grid.load(world_t::default_world(), room, nullptr);
+					agents.clear();
+					std::vector<bool> taken(2500);
+					while (agents.size() < agent_count) {
+						room_tile_t origin{static_cast<uint8_t>(15 + world.rng()() % 20), static_cast<uint8_t>(15 + world.rng()() % 20)};
+						room_tile_t goal{static_cast<uint8_t>(50 - 1 - origin.xx), static_cast<uint8_t>(50 - 1 - origin.yy)};
+						if (!grid.walkable(origin.xx, origin.yy) || !grid.walkable(goal.xx, goal.yy) || taken[origin.xx * 50 + origin.yy]) {
+							continue;
+						}
+						taken[origin.xx * 50 + origin.yy] = true;
+						agents.push_back(cooperative_agent_t{static_cast<uint32_t>(agents.size()), origin, goal, 0, 0});
+					}
+					tick += window + 1;
+
+					auto start = std::chrono::steady_clock::now();
+					for (size_t ii = 0; ii < agent_count; ++ii) {
+						independent_table.clear();
+						independent_table.advance(tick);
+						planner.plan(world_t::default_world(), room, nullptr, &agents[ii], 1, options, independent_table, &steps[ii * window], &counts[ii]);
+					}
+					auto middle = std::chrono::steady_clock::now();
+					collisions[0] += count_collisions(agents, steps, counts, window);
+
+					cooperative_table.advance(tick);
+					auto batch_start = std::chrono::steady_clock::now();
+					planner.plan(world_t::default_world(), room, nullptr, agents.data(), agents.size(), options, cooperative_table, steps.data(), counts.data());
+					auto end = std::chrono::steady_clock::now();
+					collisions[1] += count_collisions(agents, steps, counts, window);
+					stuck += std::count(counts.begin(), counts.end(), -1);
+					seconds[0] += std::chrono::duration<double>(middle - start).count();
+					seconds[1] += std::chrono::duration<double>(end - batch_start).count();
+					++batches;
+				}
+			}
+		}
+		std::printf("  %-18s %8.2f us/room  %6.2f collisions/room\n  %-18s %8.2f us/room  %6.2f collisions/room  %zu agents without a plan\n",
+			"independent",
+			seconds[0] * 1e6 / batches,
+			double(collisions[0]) / batches,
+			"cooperative",
+			seconds[1] * 1e6 / batches,
+			double(collisions[1]) / batches,
+			stuck);
+		bench_totals_t totals;
+		totals.searches = batches * agent_count;
+		totals.seconds = seconds[1];
+		totals.failures = collisions[1];
+		return totals;
+	}
+
+	// Layer-by-layer reference for the matrix builder: one pass per object kind in precedence order
+	void reference_matrix(const std::vector<room_object_t>& objects, const cost_matrix_profile_t& profile, uint8_t* out) {
+		std::memset(out, 0, cost_matrix_builder_t::k_matrix_bytes);
+		for (int kind = 0; kind <= static_cast<int>(room_object_kind::Creep); ++kind) {
+			for (const room_object_t& object : objects) {
+				if (static_cast<int>(object.kind) != kind) {
+					continue;
+				}
+				bool mine = object.flags & k_object_mine;
+				uint8_t value = 0;
+				switch (object.kind) {
+					case room_object_kind::Road: value = profile.road; break;
+					case room_object_kind::ConstructionSite: value = mine ? profile.own_site : profile.hostile_site; break;
+					case room_object_kind::Rampart: value = mine ? profile.own_rampart : profile.hostile_rampart; break;
+					case room_object_kind::Blocking: value = profile.blocking; break;
+					case room_object_kind::Creep: value = mine ? profile.own_creep : profile.hostile_creep; break;
+				}
+				uint8_t& tile = out[object.xx * 50 + object.yy];
+				if (value != 0 && tile != cost_matrix_builder_t::k_blocked) {
+					tile = value;
+				}
+			}
+		}
+	}
+
+	// A busy room's objects per tick: a road grid, ramparts, structures and sites that stay, and creeps
+	// that move every tick. Builds every matrix from scratch (per-kind passes and the builder's single
+	// pass), then reuses a static structure layer and scatters only the creeps.
+	bench_totals_t run_matrix_build(bench_world_t& world, path_finder_t&, int iterations) {
+		cost_matrix_profile_t profile;
+		profile.own_creep = 0;
+		std::vector<room_object_t> structures;
+		auto add = [&](std::vector<room_object_t>& list, room_object_kind kind, uint8_t flags) {
+			list.push_back(room_object_t{static_cast<uint8_t>(1 + world.rng()() % 48), static_cast<uint8_t>(1 + world.rng()() % 48), kind, flags});
+		};
+		for (uint8_t ii = 5; ii < 45; ++ii) {
+			structures.push_back(room_object_t{ii, 25, room_object_kind::Road, 0});
+			structures.push_back(room_object_t{25, ii, room_object_kind::Road, 0});
+		}
+		for (int ii = 0; ii < 60; ++ii) {
+			add(structures, room_object_kind::Blocking, 0);
+			add(structures, room_object_kind::Rampart, ii % 3 == 0 ? 0 : k_object_mine);
+		}
+		for (int ii = 0; ii < 10; ++ii) {
+			add(structures, room_object_kind::ConstructionSite, ii % 2 ? k_object_mine : 0);
+		}
+
+		int ticks = std::max(1, iterations);
+		std::vector<room_object_t> all;
+		std::vector<room_object_t> creeps;
+		std::vector<uint8_t> reference(cost_matrix_builder_t::k_matrix_bytes);
+		std::vector<uint8_t> built(cost_matrix_builder_t::k_matrix_bytes);
+		std::vector<uint8_t> layered(cost_matrix_builder_t::k_matrix_bytes);
+		std::vector<uint8_t> static_layer(cost_matrix_builder_t::k_matrix_bytes);
+		cost_matrix_builder_t::build(structures.data(), structures.size(), profile, nullptr, static_layer.data());
+		double seconds[3] = {};
+		size_t mismatches = 0;
+		for (int tick = 0; tick < ticks; ++tick) {
+			creeps.clear();
+			for (int ii = 0; ii < 40; ++ii) {
+				add(creeps, room_object_kind::Creep, ii % 2 ? k_object_mine : 0);
+			}
+			all = structures;
+			all.insert(all.end(), creeps.begin(), creeps.end());
+			std::shuffle(all.begin(), all.end(), world.rng());
+
+			auto start = std::chrono::steady_clock::now();
+			reference_matrix(all, profile, reference.data());
+			auto after_reference = std::chrono::steady_clock::now();
+			cost_matrix_builder_t::build(all.data(), all.size(), profile, nullptr, built.data());
+			auto after_build = std::chrono::steady_clock::now();
+			cost_matrix_builder_t::build(creeps.data(), creeps.size(), profile, static_layer.data(), layered.data());
+			auto end = std::chrono::steady_clock::now();
+			seconds[0] += std::chrono::duration<double>(after_reference - start).count();
+			seconds[1] += std::chrono::duration<double>(after_build - after_reference).count();
+			seconds[2] += std::chrono::duration<double>(end - after_build).count();
+			mismatches += reference != built || reference != layered;
+		}
+		std::printf("  %-18s %8.3f us/matrix\n  %-18s %8.3f us/matrix\n  %-18s %8.3f us/matrix  %zu mismatches, %zu objects per room\n",
+			"per-kind passes",
+			seconds[0] * 1e6 / ticks,
+			"single pass",
+			seconds[1] * 1e6 / ticks,
+			"static + creeps",
+			seconds[2] * 1e6 / ticks,
+			mismatches,
+			all.size());
+		bench_totals_t totals;
+		totals.searches = ticks;
+		totals.seconds = seconds[2];
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// One tile at a time, resolving the room for each: what a per-position query call costs
+	uint8_t reference_move_cost(const cost_matrix_registry_t& matrices, uint32_t tile, uint8_t plain, uint8_t swamp) {
+		world_position_t pos(tile & 0xffff, tile >> 16);
+		const uint8_t* terrain = world_t::default_world().room_terrain(pos.map_position());
+		if (terrain == nullptr) {
+			return terrain_query_t::k_impassable;
+		}
+		unsigned index = (pos.xx % 50) * 50 + pos.yy % 50;
+		const uint8_t* matrix = matrices.get(pos.map_position());
+		if (matrix != nullptr && matrix[index] != 0) {
+			return matrix[index];
+		}
+		unsigned code = (terrain[index / 4] >> (index % 4 * 2)) & 0x03;
+		return (code & 1) ? terrain_query_t::k_impassable : (code & 2) ? swamp : plain;
+	}
+
+	// Movement checks of a busy shard: 32 moves per room in every room, with registered matrices on
+	// half the rooms. Per-tile lookups vs the batched queries, plus walkable masks of 7x7 squares
+	// checked against the terrain codes.
+	bench_totals_t run_terrain_queries(bench_world_t& world, path_finder_t&, int iterations) {
+		int rounds = std::max(1, iterations / 20);
+		cost_matrix_registry_t matrices;
+		std::vector<uint32_t> tiles;
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				map_position_t room(k_world_origin + rx, k_world_origin + ry);
+				if ((rx + ry) % 2 == 0) {
+					uint8_t* matrix = matrices.edit(room);
+					for (int ii = 0; ii < 200; ++ii) {
+						matrix[world.rng()() % 2500] = ii % 4 == 0 ? 255 : 1;
+					}
+				}
+				for (int ii = 0; ii < 32; ++ii) {
+					world_position_t pos = world.random_pos(rx, ry);
+					tiles.push_back(uint32_t(pos.xx) | uint32_t(pos.yy) << 16);
+				}
+			}
+		}
+		std::vector<uint8_t> slow(tiles.size());
+		std::vector<uint8_t> fast(tiles.size());
+		std::vector<uint8_t> codes(tiles.size());
+		double seconds[3] = {};
+		size_t mismatches = 0;
+		for (int round = 0; round < rounds; ++round) {
+			auto start = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < tiles.size(); ++ii) {
+				slow[ii] = reference_move_cost(matrices, tiles[ii], 1, 5);
+			}
+			auto middle = std::chrono::steady_clock::now();
+			terrain_query_t::move_costs(world_t::default_world(), tiles.data(), tiles.size(), &matrices, 1, 5, fast.data());
+			auto end = std::chrono::steady_clock::now();
+			terrain_query_t::terrain_at(world_t::default_world(), tiles.data(), tiles.size(), codes.data());
+			auto after_terrain = std::chrono::steady_clock::now();
+			seconds[0] += std::chrono::duration<double>(middle - start).count();
+			seconds[1] += std::chrono::duration<double>(end - middle).count();
+			seconds[2] += std::chrono::duration<double>(after_terrain - end).count();
+			mismatches += slow != fast;
+		}
+
+		// Masks around every queried tile must agree with the terrain codes of the same tiles
+		size_t mask_mismatches = 0;
+		for (size_t ii = 0; ii < tiles.size(); ii += 7) {
+			world_position_t pos(tiles[ii] & 0xffff, tiles[ii] >> 16);
+			room_tile_t center{static_cast<uint8_t>(pos.xx % 50), static_cast<uint8_t>(pos.yy % 50)};
+			room_tile_t min{static_cast<uint8_t>(std::max(center.xx - 3, 0)), static_cast<uint8_t>(std::max(center.yy - 3, 0))};
+			room_tile_t max{static_cast<uint8_t>(std::min(center.xx + 3, 49)), static_cast<uint8_t>(std::min(center.yy + 3, 49))};
+			room_grid_t::row_t rows[7];
+			terrain_query_t::walkable_mask(world_t::default_world(), pos.map_position(), min, max, nullptr, rows);
+			for (unsigned xx = min.xx; xx <= max.xx; ++xx) {
+				for (unsigned yy = min.yy; yy <= max.yy; ++yy) {
+					uint32_t tile = uint32_t(pos.xx - center.xx + xx) | uint32_t(pos.yy - center.yy + yy) << 16;
+					uint8_t code;
+					terrain_query_t::terrain_at(world_t::default_world(), &tile, 1, &code);
+					mask_mismatches += bool((rows[xx - min.xx] >> (yy - min.yy)) & 1) != !(code & 1);
+				}
+			}
+		}
+		std::printf("  %-18s %8.2f ns/tile\n  %-18s %8.2f ns/tile\n  %-18s %8.2f ns/tile  %zu mismatches, %zu mask mismatches, %zu tiles per batch\n",
+			"per-tile costs",
+			seconds[0] * 1e9 / (double(rounds) * tiles.size()),
+			"batched costs",
+			seconds[1] * 1e9 / (double(rounds) * tiles.size()),
+			"batched terrain",
+			seconds[2] * 1e9 / (double(rounds) * tiles.size()),
+			mismatches,
+			mask_mismatches,
+			tiles.size());
+		bench_totals_t totals;
+		totals.searches = rounds;
+		totals.seconds = seconds[1];
+		totals.failures = mismatches + mask_mismatches;
+		return totals;
+	}
+
+	// Per-tile reference for the threat kernel: every source against every tile, then the same pricing
+	void reference_threat_matrix(const std::vector<threat_source_t>& sources, const threat_profile_t& profile, const uint8_t* terrain, uint8_t* out) {
+		std::memset(out, 0, threat_map_t::k_tiles);
+		for (unsigned xx = 0; xx < 50; ++xx) {
+			for (unsigned yy = 0; yy < 50; ++yy) {
+				uint32_t threat = 0;
+				for (const threat_source_t& source : sources) {
+					unsigned range = std::max(std::abs(int(xx) - source.xx), std::abs(int(yy) - source.yy));
+					switch (source.kind) {
+						case threat_kind::Tower: threat += threat_map_t::tower_damage(source.strength, range); break;
+						case threat_kind::Melee: threat += range <= 1u + source.reach ? source.strength : 0; break;
+						case threat_kind::Ranged: threat += range <= 3u + source.reach ? source.strength : 0; break;
+					}
+				}
+				unsigned tile = xx * 50 + yy;
+				unsigned code = 0x03 & terrain[tile / 4] >> (tile % 4 * 2);
+				if (threat == 0 || (code & 1) != 0) {
+					continue;
+				}
+				if (profile.block_threshold != 0 && threat >= profile.block_threshold) {
+					out[tile] = threat_map_t::k_blocked;
+				} else if (threat >= profile.threat_per_cost) {
+					unsigned under = code == 0 ? profile.plain_cost : profile.swamp_cost;
+					out[tile] = static_cast<uint8_t>(std::min<unsigned>(under + std::min<uint32_t>(threat / profile.threat_per_cost, 255), profile.max_cost));
+				}
+			}
+		}
+	}
+
+	// A siege in every room: 6 towers and 40 hostile creeps (half melee, half ranged, reach 1) that move
+	// every tick. Threat matrices per room from the per-tile reference and from the kernel.
+	bench_totals_t run_threats(bench_world_t& world, path_finder_t&, int iterations) {
+		int rounds = std::max(1, iterations / 100);
+		threat_profile_t profile;
+		profile.block_threshold = 3000;
+		std::vector<threat_source_t> sources;
+		uint8_t fast[threat_map_t::k_tiles];
+		uint8_t slow[threat_map_t::k_tiles];
+		double seconds[2] = {};
+		size_t mismatches = 0;
+		size_t matrices = 0;
+		for (int round = 0; round < rounds; ++round) {
+			for (int rx = 0; rx < world.size(); ++rx) {
+				for (int ry = 0; ry < world.size(); ++ry) {
+					const uint8_t* terrain = world_t::default_world().room_terrain(map_position_t(k_world_origin + rx, k_world_origin + ry));
+					sources.clear();
+					auto tile = [&]() { return static_cast<uint8_t>(1 + world.rng()() % 48); };
+					for (int ii = 0; ii < 6; ++ii) {
+						sources.push_back(threat_source_t{tile(), tile(), threat_kind::Tower, 0, 600});
+					}
+					for (int ii = 0; ii < 40; ++ii) {
+						uint16_t strength = static_cast<uint16_t>(10 * (1 + world.rng()() % 25));
+						sources.push_back(threat_source_t{tile(), tile(), ii % 2 ? threat_kind::Ranged : threat_kind::Melee, 1, strength});
+					}
+
+					auto start = std::chrono::steady_clock::now();
+					reference_threat_matrix(sources, profile, terrain, slow);
+					auto middle = std::chrono::steady_clock::now();
+					threat_map_t::build(sources.data(), sources.size(), profile, terrain, nullptr, fast);
+					auto end = std::chrono::steady_clock::now();
+					seconds[0] += std::chrono::duration<double>(middle - start).count();
+					seconds[1] += std::chrono::duration<double>(end - middle).count();
+					mismatches += std::memcmp(fast, slow, threat_map_t::k_tiles) != 0;
+					++matrices;
+				}
+			}
+		}
+		std::printf("  %-18s %8.2f us/room\n  %-18s %8.2f us/room  %zu mismatches, %zu sources per room\n",
+			"per-tile reference",
+			seconds[0] * 1e6 / matrices,
+			"threat kernel",
+			seconds[1] * 1e6 / matrices,
+			mismatches,
+			sources.size());
+		bench_totals_t totals;
+		totals.searches = matrices;
+		totals.seconds = seconds[1];
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Room callback over a registry: either the whole registered matrix, which the search copies, or
+	// the matrix composed with its overlay straight into the search's buffer
+	struct registry_callback_t {
+		const cost_matrix_registry_t* registry;
+		bool compose;
+	};
+
+	bool bench_registry_callback(uint8_t room_x, uint8_t room_y, room_callback_result* result, void* context) {
+		const registry_callback_t& source = *static_cast<const registry_callback_t*>(context);
+		map_position_t room(room_x, room_y);
+		result->cost_matrix = nullptr;
+		result->cost_matrix_length = 0;
+		result->block_room = false;
+		if (source.compose) {
+			source.registry->compose(room, nullptr, !result->ignore_creeps, result->matrix_buffer);
+			result->cost_matrix = result->matrix_buffer;
+			result->cost_matrix_length = cost_matrix_registry_t::k_matrix_bytes;
+		} else if (const uint8_t* matrix = source.registry->get(room)) {
+			result->cost_matrix = matrix;
+			result->cost_matrix_length = cost_matrix_registry_t::k_matrix_bytes;
+		}
+		return true;
+	}
+
+	// Per-tick creep updates over 256 rooms with static structures: rebuilding and registering every
+	// room's full matrix vs replacing sparse overlays, then the same 3-6 room searches reading each
+	bench_totals_t run_overlays(bench_world_t& world, path_finder_t& pf, int iterations) {
+		const int creeps_per_room = 40;
+		cost_matrix_profile_t profile;
+		auto full = std::make_unique<cost_matrix_registry_t>();
+		auto layered = std::make_unique<cost_matrix_registry_t>();
+		std::vector<std::vector<uint8_t>> static_layers;
+		std::vector<map_position_t> rooms;
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				std::vector<room_object_t> structures;
+				for (uint8_t ii = 5; ii < 45; ++ii) {
+					structures.push_back(room_object_t{ii, 25, room_object_kind::Road, 0});
+				}
+				for (int ii = 0; ii < 30; ++ii) {
+					structures.push_back(room_object_t{static_cast<uint8_t>(2 + world.rng()() % 46), static_cast<uint8_t>(2 + world.rng()() % 46), room_object_kind::Blocking, 0});
+				}
+				std::vector<uint8_t> matrix(cost_matrix_builder_t::k_matrix_bytes);
+				cost_matrix_builder_t::build(structures.data(), structures.size(), profile, nullptr, matrix.data());
+				rooms.emplace_back(k_world_origin + rx, k_world_origin + ry);
+				layered->set(rooms.back(), matrix.data());
+				static_layers.push_back(std::move(matrix));
+			}
+		}
+
+		int ticks = std::max(1, iterations / 200);
+		std::vector<room_object_t> creeps(creeps_per_room);
+		std::vector<cost_override_t> overrides(creeps_per_room);
+		std::vector<uint8_t> matrix(cost_matrix_builder_t::k_matrix_bytes);
+		std::vector<uint8_t> composed(cost_matrix_builder_t::k_matrix_bytes);
+		double update_seconds[2] = {};
+		double search_seconds[2] = {};
+		uint64_t operations[2] = {};
+		size_t mismatches = 0;
+		size_t searches = 0;
+		search_result_native result;
+		for (int tick = 0; tick < ticks; ++tick) {
+			std::vector<std::vector<room_object_t>> positions;
+			for (size_t room = 0; room < rooms.size(); ++room) {
+				for (room_object_t& creep : creeps) {
+					creep = room_object_t{static_cast<uint8_t>(1 + world.rng()() % 48), static_cast<uint8_t>(1 + world.rng()() % 48), room_object_kind::Creep, 0};
+				}
+				positions.push_back(creeps);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t room = 0; room < rooms.size(); ++room) {
+				cost_matrix_builder_t::build(positions[room].data(), positions[room].size(), profile, static_layers[room].data(), matrix.data());
+				full->set(rooms[room], matrix.data());
+			}
+			auto after_full = std::chrono::steady_clock::now();
+			for (size_t room = 0; room < rooms.size(); ++room) {
+				for (int ii = 0; ii < creeps_per_room; ++ii) {
+					overrides[ii] = cost_override_t{positions[room][ii].xx, positions[room][ii].yy, profile.hostile_creep};
+				}
+				layered->set_overlay(rooms[room], overrides.data(), overrides.size());
+			}
+			auto end = std::chrono::steady_clock::now();
+			update_seconds[0] += std::chrono::duration<double>(after_full - start).count();
+			update_seconds[1] += std::chrono::duration<double>(end - after_full).count();
+			for (size_t room = 0; room < rooms.size(); ++room) {
+				layered->compose(rooms[room], nullptr, true, composed.data());
+				mismatches += std::memcmp(composed.data(), full->get(rooms[room]), composed.size()) != 0;
+			}
+
+			std::vector<bench_request_t> requests;
+			for (int ii = 0; ii < 100; ++ii) {
+				int span = world.size() - 6;
+				int rx = world.rng()() % span;
+				int ry = world.rng()() % span;
+				bench_request_t request{world.random_pos(rx, ry), {}, default_options()};
+				request.goals.emplace_back(world.random_pos(rx + 3 + world.rng()() % 4, ry + world.rng()() % 4), 1);
+				request.options.max_rooms = 64;
+				request.options.max_ops = 100000;
+				requests.push_back(std::move(request));
+			}
+			registry_callback_t sources[2] = {{full.get(), false}, {layered.get(), true}};
+			std::vector<cost_t> costs[2];
+			for (int pass = 0; pass < 2; ++pass) {
+				world_t::default_world().set_room_callback(bench_registry_callback, &sources[pass]);
+				auto search_start = std::chrono::steady_clock::now();
+				for (const bench_request_t& entry : requests) {
+					search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+					pf.search_native(request, result);
+					operations[pass] += result.operations;
+					costs[pass].push_back(result.cost);
+				}
+				search_seconds[pass] += std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+			}
+			world_t::default_world().set_room_callback(nullptr, nullptr);
+			mismatches += costs[0] != costs[1];
+			searches += requests.size();
+		}
+
+		const char* labels[] = {"full matrices", "overlays"};
+		for (int ii = 0; ii < 2; ++ii) {
+			std::printf("  %-18s %8.2f us/room update %10.2f us/search %9llu ops\n",
+				labels[ii],
+				update_seconds[ii] * 1e6 / (ticks * rooms.size()),
+				search_seconds[ii] * 1e6 / searches,
+				static_cast<unsigned long long>(operations[ii]));
+		}
+		std::printf("  %zu rooms, %d creeps per room, %zu mismatches\n", rooms.size(), creeps_per_room, mismatches);
+		bench_totals_t totals;
+		totals.searches = searches;
+		totals.operations = operations[1];
+		totals.seconds = search_seconds[1];
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Terrain code of a world tile: 0 plain, 1 wall, 2 swamp
+	unsigned terrain_code(world_position_t pos) {
+		const uint8_t* terrain = world_t::default_world().room_terrain(pos.map_position());
+		unsigned tile = (pos.xx % 50) * 50 + pos.yy % 50;
+		return terrain == nullptr ? 1 : (terrain[tile / 4] >> (tile % 4 * 2)) & 3;
+	}
+
+	world_position_t random_open_pos(bench_world_t& world, int rx, int ry) {
+		world_position_t pos = world.random_pos(rx, ry);
+		while (terrain_code(pos) & 1) {
+			pos = world.random_pos(rx, ry);
+		}
+		return pos;
+	}
+
+	// Reloads the world from the game's own format, one digit per tile in y-major order: the tile-by-tile
+	// conversion the managed side did before, the word-wise packer on one thread, then the full loader
+	// on one thread and on every core. The world ends up with the same terrain it started with.
+	bench_totals_t run_terrain_load(bench_world_t& world, path_finder_t&, int iterations) {
+		std::vector<std::vector<uint8_t>> text;
+		std::vector<terrain_room_plain> rooms;
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				std::vector<uint8_t> digits(terrain_packer_t::k_code_bytes);
+				for (int xx = 0; xx < 50; ++xx) {
+					for (int yy = 0; yy < 50; ++yy) {
+						world_position_t pos((k_world_origin + rx) * 50 + xx, (k_world_origin + ry) * 50 + yy);
+						digits[yy * 50 + xx] = static_cast<uint8_t>('0' + terrain_code(pos));
+					}
+				}
+				text.push_back(std::move(digits));
+			}
+		}
+		std::vector<std::vector<uint8_t>> original;
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				map_position_t room(k_world_origin + rx, k_world_origin + ry);
+				const uint8_t* bits = world_t::default_world().room_terrain(room);
+				original.emplace_back(bits, bits + k_terrain_bytes);
+				rooms.push_back(terrain_room_plain{room.xx, room.yy, text[rooms.size()].data(), terrain_packer_t::k_code_bytes});
+			}
+		}
+
+		int passes = std::max(1, iterations / 200);
+		unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+		std::vector<uint8_t> packed(rooms.size() * k_terrain_bytes);
+		std::vector<uint8_t> copied(rooms.size() * terrain_packer_t::k_code_bytes);
+		double seconds[5] = {};
+		size_t mismatches = 0;
+		size_t rejected = 0;
+		for (int pass = 0; pass < passes; ++pass) {
+			auto start = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < rooms.size(); ++ii) {
+				std::memcpy(copied.data() + ii * terrain_packer_t::k_code_bytes, rooms[ii].bits, terrain_packer_t::k_code_bytes);
+			}
+			auto after_copy = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < rooms.size(); ++ii) {
+				terrain_packer_t::pack_reference(rooms[ii].bits, rooms[ii].length, packed.data() + ii * k_terrain_bytes);
+			}
+			auto after_reference = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < rooms.size(); ++ii) {
+				mismatches += std::memcmp(packed.data() + ii * k_terrain_bytes, original[ii].data(), k_terrain_bytes) != 0;
+			}
+			auto before_pack = std::chrono::steady_clock::now();
+			for (size_t ii = 0; ii < rooms.size(); ++ii) {
+				terrain_packer_t::pack(rooms[ii].bits, rooms[ii].length, packed.data() + ii * k_terrain_bytes);
+			}
+			auto after_pack = std::chrono::steady_clock::now();
+			rejected += world_t::default_world().load_terrain_raw(rooms.data(), rooms.size(), 1);
+			auto after_single = std::chrono::steady_clock::now();
+			rejected += world_t::default_world().load_terrain_raw(rooms.data(), rooms.size(), cores);
+			auto end = std::chrono::steady_clock::now();
+			seconds[0] += std::chrono::duration<double>(after_copy - start).count();
+			seconds[1] += std::chrono::duration<double>(after_reference - after_copy).count();
+			seconds[2] += std::chrono::duration<double>(after_pack - before_pack).count();
+			seconds[3] += std::chrono::duration<double>(after_single - after_pack).count();
+			seconds[4] += std::chrono::duration<double>(end - after_single).count();
+			for (size_t ii = 0; ii < rooms.size(); ++ii) {
+				mismatches += std::memcmp(packed.data() + ii * k_terrain_bytes, original[ii].data(), k_terrain_bytes) != 0;
+				mismatches += std::memcmp(world_t::default_world().room_terrain(map_position_t(rooms[ii].xx, rooms[ii].yy)), original[ii].data(), k_terrain_bytes) != 0;
+			}
+		}
+
+		const char* labels[] = {"memcpy", "per-tile packing", "word packing", "load, 1 thread", "load, all cores"};
+		double megabytes = passes * rooms.size() * terrain_packer_t::k_code_bytes / 1e6;
+		for (int ii = 0; ii < 5; ++ii) {
+			std::printf("  %-18s %8.2f ms/world %9.1f MB/s\n", labels[ii], seconds[ii] * 1e3 / passes, megabytes / seconds[ii]);
+		}
+		std::printf("  %zu rooms, %u threads, %zu mismatches, %zu rejected\n", rooms.size(), cores, mismatches, rejected);
+		bench_totals_t totals;
+		totals.searches = passes;
+		totals.seconds = seconds[4];
+		totals.failures = mismatches + rejected;
+		return totals;
+	}
+
+	// Landmark tables across a simulated restart with a precompute cache file: a cold build that
+	// writes it, a warm build that reads it back, then a reload with one room's terrain changed.
+	// Cached tables must equal computed ones.
+	bench_totals_t run_precompute_cache(bench_world_t& world, path_finder_t&, int) {
+		const unsigned landmark_count = 4;
+		std::string path = "pathfinder_bench_precompute.cache";
+		std::remove(path.c_str());
+		std::vector<std::vector<uint8_t>> original;
+		std::vector<terrain_room_plain> rooms;
+		for (int rx = 0; rx < world.size(); ++rx) {
+			for (int ry = 0; ry < world.size(); ++ry) {
+				map_position_t room(k_world_origin + rx, k_world_origin + ry);
+				const uint8_t* bits = world_t::default_world().room_terrain(room);
+				original.emplace_back(bits, bits + k_terrain_bytes);
+			}
+		}
+		for (size_t ii = 0; ii < original.size(); ++ii) {
+			rooms.push_back(terrain_room_plain{
+				static_cast<uint8_t>(k_world_origin + ii / world.size()), static_cast<uint8_t>(k_world_origin + ii % world.size()), original[ii].data(), k_terrain_bytes});
+		}
+		auto snapshot = [&]() {
+			std::vector<uint16_t> tables;
+			const landmark_tables_t& landmarks = world_t::default_world().landmark_table();
+			for (const terrain_room_plain& room : rooms) {
+				const uint16_t* table = landmarks.room(map_position_t(room.xx, room.yy).id);
+				tables.insert(tables.end(), table, table + landmark_tables_t::k_tiles * landmark_count);
+			}
+			return tables;
+		};
+
+		const char* labels[] = {"cold", "warm", "one room changed"};
+		double seconds[3] = {};
+		size_t counts[3][2] = {};
+		std::vector<uint16_t> tables[3];
+		for (int pass = 0; pass < 3; ++pass) {
+			world_t::default_world().set_landmarks(0, 1);
+			world_t::default_world().set_precompute_cache(path.c_str());
+			if (pass == 2) {
+				original[37][100] ^= 0x04; // a plain tile turns into a wall or back
+				world_t::default_world().load_terrain(rooms.data(), rooms.size());
+			}
+			auto start = std::chrono::steady_clock::now();
+			world_t::default_world().set_landmarks(landmark_count, 1);
+			seconds[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			counts[pass][0] = world_t::default_world().landmark_table().cached_rooms();
+			counts[pass][1] = world_t::default_world().landmark_table().computed_rooms();
+			tables[pass] = snapshot();
+		}
+		for (int pass = 0; pass < 3; ++pass) {
+			std::printf("  %-18s %8.2f ms  %3zu rooms cached  %3zu computed\n", labels[pass], seconds[pass] * 1e3, counts[pass][0], counts[pass][1]);
+		}
+
+		// The changed room is the only one recomputed; check the rest against a cache-free build
+		world_t::default_world().set_precompute_cache(nullptr);
+		world_t::default_world().set_landmarks(landmark_count, 1);
+		size_t mismatches = (tables[0] != tables[1]) + (snapshot() != tables[2]);
+		std::printf("  %zu mismatches\n", mismatches);
+
+		original[37][100] ^= 0x04;
+		world_t::default_world().load_terrain(rooms.data(), rooms.size());
+		world_t::default_world().set_landmarks(0, 1);
+		std::remove(path.c_str());
+		bench_totals_t totals;
+		totals.searches = 3;
+		totals.seconds = seconds[1];
+		totals.failures = mismatches;
+		return totals;
+	}
+
+	// Landmark tables built on one thread and on every core, then single-room and 3-6 room searches
+	// with and without the landmark bound. JPS over mixed costs is not exactly optimal, so costs may
+	// drift by a step either way; admissibility is checked against in-room BFS distances instead.
+	bench_totals_t run_landmarks(bench_world_t& world, path_finder_t& pf, int iterations) {
+		const unsigned landmark_count = 4;
+		unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+		double build_seconds[2] = {};
+		for (int pass = 0; pass < 2; ++pass) {
+			auto start = std::chrono::steady_clock::now();
+			world_t::default_world().set_landmarks(landmark_count, pass == 0 ? 1 : cores);
+			build_seconds[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		// Steps inside the room alone never undercut the bound from any tile to a sampled goal tile
+		const landmark_tables_t& tables = world_t::default_world().landmark_table();
+		size_t violations = 0;
+		std::vector<uint16_t> steps(2500);
+		std::vector<uint16_t> queue;
+		for (int sample = 0; sample < 64; ++sample) {
+			world_position_t goal = random_open_pos(world, world.rng()() % world.size(), world.rng()() % world.size());
+			const uint16_t* table = tables.room(goal.map_position().id);
+			const uint8_t* terrain = world_t::default_world().room_terrain(goal.map_position());
+			unsigned goal_tile = (goal.xx % 50) * 50 + goal.yy % 50;
+			std::fill(steps.begin(), steps.end(), landmark_tables_t::k_unreached);
+			steps[goal_tile] = 0;
+			queue.assign(1, static_cast<uint16_t>(goal_tile));
+			for (size_t head = 0; head < queue.size(); ++head) {
+				int xx = queue[head] / 50;
+				int yy = queue[head] % 50;
+				for (int dx = -1; dx <= 1; ++dx) {
+					for (int dy = -1; dy <= 1; ++dy) {
+						int tile = (xx + dx) * 50 + yy + dy;
+						if (xx + dx >= 0 && yy + dy >= 0 && xx + dx < 50 && yy + dy < 50 && !(terrain[tile / 4] >> (tile % 4 * 2) & 1) && steps[tile] == landmark_tables_t::k_unreached) {
+							steps[tile] = steps[queue[head]] + 1;
+							queue.push_back(static_cast<uint16_t>(tile));
+						}
+					}
+				}
+			}
+			for (uint16_t tile : queue) {
+				for (unsigned ii = 0; ii < landmark_count; ++ii) {
+					int from = table[tile * landmark_count + ii];
+					int to = table[goal_tile * landmark_count + ii];
+					violations += from != landmark_tables_t::k_unreached && to != landmark_tables_t::k_unreached && std::abs(from - to) > steps[tile];
+				}
+			}
+		}
+		std::printf("  %-18s %8.2f ms on 1 thread, %8.2f ms on %u  (%zu KB, %zu admissibility violations)\n",
+			"build",
+			build_seconds[0] * 1e3,
+			build_seconds[1] * 1e3,
+			cores,
+			tables.memory_bytes() / 1024,
+			violations);
+
+		struct shape_t {
+			const char* name;
+			int min_span;
+			int max_span;
+			uint8_t max_rooms;
+			bool walled; // only the generator's wall-line room styles
+		};
+		const shape_t shapes[] = {
+			{"single-room", 0, 0, 1, false},
+			{"walled room", 0, 0, 1, true},
+			{"3-6 rooms", 3, 6, 64, false},
+		};
+		bench_totals_t totals;
+		for (const shape_t& shape : shapes) {
+			std::vector<bench_request_t> requests;
+			for (int ii = 0; ii < iterations; ++ii) {
+				bench_request_t request{world_position_t::null(), {}, default_options()};
+				int rx = world.rng()() % (world.size() - shape.max_span);
+				int ry = world.rng()() % (world.size() - shape.max_span);
+				while (shape.walled && (rx * 7 + ry * 3) % 4 % 2 == 0) {
+					rx = world.rng()() % world.size();
+					ry = world.rng()() % world.size();
+				}
+				int span = shape.min_span + world.rng()() % (shape.max_span - shape.min_span + 1);
+				request.origin = random_open_pos(world, rx, ry);
+				request.goals.emplace_back(random_open_pos(world, rx + span, ry + world.rng()() % (span + 1)), ii % 2);
+				request.options.max_rooms = shape.max_rooms;
+				request.options.max_ops = 100000;
+				request.options.heuristic_weight = 1.0;
+				requests.push_back(std::move(request));
+			}
+			bench_totals_t runs[2];
+			size_t cheaper = 0;
+			size_t costlier = 0;
+			search_result_native result;
+			std::vector<cost_t> costs;
+			for (int pass = 0; pass < 2; ++pass) {
+				world_t::default_world().set_landmarks(pass == 0 ? 0 : landmark_count, cores);
+				for (size_t ii = 0; ii < requests.size(); ++ii) {
+					const bench_request_t& entry = requests[ii];
+					search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+					auto start = std::chrono::steady_clock::now();
+					pf.search_native(request, result);
+					runs[pass].seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					++runs[pass].searches;
+					runs[pass].operations += result.operations;
+					runs[pass].path_tiles += result.path.size();
+					cost_t cost = result.incomplete ? std::numeric_limits<cost_t>::max() : result.cost;
+					if (pass == 0) {
+						costs.push_back(cost);
+					} else {
+						cheaper += cost < costs[ii];
+						costlier += cost > costs[ii];
+					}
+				}
+			}
+			std::printf("  %-18s chebyshev %9.2f us %8.0f ops  landmarks %9.2f us %8.0f ops  (%.1f%% fewer ops; %zu paths cheaper, %zu costlier)\n",
+				shape.name,
+				runs[0].seconds * 1e6 / runs[0].searches,
+				double(runs[0].operations) / runs[0].searches,
+				runs[1].seconds * 1e6 / runs[1].searches,
+				double(runs[1].operations) / runs[1].searches,
+				(1 - double(runs[1].operations) / runs[0].operations) * 100,
+				cheaper,
+				costlier);
+			totals.searches += runs[1].searches;
+			totals.operations += runs[1].operations;
+			totals.path_tiles += runs[1].path_tiles;
+			totals.seconds += runs[1].seconds;
+		}
+		world_t::default_world().set_landmarks(0, 1);
+		totals.failures = violations;
+		return totals;
+	}
+
+	// Long searches across the world with a few portal pairs linking distant rooms, vs the same
+	// searches on the plain map. Every portal-aware path is walked again to check it is connected and
+	// that its cost matches, and with weight 1.0 it may never cost more than the walking route.
+	bench_totals_t run_portals(bench_world_t& world, path_finder_t& pf, int iterations) {
+		const int far = world.size() - 3;
+		const int pairs[][4] = {{2, 2, far, far}, {2, far, far, 2}, {far / 2, 1, far / 2, far}, {1, far / 2, far, far / 2}};
+		std::vector<portal_t> portals;
+		for (const auto& pair : pairs) {
+			world_position_t left = random_open_pos(world, pair[0], pair[1]);
+			world_position_t right = random_open_pos(world, pair[2], pair[3]);
+			portals.push_back(portal_t{left, right, 0});
+			portals.push_back(portal_t{right, left, 0});
+		}
+
+		std::vector<bench_request_t> requests;
+		int runs = std::max(1, iterations / 40);
+		for (int ii = 0; ii < runs; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			request.origin = random_open_pos(world, world.rng()() % 4, world.rng()() % 4);
+			request.goals.emplace_back(random_open_pos(world, world.size() - 1 - world.rng()() % 4, world.size() - 1 - world.rng()() % 4), 1);
+			request.options.max_rooms = 256;
+			request.options.max_ops = 1000000;
+			request.options.heuristic_weight = 1.0;
+			requests.push_back(std::move(request));
+		}
+
+		world_t::default_world().load_portals(nullptr, 0);
+		std::vector<cost_t> walking_costs;
+		search_result_native result;
+		bench_totals_t walking;
+		auto start = std::chrono::steady_clock::now();
+		for (const auto& entry : requests) {
+			search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+			pf.search_native(request, result);
+			walking_costs.push_back(result.incomplete ? std::numeric_limits<cost_t>::max() : result.cost);
+			++walking.searches;
+			walking.operations += result.operations;
+		}
+		walking.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		world_t::default_world().load_portals(portals.data(), portals.size());
+		bench_totals_t totals;
+		size_t hops = 0;
+		size_t broken = 0;
+		size_t worse = 0;
+		uint64_t cost_sum[2] = {};
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			const bench_request_t& entry = requests[ii];
+			search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+			start = std::chrono::steady_clock::now();
+			pf.search_native(request, result);
+			totals.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			++totals.searches;
+			totals.operations += result.operations;
+			totals.path_tiles += result.path.size();
+
+			// The path runs from the goal back to the origin
+			cost_t cost = 0;
+			world_position_t next = entry.origin;
+			for (size_t step = result.path.size(); step-- > 0;) {
+				world_position_t pos = result.path[step];
+				unsigned code = terrain_code(pos);
+				if (world_t::default_world().is_portal_hop(next, pos)) {
+					++hops;
+				} else if (next.range_to(pos) != 1 || (code & 1)) {
+					++broken;
+					break;
+				} else {
+					cost += code & 2 ? entry.options.swamp_cost : entry.options.plain_cost;
+				}
+				next = pos;
+			}
+			broken += !result.incomplete && cost != result.cost;
+			worse += !result.incomplete && result.cost > walking_costs[ii];
+
+			// Jump points expanded on demand must give the same tiles across the hops
+			std::vector<world_position_t> full_path = result.path;
+			search_options_native options = entry.options;
+			options.waypoints_only = true;
+			search_request_native sparse{entry.origin, entry.goals.data(), entry.goals.size(), options};
+			pf.search_native(sparse, result);
+			std::vector<world_position_t> expanded(path_expander_t::tile_count(world_t::default_world(), entry.origin, result.path.data(), result.path.size()));
+			path_expander_t expander(world_t::default_world(), entry.origin, result.path.data(), result.path.size());
+			expanded.resize(expander.next(expanded.data(), expanded.size()));
+			broken += expanded.size() != full_path.size() || !std::equal(expanded.begin(), expanded.end(), full_path.begin(), [](world_position_t left, world_position_t right) {
+				return left.id == right.id;
+			});
+			if (!result.incomplete && walking_costs[ii] != std::numeric_limits<cost_t>::max()) {
+				cost_sum[0] += walking_costs[ii];
+				cost_sum[1] += result.cost;
+			}
+		}
+		world_t::default_world().load_portals(nullptr, 0);
+
+		std::printf("  %-18s %9.2f us/search %9.0f ops/search  avg cost %7.1f\n  %-18s %9.2f us/search %9.0f ops/search  avg cost %7.1f  %zu hops  %zu broken  %zu costlier\n",
+			"walking",
+			walking.seconds * 1e6 / walking.searches,
+			double(walking.operations) / walking.searches,
+			double(cost_sum[0]) / requests.size(),
+			"portals",
+			totals.seconds * 1e6 / totals.searches,
+			double(totals.operations) / totals.searches,
+			double(cost_sum[1]) / requests.size(),
+			hops,
+			broken,
+			worse);
+		totals.failures = broken + worse;
+		return totals;
+	}
+
+	// Two worlds with different terrain in one process: one finder switching worlds per request, then
+	// a thread per world with its own finder. Both must find the same paths.
+	bench_totals_t run_worlds(bench_world_t& world, path_finder_t& pf, int iterations) {
+		auto second = std::make_unique<world_t>();
+		bench_world_t second_world(world.size(), world.rng()(), *second);
+		world_t* targets[2] = {&world_t::default_world(), second.get()};
+		std::vector<bench_request_t> requests[2];
+		for (int ii = 0; ii < iterations; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int span = world.size() - 6;
+			int rx = world.rng()() % span;
+			int ry = world.rng()() % span;
+			request.origin = world.random_pos(rx, ry);
+			request.goals.emplace_back(world.random_pos(rx + 3 + world.rng()() % 4, ry + world.rng()() % 4), 1);
+			request.options.max_rooms = 64;
+			request.options.max_ops = 100000;
+			requests[ii % 2].push_back(std::move(request));
+		}
+
+		std::vector<search_result_native> expected[2];
+		search_result_native result;
+		bench_totals_t switching;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t ii = 0; ii < requests[0].size() + requests[1].size(); ++ii) {
+			const bench_request_t& entry = requests[ii % 2][ii / 2];
+			pf.set_world(*targets[ii % 2]);
+			search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+			pf.search_native(request, result);
+			expected[ii % 2].push_back(result);
+			++switching.searches;
+			switching.operations += result.operations;
+		}
+		switching.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		pf.set_world(world_t::default_world());
+
+		bench_totals_t totals;
+		size_t mismatches[2] = {0, 0};
+		uint64_t operations[2] = {0, 0};
+		uint64_t tiles[2] = {0, 0};
+		start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (int side = 0; side < 2; ++side) {
+			threads.emplace_back([&, side]() {
+				auto finder = std::make_unique<path_finder_t>(*targets[side]);
+				search_result_native found;
+				for (size_t ii = 0; ii < requests[side].size(); ++ii) {
+					const bench_request_t& entry = requests[side][ii];
+					search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+					finder->search_native(request, found);
+					operations[side] += found.operations;
+					tiles[side] += found.path.size();
+					const search_result_native& reference = expected[side][ii];
+					mismatches[side] += found.cost != reference.cost || found.path.size() != reference.path.size() ||
+						!std::equal(found.path.begin(), found.path.end(), reference.path.begin(), [](world_position_t left, world_position_t right) {
+							return left.id == right.id;
+						});
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		totals.searches = requests[0].size() + requests[1].size();
+		totals.operations = operations[0] + operations[1];
+		totals.path_tiles = tiles[0] + tiles[1];
+
+		std::printf("  %-18s %9.2f us/search\n  %-18s %9.2f us/search  (speedup %.2fx, %zu mismatches)\n",
+			"one finder",
+			switching.seconds * 1e6 / switching.searches,
+			"thread per world",
+			totals.seconds * 1e6 / totals.searches,
+			switching.seconds / totals.seconds,
+			mismatches[0] + mismatches[1]);
+		totals.failures = mismatches[0] + mismatches[1];
+		return totals;
+	}
+
+	// World-scale searches at weights 1.2 and 1.0 on path_finder_t, then on parallel_search_t with 1 to N
+	// threads. Every parallel path must be walkable, cost what it reports and stay within the weight
+	// times the optimum. The optimum comes from one thread at weight 1.0, which is exact A*;
+	// path_finder_t's jump points can step along a room edge, which plain A* does not allow, so its
+	// costs are sometimes a tile or two lower.
+	bench_totals_t run_parallel(bench_world_t& world, path_finder_t& pf, int iterations) {
+		std::vector<bench_request_t> requests;
+		int runs = std::max(2, iterations / 100);
+		for (int ii = 0; ii < runs; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			request.origin = random_open_pos(world, world.rng()() % 2, world.rng()() % 2);
+			request.goals.emplace_back(random_open_pos(world, world.size() - 1 - world.rng()() % 2, world.size() - 1 - world.rng()() % 2), 1);
+			request.options.max_rooms = 256;
+			request.options.max_ops = 1000000;
+			requests.push_back(std::move(request));
+		}
+
+		unsigned max_threads = std::max(4u, std::thread::hardware_concurrency());
+		std::vector<std::unique_ptr<parallel_search_t>> engines;
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+			engines.push_back(std::make_unique<parallel_search_t>(world_t::default_world(), threads));
+		}
+
+		std::vector<cost_t> optimal;
+		search_result_native result;
+		for (bench_request_t& entry : requests) {
+			entry.options.heuristic_weight = 1.0;
+			search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+			engines[0]->search(request, result);
+			optimal.push_back(result.incomplete ? std::numeric_limits<cost_t>::max() : result.cost);
+		}
+
+		bench_totals_t totals;
+		for (double weight : {1.2, 1.0}) {
+			for (bench_request_t& entry : requests) {
+				entry.options.heuristic_weight = weight;
+			}
+			bench_totals_t sequential = run_requests(pf, requests);
+			std::printf("  weight %.1f\n  %-18s %10.2f us/search %9.0f ops/search\n",
+				weight,
+				"path_finder_t",
+				sequential.seconds * 1e6 / sequential.searches,
+				double(sequential.operations) / sequential.searches);
+
+			double single_thread = 0;
+			for (const auto& engine : engines) {
+				bench_totals_t run;
+				size_t over_bound = 0;
+				size_t broken = 0;
+				uint64_t cost_sum = 0;
+				for (size_t ii = 0; ii < requests.size(); ++ii) {
+					const bench_request_t& entry = requests[ii];
+					search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+					auto start = std::chrono::steady_clock::now();
+					engine->search(request, result);
+					run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					++run.searches;
+					run.operations += result.operations;
+					run.path_tiles += result.path.size();
+					cost_sum += result.cost;
+
+					// The path runs from the goal back to the origin
+					cost_t cost = 0;
+					world_position_t next = entry.origin;
+					for (size_t step = result.path.size(); step-- > 0;) {
+						world_position_t pos = result.path[step];
+						unsigned code = terrain_code(pos);
+						if (next.range_to(pos) != 1 || (code & 1)) {
+							++broken;
+							break;
+						}
+						cost += code & 2 ? entry.options.swamp_cost : entry.options.plain_cost;
+						next = pos;
+					}
+					broken += result.incomplete != (optimal[ii] == std::numeric_limits<cost_t>::max()) || cost != result.cost;
+					over_bound += !result.incomplete && result.cost > optimal[ii] * weight;
+				}
+				if (engine->thread_count() == 1) {
+					single_thread = run.seconds;
+				}
+				if (engine->thread_count() == 1 && weight == 1.2) {
+					uint64_t failures = totals.failures;
+					totals = run;
+					totals.failures = failures;
+				}
+				totals.failures += over_bound + broken;
+				std::printf("  %2u thread%s         %10.2f us/search %9.0f ops/search  x%.2f vs 1 thread  x%.2f vs path_finder_t  avg cost %7.1f  %zu over bound  %zu broken\n",
+					engine->thread_count(),
+					engine->thread_count() == 1 ? " " : "s",
+					run.seconds * 1e6 / run.searches,
+					double(run.operations) / run.searches,
+					single_thread / run.seconds,
+					sequential.seconds / run.seconds,
+					double(cost_sum) / run.searches,
+					over_bound,
+					broken);
+			}
+		}
+		return totals;
+	}
+
+	bench_totals_t run_learned(bench_world_t& world, path_finder_t& pf, int iterations) {
+		// A few popular goals, each sought from 3-6 rooms west of it
+		const int goal_rooms[][2] = {{9, 3}, {12, 10}, {7, 12}, {14, 6}};
+		std::vector<world_position_t> targets;
+		for (const auto& room : goal_rooms) {
+			targets.push_back(random_open_pos(world, room[0], room[1]));
+		}
+		std::vector<bench_request_t> requests;
+		for (int ii = 0; ii < iterations; ++ii) {
+			bench_request_t request{world_position_t::null(), {}, default_options()};
+			int target = ii % std::size(goal_rooms);
+			int rx = goal_rooms[target][0] - 3 - static_cast<int>(world.rng()() % 4);
+			int ry = std::clamp(goal_rooms[target][1] + static_cast<int>(world.rng()() % 7) - 3, 0, world.size() - 1);
+			request.origin = random_open_pos(world, rx, ry);
+			request.goals.emplace_back(targets[target], 1);
+			request.options.max_rooms = 64;
+			request.options.max_ops = 100000;
+			request.options.heuristic_weight = 1.0;
+			request.options.learn_heuristic = true;
+			requests.push_back(std::move(request));
+		}
+
+		// Round 0 searches without tables; every later round reads and feeds what the ones before learned
+		learned_heuristics_t& learned = world_t::default_world().learned_heuristic_tables();
+		const int rounds = 4;
+		bench_totals_t totals;
+		search_result_native result;
+		std::vector<cost_t> costs;
+		uint64_t base_cost = 0;
+		for (int round = 0; round < rounds; ++round) {
+			learned.set_capacity(round == 0 ? 0 : 4096);
+			bench_totals_t run;
+			size_t cheaper = 0;
+			size_t costlier = 0;
+			uint64_t total_cost = 0;
+			for (size_t ii = 0; ii < requests.size(); ++ii) {
+				const bench_request_t& entry = requests[ii];
+				search_request_native request{entry.origin, entry.goals.data(), entry.goals.size(), entry.options};
+				auto start = std::chrono::steady_clock::now();
+				pf.search_native(request, result);
+				run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				++run.searches;
+				run.operations += result.operations;
+				run.path_tiles += result.path.size();
+				cost_t cost = result.incomplete ? std::numeric_limits<cost_t>::max() : result.cost;
+				total_cost += result.cost;
+				if (round == 0) {
+					costs.push_back(cost);
+				} else {
+					cheaper += cost < costs[ii];
+					costlier += cost > costs[ii];
+				}
+			}
+			if (round == 0) {
+				base_cost = total_cost;
+			}
+			std::printf("  round %-12d %9.2f us %8.0f ops  %6zu room grids held  (%+.2f%% path cost; %zu paths cheaper, %zu costlier than round 0)\n",
+				round,
+				run.seconds * 1e6 / run.searches,
+				double(run.operations) / run.searches,
+				learned.room_grids(),
+				(double(total_cost) / base_cost - 1) * 100,
+				cheaper,
+				costlier);
+			if (round == rounds - 1) {
+				totals = run;
+			}
+		}
+		learned.set_capacity(0);
+		return totals;
+	}
+
+	std::vector<scenario_t> make_scenarios() {
+		return {
+			{"single-room", "origin and goal in the same room, maxRooms 1",
+				[](bench_world_t& world, path_finder_t& pf, int iterations) {
+					return run_searches(pf, iterations, [&](std::vector<goal_t>& goals, search_options_native& options) {
+						int rx = world.rng()() % world.size();
+						int ry = world.rng()() % world.size();
+						goals.emplace_back(world.random_pos(rx, ry), 1);
+						options.max_rooms = 1;
+						return world.random_pos(rx, ry);
+					});
+				}},
+			{"many-room", "goal 3-6 rooms away, maxRooms 64, maxOps 100000",
+				[](bench_world_t& world, path_finder_t& pf, int iterations) {
+					return run_searches(pf, iterations, [&](std::vector<goal_t>& goals, search_options_native& options) {
+						int span = world.size() - 6;
+						int rx = world.rng()() % span;
+						int ry = world.rng()() % span;
+						int gx = rx + 3 + world.rng()() % 4;
+						int gy = ry + world.rng()() % 4;
+						goals.emplace_back(world.random_pos(gx, gy), 1);
+						options.max_rooms = 64;
+						options.max_ops = 100000;
+						return world.random_pos(rx, ry);
+					});
+				}},
+			{"world-scale", "corner to corner across the 16x16 world, maxRooms 256, maxOps 1000000, weight 1.0",
+				[](bench_world_t& world, path_finder_t& pf, int iterations) {
+					int runs = std::max(1, iterations / 100);
+					bench_totals_t totals = run_searches(pf, runs, [&](std::vector<goal_t>& goals, search_options_native& options) {
+						goals.emplace_back(world.random_pos(world.size() - 1, world.size() - 1), 1);
+						options.max_rooms = 256;
+						options.heuristic_weight = 1.0;
+						options.max_ops = 1000000;
+						return world.random_pos(0, 0);
+					});
+					std::printf("%-14s %8zu room pages held after run\n", "", pf.allocated_room_pages());
+					return totals;
+				}},
+			{"kernels", "specialized vs general kernel per request shape (seek/flee, goals, weight, matrix)",
+				run_kernel_shapes},
+			{"room-grid", "maxRooms 1 seek, seek with a matrix and flee: multi-room kernels vs the padded single-room grid",
+				run_room_grid},
+			{"corridor", "goal 2-6 rooms away behind a wall of blocked rooms, with and without a room-route corridor (margin 1)",
+				run_corridor},
+			{"async", "many-room workload inline vs submitted to the worker pool and polled in bulk",
+				run_async},
+			{"waypoints", "6-7 room searches returning full paths vs jump points: search, ABI conversion and result bytes, on-demand expansion",
+				run_waypoints},
+			{"analysis", "distance transform and flood fill per room, bit-row kernels vs per-tile reference",
+				run_analysis},
+			{"validate", "bulk re-pricing of cached 2-4 room paths after cost matrix changes vs re-searching them",
+				run_validate},
+			{"cooperative", "24 crossing creeps per room, independent plans vs one reservation-table batch (window 16)",
+				run_cooperative},
+			{"landmarks", "ALT landmark tables (4 per room): build time, then ops and time vs the Chebyshev bound, weight 1.0",
+				run_landmarks},
+			{"learned", "4 popular goals sought from 3-6 rooms away, weight 1.0: jump point search, then 3 rounds of exact Adaptive A*",
+				run_learned},
+			{"precompute-cache", "landmark tables (4 per room, 1 thread) cold, warm from the cache file, and with one room changed",
+				run_precompute_cache},
+			{"matrices", "cost matrices from ~270 typed room objects: per-kind passes, single pass, cached static layer + creeps",
+				run_matrix_build},
+			{"threats", "threat-weighted matrices from 6 towers and 40 hostile creeps per room: per-tile reference vs the summed-area kernel",
+				run_threats},
+			{"terrain-queries", "32 movement checks per room over 256 rooms: per-tile cost lookups vs batched costs and terrain codes",
+				run_terrain_queries},
+			{"terrain-load", "16x16 world from y-major terrain digits: per-tile vs word packing, native loader on 1 and N threads",
+				run_terrain_load},
+			{"overlays", "256 rooms of static structures + 40 creeps per tick: full matrix rebuilds vs sparse overlays, then 3-6 room searches",
+				run_overlays},
+			{"worlds", "many-room workload split over two worlds: one finder switching worlds vs a thread per world",
+				run_worlds},
+			{"parallel", "corner to corner, maxRooms 256, maxOps 1000000, weights 1.2 and 1.0: path_finder_t vs hash-distributed A* on 1 to N threads",
+				run_parallel},
+			{"portals", "corner to corner with four portal pairs linking distant rooms vs walking, weight 1.0",
+				run_portals},
+			{"mincut", "rampart min-cut around a base in every room, Dinic vs Edmonds-Karp reference",
+				run_min_cut},
+			{"flee", "flee range 15 from two threats, maxRooms 4",
+				[](bench_world_t& world, path_finder_t& pf, int iterations) {
+					return run_searches(pf, iterations, [&](std::vector<goal_t>& goals, search_options_native& options) {
+						int rx = 1 + world.rng()() % (world.size() - 2);
+						int ry = 1 + world.rng()() % (world.size() - 2);
+						world_position_t origin = world.random_pos(rx, ry);
+						goals.emplace_back(world_position_t(origin.xx + 2, origin.yy + 1), 15);
+						goals.emplace_back(world_position_t(origin.xx - 3, origin.yy), 12);
+						options.max_rooms = 4;
+						options.flee = true;
+						return origin;
+					});
+				}},
+		};
+	}
+
+	void print_totals(const scenario_t& scenario, const bench_totals_t& totals) {
+		double us_per_search = totals.searches ? totals.seconds * 1e6 / totals.searches : 0;
+		double ops_per_ms = totals.seconds > 0 ? totals.operations / (totals.seconds * 1e3) : 0;
+		std::printf("%-14s %8llu searches %10.2f us/search %10.1f ops/ms %9llu ops %9llu tiles\n",
+			scenario.name,
+			static_cast<unsigned long long>(totals.searches),
+			us_per_search,
+			ops_per_ms,
+			static_cast<unsigned long long>(totals.operations),
+			static_cast<unsigned long long>(totals.path_tiles));
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = 2000;
+	uint32_t seed = 1234;
+	const char* trace_path = nullptr;
+	std::vector<std::string> selected;
+	for (int ii = 1; ii < argc; ++ii) {
+		if (std::strcmp(argv[ii], "--iterations") == 0 && ii + 1 < argc) {
+			iterations = std::max(1, std::atoi(argv[++ii]));
+		} else if (std::strcmp(argv[ii], "--seed") == 0 && ii + 1 < argc) {
+			seed = static_cast<uint32_t>(std::strtoul(argv[++ii], nullptr, 10));
+		} else if (std::strcmp(argv[ii], "--trace") == 0 && ii + 1 < argc) {
+			trace_path = argv[++ii];
+		} else if (std::strcmp(argv[ii], "--help") == 0) {
+			std::printf("usage: %s [scenario ...] [--iterations N] [--seed N] [--trace FILE]\n\nscenarios:\n", argv[0]);
+			for (const auto& scenario : make_scenarios()) {
+				std::printf("  %-14s %s\n", scenario.name, scenario.description);
+			}
+			return 0;
+		} else {
+			selected.emplace_back(argv[ii]);
+		}
+	}
+
+	bench_world_t world(16, seed);
+	auto pf = std::make_unique<path_finder_t>();
+	int failed = 0;
+	for (const auto& scenario : make_scenarios()) {
+		if (!selected.empty() && std::find(selected.begin(), selected.end(), scenario.name) == selected.end()) {
+			continue;
+		}
+		bench_totals_t totals = scenario.run(world, *pf, iterations);
+		print_totals(scenario, totals);
+		if (totals.failures != 0) {
+			std::fprintf(stderr, "%s: %llu failed checks\n", scenario.name, static_cast<unsigned long long>(totals.failures));
+			++failed;
+		}
+	}
+
+	if (trace_path != nullptr) {
+		const trace_ring_t* trace = pf->expansion_trace();
+		if (trace == nullptr) {
+			std::fprintf(stderr, "--trace needs a build configured with -DSCREEPS_PATHFINDER_TRACE=ON\n");
+			return 1;
+		}
+		std::vector<uint8_t> dump(trace->dump_size());
+		trace->dump(dump.data(), dump.size());
+		FILE* file = std::fopen(trace_path, "wb");
+		if (file == nullptr || std::fwrite(dump.data(), 1, dump.size(), file) != dump.size()) {
+			std::fprintf(stderr, "could not write %s\n", trace_path);
+			return 1;
+		}
+		std::fclose(file);
+		std::printf("%zu trace events (%llu dropped) written to %s\n", trace->size(), static_cast<unsigned long long>(trace->dropped()), trace_path);
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+#include "cooperative.h"
+
+using namespace screeps;
+
+namespace {
+	constexpr unsigned k_size = room_grid_t::k_size;
+	constexpr int k_dx[9] = {0, 1, 1, 1, 0, -1, -1, -1, 0};
+	constexpr int k_dy[9] = {-1, -1, 0, 1, 1, 1, 0, -1, 0};
+
+	bool on_border(unsigned xx, unsigned yy) {
+		return xx == 0 || yy == 0 || xx == k_size - 1 || yy == k_size - 1;
+	}
+
+	world_position_t world_tile(map_position_t room, unsigned tile) {
+		return world_position_t(room.xx * k_size + tile / k_size, room.yy * k_size + tile % k_size);
+	}
+
+	// Lowest f first; among equal f the deeper state, which is closer to the goal
+	bool open_after(uint32_t f_a, uint32_t g_a, uint32_t f_b, uint32_t g_b) {
+		return f_a > f_b || (f_a == f_b && g_a < g_b);
+	}
+}
+
+	uint32_t reservation_table_t::holder(world_position_t pos, uint32_t tick) const {
+		if (tick < now || tick >= now + k_window) {
+			return k_none;
+		}
+		const slot_t& slot = slots[tick % k_window];
+		if (slot.tick != tick || slot.count == 0) {
+			return k_none;
+		}
+		size_t mask = slot.entries.size() - 1;
+		for (size_t ii = bucket(pos.id, slot.entries.size());; ii = (ii + 1) & mask) {
+			if (slot.entries[ii].key == pos.id) {
+				return slot.entries[ii].agent;
+			} else if (slot.entries[ii].key == k_empty) {
+				return k_none;
+			}
+		}
+	}
+
+	bool reservation_table_t::claim(world_position_t pos, uint32_t tick, uint32_t agent) {
+		if (tick < now || tick >= now + k_window) {
+			return false;
+		}
+		slot_t& slot = slots[tick % k_window];
+		if (slot.tick != tick) {
+			// The slot still holds an expired tick; recycle it
+			if (slot.entries.empty()) {
+				slot.entries.resize(k_initial_capacity);
+			}
+			std::fill(slot.entries.begin(), slot.entries.end(), claim_t{k_empty, k_none});
+			slot.count = 0;
+			slot.tick = tick;
+		}
+		uint32_t current = holder(pos, tick);
+		if (current != k_none) {
+			return current == agent;
+		}
+		if ((slot.count + 1) * 2 > slot.entries.size()) {
+			std::vector<claim_t> previous(slot.entries.size() * 2, claim_t{k_empty, k_none});
+			previous.swap(slot.entries);
+			slot.count = 0;
+			for (const claim_t& entry : previous) {
+				if (entry.key != k_empty) {
+					insert(slot, entry);
+				}
+			}
+		}
+		insert(slot, claim_t{pos.id, agent});
+		return true;
+	}
+
+	void reservation_table_t::insert(slot_t& slot, claim_t claim) {
+		size_t mask = slot.entries.size() - 1;
+		size_t ii = bucket(claim.key, slot.entries.size());
+		while (slot.entries[ii].key != k_empty) {
+			ii = (ii + 1) & mask;
+		}
+		slot.entries[ii] = claim;
+		++slot.count;
+	}
+
+	bool cooperative_planner_t::plan(
+		const world_t& world,
+		map_position_t room,
+		const uint8_t* cost_matrix,
+		const cooperative_agent_t* agents,
+		size_t count,
+		const cooperative_options_t& options,
+		reservation_table_t& reservations,
+		room_tile_t* steps,
+		int* step_counts
+	) {
+		const uint8_t* terrain = world.room_terrain(room);
+		if (terrain == nullptr || !grid.load(world, room, cost_matrix)) {
+			return false;
+		}
+		unsigned window = std::clamp<unsigned>(options.window, 1, reservation_table_t::k_window - 1);
+		cost_t min_cost = std::numeric_limits<cost_t>::max();
+		for (unsigned tile = 0; tile < k_tiles; ++tile) {
+			uint8_t cost = cost_matrix == nullptr ? 0 : cost_matrix[tile];
+			if (cost == 0) {
+				tile_cost[tile] = (terrain[tile / 4] >> (tile % 4 * 2)) & 2 ? options.swamp_cost : options.plain_cost;
+			} else {
+				tile_cost[tile] = cost;
+			}
+			if (grid.walkable(tile / k_size, tile % k_size)) {
+				min_cost = std::min(min_cost, tile_cost[tile]);
+			}
+		}
+
+		// Earlier plans of this batch's agents are replaced, everyone else's claims stay
+		batch_ids.clear();
+		for (size_t ii = 0; ii < count; ++ii) {
+			batch_ids.push_back(agents[ii].id);
+		}
+		std::sort(batch_ids.begin(), batch_ids.end());
+		reservations.release_if([&](uint32_t agent) {
+			return std::binary_search(batch_ids.begin(), batch_ids.end(), agent);
+		});
+		for (size_t ii = 0; ii < count; ++ii) {
+			const room_tile_t& origin = agents[ii].origin;
+			reservations.claim(world_tile(room, origin.xx * k_size + origin.yy), reservations.tick(), agents[ii].id);
+		}
+
+		order.resize(count);
+		for (size_t ii = 0; ii < count; ++ii) {
+			order[ii] = static_cast<uint32_t>(ii);
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t left, uint32_t right) {
+			return agents[left].priority < agents[right].priority;
+		});
+		for (uint32_t index : order) {
+			step_counts[index] = plan_agent(room, agents[index], window, min_cost, reservations, steps + size_t(index) * window);
+		}
+		return true;
+	}
+
+	int cooperative_planner_t::plan_agent(
+		map_position_t room,
+		const cooperative_agent_t& agent,
+		unsigned window,
+		cost_t min_cost,
+		reservation_table_t& reservations,
+		room_tile_t* steps
+	) {
+		const uint32_t now = reservations.tick();
+		const uint32_t origin = agent.origin.xx * k_size + agent.origin.yy;
+
+		room_tile_t sources[k_tiles];
+		size_t source_count = 0;
+		for (int xx = std::max(0, agent.goal.xx - agent.range); xx <= std::min<int>(k_size - 1, agent.goal.xx + agent.range); ++xx) {
+			for (int yy = std::max(0, agent.goal.yy - agent.range); yy <= std::min<int>(k_size - 1, agent.goal.yy + agent.range); ++yy) {
+				if (grid.walkable(xx, yy)) {
+					sources[source_count++] = room_tile_t{static_cast<uint8_t>(xx), static_cast<uint8_t>(yy)};
+				}
+			}
+		}
+		grid.flood_fill(sources, source_count, room_grid_t::k_unreached - 1, goal_distance);
+		if (goal_distance[origin] == room_grid_t::k_unreached) {
+			reservations.claim(world_tile(room, origin), now + 1, agent.id);
+			return -1;
+		}
+
+		if (g_costs.empty()) {
+			g_costs.resize(k_states);
+			parents.resize(k_states);
+			stamps.resize(k_states, 0);
+		}
+		search_id += 2;
+		if (search_id == 0) {
+			std::fill(stamps.begin(), stamps.end(), 0);
+			search_id = 2;
+		}
+		const uint32_t opened = search_id;
+		const uint32_t closed = search_id + 1;
+
+		auto heap_order = [](const open_t& left, const open_t& right) {
+			return open_after(left.f_cost, left.g_cost, right.f_cost, right.g_cost);
+		};
+		open.clear();
+		g_costs[origin] = 0;
+		stamps[origin] = opened;
+		open.push_back(open_t{goal_distance[origin] * min_cost, 0, origin});
+
+		uint32_t terminal = std::numeric_limits<uint32_t>::max();
+		while (!open.empty()) {
+			std::pop_heap(open.begin(), open.end(), heap_order);
+			open_t current = open.back();
+			open.pop_back();
+			if (stamps[current.state] == closed || current.g_cost != g_costs[current.state]) {
+				continue;
+			}
+			stamps[current.state] = closed;
+			uint32_t tick = current.state / k_tiles;
+			uint32_t tile = current.state % k_tiles;
+			world_position_t pos = world_tile(room, tile);
+
+			if (goal_distance[tile] == 0) {
+				// Parking on the goal only works if nobody passes through it later in the window
+				bool free = true;
+				for (uint32_t later = tick + 1; later <= window && free; ++later) {
+					uint32_t holder = reservations.holder(pos, now + later);
+					free = holder == reservation_table_t::k_none || holder == agent.id;
+				}
+				if (free) {
+					terminal = current.state;
+					break;
+				}
+			}
+			if (tick == window) {
+				terminal = current.state;
+				break;
+			}
+
+			for (uint32_t move = 0; move <= k_wait_move; ++move) {
+				int nx = int(tile / k_size) + k_dx[move];
+				int ny = int(tile % k_size) + k_dy[move];
+				if (nx < 0 || ny < 0 || nx >= int(k_size) || ny >= int(k_size) || !grid.walkable(nx, ny)) {
+					continue;
+				}
+				uint32_t next = nx * k_size + ny;
+				if (goal_distance[next] == room_grid_t::k_unreached || (move != k_wait_move && goal_distance[next] != 0 && on_border(nx, ny))) {
+					continue;
+				}
+				world_position_t next_pos = world_tile(room, next);
+				uint32_t holder = reservations.holder(next_pos, now + tick + 1);
+				if (holder != reservation_table_t::k_none && holder != agent.id) {
+					continue;
+				}
+				if (move != k_wait_move) {
+					// Two agents trading tiles would pass through each other
+					uint32_t occupant = reservations.holder(next_pos, now + tick);
+					if (occupant != reservation_table_t::k_none && occupant != agent.id && reservations.holder(pos, now + tick + 1) == occupant) {
+						continue;
+					}
+				}
+				uint32_t state = (tick + 1) * k_tiles + next;
+				uint32_t g_cost = current.g_cost + (move == k_wait_move ? min_cost : tile_cost[next]);
+				if (stamps[state] == closed || (stamps[state] == opened && g_costs[state] <= g_cost)) {
+					continue;
+				}
+				stamps[state] = opened;
+				g_costs[state] = g_cost;
+				parents[state] = current.state;
+				open.push_back(open_t{g_cost + goal_distance[next] * min_cost, g_cost, state});
+				std::push_heap(open.begin(), open.end(), heap_order);
+			}
+		}
+
+		if (terminal == std::numeric_limits<uint32_t>::max()) {
+			// Boxed in for the whole window; stay put and let later agents avoid this tile if possible
+			reservations.claim(world_tile(room, origin), now + 1, agent.id);
+			return -1;
+		}
+
+		uint32_t length = terminal / k_tiles;
+		for (uint32_t state = terminal; state / k_tiles > 0; state = parents[state]) {
+			uint32_t tile = state % k_tiles;
+			steps[state / k_tiles - 1] = room_tile_t{static_cast<uint8_t>(tile / k_size), static_cast<uint8_t>(tile % k_size)};
+			reservations.claim(world_tile(room, tile), now + state / k_tiles, agent.id);
+		}
+		world_position_t parked = world_tile(room, terminal % k_tiles);
+		for (uint32_t later = length + 1; later <= window; ++later) {
+			reservations.claim(parked, now + later, agent.id);
+		}
+		return static_cast<int>(length);
+	}
@@ -0,0 +1,165 @@
+#pragma once
+#include "pf.h"
+#include "room_analysis.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// Shared (tile, tick) claims for cooperative planning. Each of the k_window ticks starting at the
+	// current tick has its own open-addressed table keyed by world position; tables are recycled
+	// lazily as ticks advance, so claims expire without any sweep.
+	class reservation_table_t {
+		public:
+			static constexpr uint32_t k_window = 64;
+			static constexpr uint32_t k_none = std::numeric_limits<uint32_t>::max();
+
+			// Moves the current tick forward; claims on earlier ticks are dropped
+			void advance(uint32_t tick) {
+				now = std::max(now, tick);
+			}
+
+			uint32_t tick() const {
+				return now;
+			}
+
+			// Agent holding `pos` on `tick`, or k_none
+			uint32_t holder(world_position_t pos, uint32_t tick) const;
+
+			// Claims `pos` on `tick` for `agent`. Fails when the tick is outside the window or another
+			// agent holds the tile.
+			bool claim(world_position_t pos, uint32_t tick, uint32_t agent);
+
+			// Drops every live claim whose agent matches `pred`
+			template <class pred_t>
+			void release_if(pred_t pred) {
+				for (uint32_t tick = now; tick < now + k_window; ++tick) {
+					slot_t& slot = slots[tick % k_window];
+					if (slot.tick != tick || slot.count == 0) {
+						continue;
+					}
+					retained.clear();
+					for (const claim_t& entry : slot.entries) {
+						if (entry.key != k_empty && !pred(entry.agent)) {
+							retained.push_back(entry);
+						}
+					}
+					if (retained.size() == slot.count) {
+						continue;
+					}
+					std::fill(slot.entries.begin(), slot.entries.end(), claim_t{k_empty, k_none});
+					slot.count = 0;
+					for (const claim_t& entry : retained) {
+						insert(slot, entry);
+					}
+				}
+			}
+
+			void clear() {
+				for (slot_t& slot : slots) {
+					slot.tick = k_none;
+				}
+			}
+
+		private:
+			static constexpr uint32_t k_empty = std::numeric_limits<uint32_t>::max();
+			static constexpr size_t k_initial_capacity = 64;
+
+			struct claim_t {
+				uint32_t key; // world_position_t::id, k_empty for a free entry
+				uint32_t agent;
+			};
+
+			struct slot_t {
+				std::vector<claim_t> entries; // power-of-two sized, at most half full
+				size_t count = 0;
+				uint32_t tick = k_none;
+			};
+
+			std::array<slot_t, k_window> slots;
+			std::vector<claim_t> retained;
+			uint32_t now = 0;
+
+			static size_t bucket(uint32_t key, size_t capacity) {
+				return (key * uint64_t(0x9e3779b1) >> 16) & (capacity - 1);
+			}
+			static void insert(slot_t& slot, claim_t claim);
+	};
+
+	// One agent of a cooperative batch. Tiles are local to the planned room.
+	struct cooperative_agent_t {
+		uint32_t id; // stable across ticks; replanning an agent replaces its earlier claims
+		room_tile_t origin;
+		room_tile_t goal;
+		uint8_t range;
+		int32_t priority; // lower values plan first and get first pick of the tiles
+	};
+
+	struct cooperative_options_t {
+		unsigned window = 16; // ticks planned per agent, at most reservation_table_t::k_window - 1
+		cost_t plain_cost = 1;
+		cost_t swamp_cost = 5;
+	};
+
+	//
+	// Windowed cooperative A* for the creeps of one room. Agents are planned one at a time in priority
+	// order through (tile, tick) space: each step moves to a neighbouring tile or waits, and may not
+	// enter a tile another agent holds on that tick or swap places with it. Every plan is claimed in
+	// the reservation table before the next agent runs, so later agents route around earlier ones.
+	//
+	// The heuristic is the exact walking distance to the goal ignoring other agents (a flood fill
+	// from the goal), scaled by the cheapest step cost. Searches end at the goal once the goal tile
+	// stays free for the rest of the window, or at the window horizon with the lowest estimated
+	// total. Room exits are only entered when they are within range of the goal.
+	class cooperative_planner_t {
+		public:
+			// Plans every agent for `options.window` ticks after the reservation table's current tick.
+			// `steps` receives `window` tiles per agent (tile of tick now + 1 first) and `step_counts`
+			// the number used: fewer than `window` when the goal is reached early (the agent then waits
+			// there), -1 when the agent cannot move without a collision. Returns false when the room has
+			// no terrain loaded.
+			bool plan(
+				const world_t& world,
+				map_position_t room,
+				const uint8_t* cost_matrix,
+				const cooperative_agent_t* agents,
+				size_t count,
+				const cooperative_options_t& options,
+				reservation_table_t& reservations,
+				room_tile_t* steps,
+				int* step_counts);
+
+		private:
+			static constexpr uint32_t k_tiles = room_grid_t::k_size * room_grid_t::k_size;
+			static constexpr uint32_t k_states = k_tiles * reservation_table_t::k_window;
+			static constexpr uint32_t k_wait_move = 8;
+
+			struct open_t {
+				uint32_t f_cost;
+				uint32_t g_cost;
+				uint32_t state; // tick * k_tiles + tile
+			};
+
+			room_grid_t grid;
+			cost_t tile_cost[k_tiles];
+			uint8_t goal_distance[k_tiles];
+			std::vector<uint32_t> g_costs;
+			std::vector<uint32_t> parents;
+			std::vector<uint32_t> stamps; // search id that last opened the state; closed states are odd
+			uint32_t search_id = 0;
+			std::vector<open_t> open;
+			std::vector<uint32_t> order;
+			std::vector<uint32_t> batch_ids;
+
+			int plan_agent(
+				map_position_t room,
+				const cooperative_agent_t& agent,
+				unsigned window,
+				cost_t min_cost,
+				reservation_table_t& reservations,
+				room_tile_t* steps);
+	};
+}
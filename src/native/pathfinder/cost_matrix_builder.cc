@@ -0,0 +1,51 @@
+#include "cost_matrix_builder.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace screeps;
+
+	void cost_matrix_builder_t::build(
+		const room_object_t* objects,
+		size_t count,
+		const cost_matrix_profile_t& profile,
+		const uint8_t* base,
+		uint8_t* out
+	) {
+		if (base == nullptr) {
+			std::memset(out, 0, k_matrix_bytes);
+		} else if (base != out) {
+			std::memcpy(out, base, k_matrix_bytes);
+		}
+
+		// Value per (kind, mine); kinds past the table are ignored
+		const uint8_t values[][2] = {
+			{profile.road, profile.road},
+			{profile.hostile_site, profile.own_site},
+			{profile.hostile_rampart, profile.own_rampart},
+			{profile.blocking, profile.blocking},
+			{profile.hostile_creep, profile.own_creep},
+		};
+		constexpr size_t kind_count = sizeof(values) / sizeof(values[0]);
+
+		// Single scatter pass: each tile remembers the highest layer written to it, so objects may come
+		// in any order. Layer 0 is the base.
+		uint8_t layer[k_matrix_bytes];
+		std::memset(layer, 0, sizeof(layer));
+		for (size_t ii = 0; ii < count; ++ii) {
+			const room_object_t& object = objects[ii];
+			size_t kind = static_cast<size_t>(object.kind);
+			if (object.xx >= 50 || object.yy >= 50 || kind >= kind_count) {
+				continue;
+			}
+			uint8_t value = values[kind][object.flags & k_object_mine];
+			if (value == 0) {
+				continue;
+			}
+			unsigned tile = object.xx * 50 + object.yy;
+			uint8_t rank = static_cast<uint8_t>(kind + 1);
+			if (out[tile] != k_blocked && (value == k_blocked || layer[tile] <= rank)) {
+				out[tile] = value;
+			}
+			layer[tile] = std::max(layer[tile], rank);
+		}
+	}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace screeps {
+
+	enum class room_object_kind : uint8_t {
+		Road = 0,
+		ConstructionSite,
+		Rampart,
+		Blocking, // any structure creeps cannot walk through
+		Creep // creeps and power creeps
+	};
+
+	// One room object to fold into a cost matrix. Tiles are local to the room.
+	struct room_object_t {
+		uint8_t xx;
+		uint8_t yy;
+		room_object_kind kind;
+		uint8_t flags; // k_object_mine when the object belongs to the player searching
+	};
+
+	constexpr uint8_t k_object_mine = 1;
+
+	//
+	// Matrix value per object kind and ownership. 0 leaves the tile as the layers below set it, so an
+	// own rampart over a road keeps the road cost; 255 blocks the tile for good.
+	struct cost_matrix_profile_t {
+		uint8_t road = 1;
+		uint8_t own_site = 0;
+		uint8_t hostile_site = 0;
+		uint8_t own_rampart = 0;
+		uint8_t hostile_rampart = 255;
+		uint8_t blocking = 255;
+		uint8_t own_creep = 255;
+		uint8_t hostile_creep = 255;
+	};
+
+	//
+	// Builds room cost matrices ([x * 50 + y], the layout look() reads) from typed object lists instead
+	// of per-object callback code. Objects apply in layers -- roads, construction sites, ramparts,
+	// blocking structures, creeps -- so a later layer overrides an earlier one on the same tile, except
+	// that a blocked tile stays blocked. The result does not depend on the order of `objects`.
+	//
+	// Static layers (structures) can be built once and passed back as `base` for the per-tick layers.
+	class cost_matrix_builder_t {
+		public:
+			static constexpr size_t k_matrix_bytes = 2500;
+			static constexpr uint8_t k_blocked = 255;
+
+			// Writes `base` (zeros when nullptr) plus `objects` into `out`. `base` may be `out` to update
+			// a matrix in place. Objects outside the room are skipped.
+			static void build(
+				const room_object_t* objects,
+				size_t count,
+				const cost_matrix_profile_t& profile,
+				const uint8_t* base,
+				uint8_t* out);
+	};
+}
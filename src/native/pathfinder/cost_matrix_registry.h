@@ -0,0 +1,123 @@
+#pragma once
+#include "pf.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace screeps {
+
+	struct cost_override_t {
+		uint8_t xx;
+		uint8_t yy;
+		uint8_t cost;
+	};
+
+	//
+	// Cost matrices registered per room ahead of time, so bulk operations can use them without a room
+	// callback round trip. Matrices are copied in; layout and rules match the search ([x * 50 + y],
+	// nonzero overrides terrain, 255 blocks).
+	//
+	// Each room may also carry a sparse overlay of tile costs for what changes every tick (creeps). It
+	// is replaced in O(entries) and only laid over the matrix when a search composes the room.
+	class cost_matrix_registry_t {
+		public:
+			static constexpr size_t k_matrix_bytes = 2500;
+
+			cost_matrix_registry_t() : matrices(size_t(1) << sizeof(map_position_t) * 8) {}
+
+			// Copies `matrix` for `room`; nullptr removes the room's matrix
+			void set(map_position_t room, const uint8_t* matrix) {
+				std::unique_ptr<uint8_t[]>& slot = matrices[room.id];
+				if (matrix == nullptr) {
+					if (slot != nullptr) {
+						slot.reset();
+						rooms.erase(std::find(rooms.begin(), rooms.end(), room.id));
+					}
+					return;
+				}
+				if (slot == nullptr) {
+					slot.reset(new uint8_t[k_matrix_bytes]);
+					rooms.push_back(room.id);
+				}
+				std::memcpy(slot.get(), matrix, k_matrix_bytes);
+			}
+
+			// Writable matrix of `room`, registered zero-filled when the room has none yet
+			uint8_t* edit(map_position_t room) {
+				std::unique_ptr<uint8_t[]>& slot = matrices[room.id];
+				if (slot == nullptr) {
+					slot.reset(new uint8_t[k_matrix_bytes]());
+					rooms.push_back(room.id);
+				}
+				return slot.get();
+			}
+
+			// Registered matrix of `room`, nullptr when it has none
+			const uint8_t* get(map_position_t room) const {
+				return matrices[room.id].get();
+			}
+
+			void clear() {
+				for (uint16_t id : rooms) {
+					matrices[id].reset();
+				}
+				rooms.clear();
+			}
+
+			// Replaces the overlay of `room`; an empty list removes it. Entries outside the room are
+			// dropped.
+			void set_overlay(map_position_t room, const cost_override_t* entries, size_t count) {
+				std::vector<cost_override_t>& overlay = overlays[room.id];
+				overlay.clear();
+				for (size_t ii = 0; ii < count; ++ii) {
+					if (entries[ii].xx < 50 && entries[ii].yy < 50) {
+						overlay.push_back(entries[ii]);
+					}
+				}
+			}
+
+			bool has_overlay(map_position_t room) const {
+				auto overlay = overlays.find(room.id);
+				return overlay != overlays.end() && !overlay->second.empty();
+			}
+
+			// Drops every overlay; their storage is kept for the next tick
+			void clear_overlays() {
+				for (auto& overlay : overlays) {
+					overlay.second.clear();
+				}
+			}
+
+			// Writes the matrix a search sees for `room` into `out`: `base`, or the registered matrix
+			// (zeros without one) when `base` is null, then the overlay unless `include_overlay` is
+			// false. As with the builder, 255 is never lowered.
+			void compose(map_position_t room, const uint8_t* base, bool include_overlay, uint8_t* out) const {
+				if (base == nullptr) {
+					base = get(room);
+				}
+				if (base == nullptr) {
+					std::memset(out, 0, k_matrix_bytes);
+				} else {
+					std::memcpy(out, base, k_matrix_bytes);
+				}
+				auto overlay = overlays.find(room.id);
+				if (!include_overlay || overlay == overlays.end()) {
+					return;
+				}
+				for (const cost_override_t& entry : overlay->second) {
+					uint8_t& cost = out[entry.xx * 50 + entry.yy];
+					if (cost != 255) {
+						cost = entry.cost;
+					}
+				}
+			}
+
+		private:
+			std::vector<std::unique_ptr<uint8_t[]>> matrices;
+			std::vector<uint16_t> rooms;
+			std::unordered_map<uint16_t, std::vector<cost_override_t>> overlays;
+	};
+}
@@ -0,0 +1,173 @@
+#include "landmarks.h"
+#include "precompute_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace screeps;
+
+namespace {
+	constexpr unsigned k_size = 50;
+	constexpr unsigned k_tiles = landmark_tables_t::k_tiles;
+	constexpr uint16_t k_unreached = landmark_tables_t::k_unreached;
+	constexpr unsigned k_ring = 64; // longer than the longest edge, an exit-to-exit range of 49
+
+	struct room_graph_t {
+		bool walkable[k_tiles];
+		std::vector<uint16_t> exits;
+	};
+
+	bool on_border(unsigned xx, unsigned yy) {
+		return xx == 0 || yy == 0 || xx == k_size - 1 || yy == k_size - 1;
+	}
+
+	unsigned tile_range(uint16_t left, uint16_t right) {
+		return std::max(std::abs(int(left / k_size) - int(right / k_size)), std::abs(int(left % k_size) - int(right % k_size)));
+	}
+
+	//
+	// Dial's algorithm: steps cost 1 and exit-to-exit edges at most 49, so a ring of buckets indexed
+	// by distance replaces the heap
+	class distance_search_t {
+		public:
+			explicit distance_search_t(const room_graph_t& graph) : graph(graph) {}
+
+			void run(uint16_t source, uint16_t* dist) {
+				std::fill(dist, dist + k_tiles, k_unreached);
+				pending = 0;
+				relax(dist, source, 0);
+				for (unsigned level = 0; pending != 0; ++level) {
+					std::vector<uint16_t>& bucket = ring[level % k_ring];
+					for (size_t ii = 0; ii < bucket.size(); ++ii) {
+						uint16_t tile = bucket[ii];
+						if (dist[tile] != level) {
+							continue; // superseded by a shorter distance
+						}
+						int xx = tile / k_size;
+						int yy = tile % k_size;
+						for (int dx = -1; dx <= 1; ++dx) {
+							for (int dy = -1; dy <= 1; ++dy) {
+								int nx = xx + dx;
+								int ny = yy + dy;
+								if ((dx != 0 || dy != 0) && nx >= 0 && ny >= 0 && nx < int(k_size) && ny < int(k_size) && graph.walkable[nx * k_size + ny]) {
+									relax(dist, static_cast<uint16_t>(nx * k_size + ny), level + 1);
+								}
+							}
+						}
+						if (on_border(xx, yy)) {
+							for (uint16_t exit : graph.exits) {
+								relax(dist, exit, level + tile_range(tile, exit));
+							}
+						}
+					}
+					pending -= bucket.size();
+					bucket.clear();
+				}
+			}
+
+		private:
+			const room_graph_t& graph;
+			std::vector<uint16_t> ring[k_ring];
+			size_t pending = 0;
+
+			void relax(uint16_t* dist, uint16_t tile, unsigned distance) {
+				if (distance < dist[tile]) {
+					dist[tile] = static_cast<uint16_t>(distance);
+					ring[distance % k_ring].push_back(tile);
+					++pending;
+				}
+			}
+	};
+}
+
+	void landmark_tables_t::build(const uint8_t* const* terrain, size_t room_slots, unsigned landmarks, unsigned threads, precompute_cache_t* cache) {
+		clear();
+		if (landmarks == 0) {
+			return;
+		}
+		count = std::min(landmarks, k_max_landmarks);
+		if (tables.size() < room_slots) {
+			tables.resize(room_slots);
+		}
+		const size_t table_bytes = k_tiles * count * sizeof(uint16_t);
+		std::vector<uint16_t> pending;
+		for (size_t id = 0; id < room_slots; ++id) {
+			if (terrain[id] != nullptr) {
+				tables[id].reset(new uint16_t[k_tiles * count]);
+				rooms.push_back(static_cast<uint16_t>(id));
+				const uint8_t* stored = cache == nullptr ? nullptr : cache->find(terrain[id], precompute_cache_t::table_kind::Landmarks, static_cast<uint16_t>(count), table_bytes);
+				if (stored != nullptr) {
+					std::memcpy(tables[id].get(), stored, table_bytes);
+					++cached;
+				} else {
+					pending.push_back(static_cast<uint16_t>(id));
+				}
+			}
+		}
+
+		// Rooms are independent; workers pull the next one from a shared counter
+		std::atomic<size_t> next{0};
+		auto work = [&]() {
+			for (size_t ii = next++; ii < pending.size(); ii = next++) {
+				build_room(terrain[pending[ii]], count, tables[pending[ii]].get());
+			}
+		};
+		threads = std::clamp<unsigned>(threads, 1, std::max<size_t>(pending.size(), 1));
+		std::vector<std::thread> workers;
+		for (unsigned ii = 1; ii < threads; ++ii) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		if (cache != nullptr) {
+			for (uint16_t id : pending) {
+				cache->store(terrain[id], precompute_cache_t::table_kind::Landmarks, static_cast<uint16_t>(count), tables[id].get(), table_bytes);
+			}
+		}
+	}
+
+	void landmark_tables_t::build_room(const uint8_t* terrain, unsigned landmarks, uint16_t* out) {
+		room_graph_t graph;
+		for (unsigned tile = 0; tile < k_tiles; ++tile) {
+			graph.walkable[tile] = ((terrain[tile / 4] >> (tile % 4 * 2)) & 1) == 0;
+			if (graph.walkable[tile] && on_border(tile / k_size, tile % k_size)) {
+				graph.exits.push_back(static_cast<uint16_t>(tile));
+			}
+		}
+
+		// Farthest-point sampling, seeded from the walkable tile nearest the middle of the room
+		distance_search_t search(graph);
+		uint16_t dist[k_tiles];
+		uint16_t nearest[k_tiles]; // distance to the closest landmark picked so far
+		uint16_t seed = k_unreached;
+		unsigned seed_range = k_size;
+		for (unsigned tile = 0; tile < k_tiles; ++tile) {
+			unsigned range = tile_range(static_cast<uint16_t>(tile), 25 * k_size + 25);
+			if (graph.walkable[tile] && range < seed_range) {
+				seed = static_cast<uint16_t>(tile);
+				seed_range = range;
+			}
+		}
+		if (seed == k_unreached) {
+			std::fill(out, out + k_tiles * landmarks, k_unreached);
+			return;
+		}
+		search.run(seed, nearest);
+		for (unsigned landmark = 0; landmark < landmarks; ++landmark) {
+			uint16_t farthest = seed;
+			for (unsigned tile = 0; tile < k_tiles; ++tile) {
+				if (nearest[tile] != k_unreached && nearest[tile] > nearest[farthest]) {
+					farthest = static_cast<uint16_t>(tile);
+				}
+			}
+			search.run(farthest, dist);
+			for (unsigned tile = 0; tile < k_tiles; ++tile) {
+				out[tile * landmarks + landmark] = dist[tile];
+				nearest[tile] = landmark == 0 ? dist[tile] : std::min(nearest[tile], dist[tile]);
+			}
+		}
+	}
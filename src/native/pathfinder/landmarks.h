@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace screeps {
+
+	class precompute_cache_t;
+
+	//
+	// Terrain-only distances from a few landmark tiles in each room, for the ALT (A*, landmarks,
+	// triangle inequality) heuristic. Landmarks are picked by farthest-point sampling, so they sit in
+	// the far corners and dead ends a Chebyshev estimate knows nothing about.
+	//
+	// Distances are walking steps over the room's walkable tiles, plus a direct edge between every
+	// two exit tiles as long as their range: any detour through other rooms is at least that long.
+	// They therefore never exceed true walking distances, which keeps the triangle bounds admissible
+	// for tiles of the same room no matter what lies outside it.
+	class landmark_tables_t {
+		public:
+			static constexpr unsigned k_max_landmarks = 8;
+			static constexpr unsigned k_tiles = 2500;
+			static constexpr uint16_t k_unreached = 0xffff;
+
+			// Builds `landmarks` landmarks per room for every room id below `room_slots` whose terrain
+			// (2 bits per tile, as path_finder_t stores it) is non-null. Rooms are split across `threads`
+			// worker threads. With a cache, rooms whose terrain it holds are copied from it and the rest
+			// are stored into it.
+			void build(const uint8_t* const* terrain, size_t room_slots, unsigned landmarks, unsigned threads, precompute_cache_t* cache = nullptr);
+
+			void clear() {
+				for (uint16_t id : rooms) {
+					tables[id].reset();
+				}
+				rooms.clear();
+				count = 0;
+				cached = 0;
+			}
+
+			unsigned landmark_count() const {
+				return count;
+			}
+
+			// Distances for a room laid out [tile * landmark_count() + landmark], tile = x * 50 + y;
+			// nullptr when the room has no table
+			const uint16_t* room(uint16_t id) const {
+				return id < tables.size() ? tables[id].get() : nullptr;
+			}
+
+			size_t memory_bytes() const {
+				return rooms.size() * k_tiles * count * sizeof(uint16_t);
+			}
+
+			// Rooms of the last build taken from the cache, and computed
+			size_t cached_rooms() const {
+				return cached;
+			}
+
+			size_t computed_rooms() const {
+				return rooms.size() - cached;
+			}
+
+		private:
+			std::vector<std::unique_ptr<uint16_t[]>> tables;
+			std::vector<uint16_t> rooms;
+			unsigned count = 0;
+			size_t cached = 0;
+
+			static void build_room(const uint8_t* terrain, unsigned landmarks, uint16_t* out);
+	};
+}
@@ -0,0 +1,127 @@
+#include "learned_heuristic.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace screeps;
+
+	const uint16_t* learned_table_t::room(uint16_t id) const {
+		auto it = std::lower_bound(rooms.begin(), rooms.end(), id, [](const room_bounds_t& room, uint16_t id) {
+			return room.id < id;
+		});
+		return it != rooms.end() && it->id == id ? it->grid.get() : nullptr;
+	}
+
+	void learned_heuristics_t::set_capacity(size_t room_grids) {
+		std::lock_guard<std::mutex> lock(mutex);
+		capacity = room_grids;
+		if (capacity == 0) {
+			tables.clear();
+			grid_count = 0;
+		} else {
+			evict(nullptr, 0);
+		}
+	}
+
+	std::shared_ptr<const learned_table_t> learned_heuristics_t::find(const learned_key_t& key) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = tables.find(key);
+		if (it == tables.end()) {
+			return nullptr;
+		}
+		it->second.last_used = ++clock;
+		return it->second.table;
+	}
+
+	void learned_heuristics_t::learn(const learned_key_t& key, uint32_t final_cost, learned_sample_t* samples, size_t count) {
+		auto room_of = [](const learned_sample_t& sample) {
+			return learned_table_t::room_id(sample.xx, sample.yy);
+		};
+		std::sort(samples, samples + count, [&](const learned_sample_t& left, const learned_sample_t& right) {
+			return room_of(left) < room_of(right);
+		});
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (capacity == 0) {
+			return;
+		}
+		entry_t& entry = tables[key];
+		entry.last_used = ++clock;
+		auto table = std::make_shared<learned_table_t>();
+		if (entry.table != nullptr) {
+			table->rooms = entry.table->rooms;
+		}
+
+		// Each touched room gets a fresh grid: searches still reading the old table keep theirs intact
+		for (size_t first = 0; first < count;) {
+			uint16_t id = room_of(samples[first]);
+			size_t last = first;
+			while (last < count && room_of(samples[last]) == id) {
+				++last;
+			}
+			auto it = std::lower_bound(table->rooms.begin(), table->rooms.end(), id, [](const learned_table_t::room_bounds_t& room, uint16_t id) {
+				return room.id < id;
+			});
+			bool existing = it != table->rooms.end() && it->id == id;
+			if (!existing && grid_count >= capacity) {
+				evict(&key, 1);
+				if (grid_count >= capacity) {
+					// This goal alone fills the cap
+					first = last;
+					continue;
+				}
+			}
+			std::shared_ptr<uint16_t[]> grid(new uint16_t[learned_table_t::k_tiles]);
+			if (existing) {
+				std::memcpy(grid.get(), it->grid.get(), learned_table_t::k_tiles * sizeof(uint16_t));
+			} else {
+				std::memset(grid.get(), 0, learned_table_t::k_tiles * sizeof(uint16_t));
+			}
+			for (size_t ii = first; ii < last; ++ii) {
+				const learned_sample_t& sample = samples[ii];
+				if (sample.g_cost > final_cost) {
+					continue;
+				}
+				// Clamping down keeps the bound a bound
+				uint16_t bound = static_cast<uint16_t>(std::min<uint32_t>(final_cost - sample.g_cost, std::numeric_limits<uint16_t>::max()));
+				uint16_t& cell = grid[(sample.xx % 50) * 50 + sample.yy % 50];
+				cell = std::max(cell, bound);
+			}
+			if (existing) {
+				it->grid = std::move(grid);
+			} else {
+				table->rooms.insert(it, learned_table_t::room_bounds_t{id, std::move(grid)});
+				++grid_count;
+			}
+			first = last;
+		}
+		entry.table = std::move(table);
+	}
+
+	void learned_heuristics_t::clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		tables.clear();
+		grid_count = 0;
+	}
+
+	size_t learned_heuristics_t::room_grids() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return grid_count;
+	}
+
+	// Drops least recently used goals other than `keep` until `needed` more grids fit the capacity
+	void learned_heuristics_t::evict(const learned_key_t* keep, size_t needed) {
+		while (grid_count + needed > capacity) {
+			auto oldest = tables.end();
+			for (auto it = tables.begin(); it != tables.end(); ++it) {
+				if ((keep == nullptr || !(it->first == *keep)) && (oldest == tables.end() || it->second.last_used < oldest->second.last_used)) {
+					oldest = it;
+				}
+			}
+			if (oldest == tables.end()) {
+				return;
+			}
+			grid_count -= oldest->second.table == nullptr ? 0 : oldest->second.table->room_count();
+			tables.erase(oldest);
+		}
+	}
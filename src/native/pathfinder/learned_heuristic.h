@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// What a learned table was learned for. Searches only share a table when all of these match: the
+	// same goal and costs, the same room limit, the same versions of the world's registered cost
+	// matrices and overlays, and the same caller-supplied version of whatever else the room callback
+	// hands out.
+	struct learned_key_t {
+		uint16_t goal_xx; // world coordinates
+		uint16_t goal_yy;
+		uint32_t range;
+		uint32_t plain_cost;
+		uint32_t swamp_cost;
+		uint32_t max_rooms;
+		uint32_t version;
+		uint32_t matrices; // room callback use and ignore_creeps, which change the matrices it returns
+		uint32_t matrix_version; // world_t::note_cost_matrix_change
+		uint32_t overlay_version; // world_t::note_cost_overlay_change, 0 for searches that ignore creeps
+
+		bool operator==(const learned_key_t& right) const {
+			return goal_xx == right.goal_xx && goal_yy == right.goal_yy && range == right.range && plain_cost == right.plain_cost && swamp_cost == right.swamp_cost &&
+				max_rooms == right.max_rooms && version == right.version && matrices == right.matrices &&
+				matrix_version == right.matrix_version && overlay_version == right.overlay_version;
+		}
+
+		struct hash_t {
+			size_t operator()(const learned_key_t& key) const {
+				uint64_t hash = (uint64_t(key.goal_xx) << 48 | uint64_t(key.goal_yy) << 32 | key.range) * 0x9e3779b97f4a7c15ull;
+				hash ^= (uint64_t(key.plain_cost) << 48 ^ uint64_t(key.swamp_cost) << 32 ^ uint64_t(key.max_rooms) << 16 ^ key.version ^ uint64_t(key.matrices) << 60) * 0xc2b2ae3d27d4eb4full;
+				hash ^= (uint64_t(key.matrix_version) << 32 | key.overlay_version) * 0x165667b19e3779f9ull;
+				return static_cast<size_t>(hash ^ (hash >> 29));
+			}
+		};
+	};
+
+	// A tile a finished search expanded, with its cost from that search's origin
+	struct learned_sample_t {
+		uint16_t xx;
+		uint16_t yy;
+		uint32_t g_cost;
+	};
+
+	//
+	// Learned heuristic for one goal (Adaptive A*): per room a 16-bit grid, [x * 50 + y], of lower bounds
+	// on the cost to the goal, 0 where nothing was learned. Tables are immutable once published, so a
+	// search reads its snapshot without locking while later searches publish new ones.
+	class learned_table_t {
+		public:
+			static constexpr unsigned k_tiles = 2500;
+
+			// Bounds of a room, nullptr when none were learned there
+			const uint16_t* room(uint16_t id) const;
+
+			// Room id (map_position_t::id) of a world tile
+			static uint16_t room_id(uint32_t xx, uint32_t yy) {
+				return static_cast<uint16_t>((yy / 50) << 8 | (xx / 50));
+			}
+
+			size_t room_count() const {
+				return rooms.size();
+			}
+
+		private:
+			friend class learned_heuristics_t;
+			struct room_bounds_t {
+				uint16_t id;
+				std::shared_ptr<const uint16_t[]> grid;
+			};
+			std::vector<room_bounds_t> rooms; // sorted by id
+	};
+
+	//
+	// Learned tables of a world, keyed by goal. After an exact search (heuristic weight 1) that reached
+	// the goal at cost C, every node it expanded with cost g from the origin is at least C - g away
+	// from the goal: a cheaper way from there would have given a cheaper path, since A* expands nodes
+	// in cost order. Those bounds are merged into the goal's table, and later searches to the goal
+	// estimate with the larger of them and their usual heuristic. Popular goals thus get searches that
+	// head straight for them, and fewer ops, the more often they are searched.
+	//
+	// Only exact searches feed a table: jump point search can end a point or two off the cheapest path,
+	// so a feeding search expands tile by tile without landmark bounds. Its C and g are then exact, and
+	// the merged heuristic stays consistent as well as admissible, so later searches reading it never
+	// need to reopen closed nodes. A search that fills max_rooms feeds nothing: which rooms it got
+	// depends on where it started.
+	//
+	// Grids are copied on write; the table of a goal is replaced as a whole. The number of room grids
+	// held is capped: the least recently used goals are dropped first. Terrain and portal changes
+	// clear everything. Registered cost matrix and overlay changes retire tables through the versions
+	// in learned_key_t, and retired tables age out through the cap; anything else the room callback
+	// changes is up to the caller, through learned_key_t::version. Thread-safe.
+	class learned_heuristics_t {
+		public:
+			// Caps the room grids held across all goals; 0 turns learning off and drops every table
+			void set_capacity(size_t room_grids);
+
+			bool enabled() const {
+				return capacity != 0;
+			}
+
+			// Current table for `key`, nullptr when nothing was learned for it yet
+			std::shared_ptr<const learned_table_t> find(const learned_key_t& key);
+
+			// Merges the bounds of a search that reached the goal at `final_cost`. Samples are sorted by
+			// room in place.
+			void learn(const learned_key_t& key, uint32_t final_cost, learned_sample_t* samples, size_t count);
+
+			void clear();
+
+			// Room grids currently held, across all goals
+			size_t room_grids() const;
+
+		private:
+			struct entry_t {
+				std::shared_ptr<const learned_table_t> table;
+				uint64_t last_used = 0;
+			};
+			mutable std::mutex mutex;
+			std::unordered_map<learned_key_t, entry_t, learned_key_t::hash_t> tables;
+			size_t capacity = 0;
+			size_t grid_count = 0;
+			uint64_t clock = 0;
+
+			void evict(const learned_key_t* keep, size_t needed);
+	};
+}
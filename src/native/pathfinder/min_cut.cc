@@ -0,0 +1,221 @@
+#include "min_cut.h"
+#include <algorithm>
+
+using namespace screeps;
+
+namespace {
+	constexpr unsigned k_size = room_grid_t::k_size;
+
+	uint32_t in_node(unsigned tile) {
+		return 2 * tile;
+	}
+
+	uint32_t out_node(unsigned tile) {
+		return 2 * tile + 1;
+	}
+
+	bool on_border(unsigned xx, unsigned yy) {
+		return xx == 0 || yy == 0 || xx == k_size - 1 || yy == k_size - 1;
+	}
+}
+
+	min_cut_status room_min_cut_t::solve(
+		const world_t& world,
+		map_position_t room,
+		const uint8_t* cost_matrix,
+		const room_tile_t* protected_tiles,
+		size_t protected_count,
+		std::vector<room_tile_t>& cut,
+		uint32_t* cut_cost
+	) {
+		cut.clear();
+		room_grid_t grid;
+		if (!grid.load(world, room, cost_matrix)) {
+			return min_cut_status::InvalidRoom;
+		}
+
+		bool is_protected[k_tiles] = {};
+		for (size_t ii = 0; ii < protected_count; ++ii) {
+			if (protected_tiles[ii].xx < k_size && protected_tiles[ii].yy < k_size) {
+				is_protected[protected_tiles[ii].xx * k_size + protected_tiles[ii].yy] = true;
+			}
+		}
+
+		// Exits are walkable border tiles; nothing may be built on them or next to them
+		bool near_exit[k_tiles] = {};
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			for (unsigned yy = 0; yy < k_size; ++yy) {
+				if (!on_border(xx, yy) || !grid.walkable(xx, yy)) {
+					continue;
+				}
+				for (int dx = -1; dx <= 1; ++dx) {
+					for (int dy = -1; dy <= 1; ++dy) {
+						int nx = xx + dx;
+						int ny = yy + dy;
+						if (nx >= 0 && ny >= 0 && nx < int(k_size) && ny < int(k_size)) {
+							near_exit[nx * k_size + ny] = true;
+						}
+					}
+				}
+			}
+		}
+
+		arcs.clear();
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			for (unsigned yy = 0; yy < k_size; ++yy) {
+				if (!grid.walkable(xx, yy)) {
+					continue;
+				}
+				unsigned tile = xx * k_size + yy;
+				if (is_protected[tile]) {
+					arcs.push_back(arc_t{k_source, in_node(tile), k_unbounded});
+				}
+				// Reaching any tile next to an exit reaches the exit, so those tiles feed the sink directly
+				// and the band along the border never enters the flow graph
+				if (near_exit[tile] || on_border(xx, yy)) {
+					arcs.push_back(arc_t{in_node(tile), k_sink, k_unbounded});
+					continue;
+				}
+				uint8_t cost = cost_matrix == nullptr ? 0 : cost_matrix[tile];
+				arcs.push_back(arc_t{in_node(tile), out_node(tile), is_protected[tile] ? k_unbounded : std::max<int32_t>(cost, 1)});
+				for (int dx = -1; dx <= 1; ++dx) {
+					for (int dy = -1; dy <= 1; ++dy) {
+						int nx = xx + dx;
+						int ny = yy + dy;
+						if ((dx != 0 || dy != 0) && nx >= 0 && ny >= 0 && nx < int(k_size) && ny < int(k_size) && grid.walkable(nx, ny)) {
+							arcs.push_back(arc_t{out_node(tile), in_node(nx * k_size + ny), k_unbounded});
+						}
+					}
+				}
+			}
+		}
+		build();
+
+		int64_t flow = 0;
+		while (flow < k_unbounded && build_levels()) {
+			flow += augment();
+		}
+		if (flow >= k_unbounded) {
+			return min_cut_status::NoCut;
+		}
+
+		// Tiles whose in-node is still reachable from the source but whose out-node is not form the cut
+		std::fill(level.begin(), level.end(), -1);
+		queue.clear();
+		queue.push_back(k_source);
+		level[k_source] = 0;
+		for (size_t head = 0; head < queue.size(); ++head) {
+			uint32_t node = queue[head];
+			for (uint32_t ee = first_edge[node]; ee < first_edge[node + 1]; ++ee) {
+				if (edges[ee].capacity > 0 && level[edges[ee].to] < 0) {
+					level[edges[ee].to] = 0;
+					queue.push_back(edges[ee].to);
+				}
+			}
+		}
+		for (unsigned tile = 0; tile < k_tiles; ++tile) {
+			if (level[in_node(tile)] >= 0 && level[out_node(tile)] < 0) {
+				cut.push_back(room_tile_t{static_cast<uint8_t>(tile / k_size), static_cast<uint8_t>(tile % k_size)});
+			}
+		}
+		if (cut_cost != nullptr) {
+			*cut_cost = static_cast<uint32_t>(flow);
+		}
+		return min_cut_status::Success;
+	}
+
+	void room_min_cut_t::build() {
+		first_edge.assign(k_nodes + 1, 0);
+		for (const arc_t& arc : arcs) {
+			++first_edge[arc.from + 1];
+			++first_edge[arc.to + 1];
+		}
+		for (uint32_t node = 0; node < k_nodes; ++node) {
+			first_edge[node + 1] += first_edge[node];
+		}
+		edges.resize(first_edge[k_nodes]);
+		fill.assign(first_edge.begin(), first_edge.end() - 1);
+		for (const arc_t& arc : arcs) {
+			uint32_t forward = fill[arc.from]++;
+			uint32_t backward = fill[arc.to]++;
+			edges[forward] = edge_t{arc.to, backward, arc.capacity};
+			edges[backward] = edge_t{arc.from, forward, 0};
+		}
+		level.resize(k_nodes);
+		next_edge.resize(k_nodes);
+	}
+
+	bool room_min_cut_t::build_levels() {
+		std::fill(level.begin(), level.end(), -1);
+		queue.clear();
+		queue.push_back(k_source);
+		level[k_source] = 0;
+		for (size_t head = 0; head < queue.size(); ++head) {
+			uint32_t node = queue[head];
+			// Nodes at or past the sink's level cannot lie on a shortest augmenting path
+			if (level[k_sink] >= 0 && level[node] >= level[k_sink]) {
+				break;
+			}
+			for (uint32_t ee = first_edge[node]; ee < first_edge[node + 1]; ++ee) {
+				const edge_t& edge = edges[ee];
+				if (edge.capacity > 0 && level[edge.to] < 0) {
+					level[edge.to] = level[node] + 1;
+					queue.push_back(edge.to);
+				}
+			}
+		}
+		return level[k_sink] >= 0;
+	}
+
+	// Blocking flow over the level graph, walking augmenting paths with an explicit stack
+	int64_t room_min_cut_t::augment() {
+		std::copy(first_edge.begin(), first_edge.end() - 1, next_edge.begin());
+		int64_t total = 0;
+		path.clear();
+		uint32_t node = k_source;
+		for (;;) {
+			if (node == k_sink) {
+				int32_t bottleneck = k_unbounded;
+				for (uint32_t ee : path) {
+					bottleneck = std::min(bottleneck, edges[ee].capacity);
+				}
+				size_t saturated = path.size();
+				for (size_t ii = 0; ii < path.size(); ++ii) {
+					edge_t& edge = edges[path[ii]];
+					edge.capacity -= bottleneck;
+					edges[edge.reverse].capacity += bottleneck;
+					if (edge.capacity == 0 && saturated == path.size()) {
+						saturated = ii;
+					}
+				}
+				total += bottleneck;
+				if (total >= k_unbounded) {
+					return total;
+				}
+				// Resume from the tail of the first saturated edge
+				path.resize(saturated);
+				node = path.empty() ? k_source : edges[path.back()].to;
+				continue;
+			}
+
+			uint32_t& ee = next_edge[node];
+			while (ee < first_edge[node + 1] && (edges[ee].capacity == 0 || level[edges[ee].to] != level[node] + 1)) {
+				++ee;
+			}
+			if (ee < first_edge[node + 1]) {
+				path.push_back(ee);
+				node = edges[ee].to;
+				continue;
+			}
+
+			// Dead end: retreat one edge and skip it from now on
+			level[node] = -1;
+			if (path.empty()) {
+				return total;
+			}
+			uint32_t back = path.back();
+			path.pop_back();
+			node = edges[edges[back].reverse].to;
+			++next_edge[node];
+		}
+	}
@@ -0,0 +1,68 @@
+#pragma once
+#include "room_analysis.h"
+#include <cstdint>
+#include <vector>
+
+namespace screeps {
+
+	enum class min_cut_status {
+		Success,
+		NoCut, // a protected tile touches the exit region, so no set of buildable tiles separates them
+		InvalidRoom
+	};
+
+	//
+	// Minimum vertex cut between a protected tile set and the room exits, i.e. the cheapest rampart
+	// line. Every walkable tile becomes an in/out node pair joined by its placement cost; neighbouring
+	// tiles are joined out -> in with unbounded capacity. Protected tiles, border tiles and tiles next to
+	// an exit cannot be built on and never appear in the cut.
+	//
+	// The cost matrix follows the search rule for walkability (255 blocks, nonzero overrides terrain);
+	// other nonzero entries are also the price of building on that tile, which is 1 otherwise.
+	//
+	// Max-flow is Dinic over a CSR edge array that is kept between calls, so repeated solves reuse
+	// their storage.
+	class room_min_cut_t {
+		public:
+			min_cut_status solve(
+				const world_t& world,
+				map_position_t room,
+				const uint8_t* cost_matrix,
+				const room_tile_t* protected_tiles,
+				size_t protected_count,
+				std::vector<room_tile_t>& cut,
+				uint32_t* cut_cost = nullptr);
+
+		private:
+			struct edge_t {
+				uint32_t to;
+				uint32_t reverse;
+				int32_t capacity;
+			};
+
+			static constexpr uint32_t k_tiles = room_grid_t::k_size * room_grid_t::k_size;
+			static constexpr uint32_t k_source = 2 * k_tiles;
+			static constexpr uint32_t k_sink = k_source + 1;
+			static constexpr uint32_t k_nodes = k_sink + 1;
+			static constexpr int32_t k_unbounded = 1 << 28;
+
+			std::vector<uint32_t> first_edge; // CSR offsets, k_nodes + 1 entries
+			std::vector<edge_t> edges;
+			std::vector<uint32_t> fill;
+			std::vector<int32_t> level;
+			std::vector<uint32_t> next_edge;
+			std::vector<uint32_t> queue;
+			std::vector<uint32_t> path;
+
+			struct arc_t {
+				uint32_t from;
+				uint32_t to;
+				int32_t capacity;
+			};
+			std::vector<arc_t> arcs;
+
+			void build();
+			bool build_levels();
+			int64_t augment();
+	};
+}
@@ -0,0 +1,562 @@
+#include "parallel_search.h"
+#include "room_route.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace screeps;
+
+namespace {
+	constexpr size_t k_map_size = size_t(1) << sizeof(map_position_t) * 8;
+	constexpr size_t k_ring_capacity = 4096;
+	// Expansions between two looks at the inbound rings
+	constexpr unsigned k_expansion_batch = 32;
+	// Operations a thread takes from the shared budget at a time
+	constexpr int64_t k_ops_chunk = 64;
+
+	uint32_t mix(uint32_t value) {
+		value ^= value >> 16;
+		value *= 0x85ebca6bu;
+		value ^= value >> 13;
+		value *= 0xc2b2ae35u;
+		return value ^ (value >> 16);
+	}
+
+	template <class entry_t>
+	bool opens_later(const entry_t& left, const entry_t& right) {
+		return left.f_cost > right.f_cost || (left.f_cost == right.f_cost && left.g_cost < right.g_cost);
+	}
+}
+
+	void parallel_search_t::message_ring_t::reset(size_t capacity) {
+		if (cells == nullptr) {
+			cells.reset(new message_t[capacity]);
+			mask = capacity - 1;
+		}
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	size_t parallel_search_t::message_ring_t::free_space() const {
+		return mask + 1 - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+	}
+
+	void parallel_search_t::message_ring_t::push(const message_t* messages, size_t count) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		for (size_t ii = 0; ii < count; ++ii) {
+			cells[(position + ii) & mask] = messages[ii];
+		}
+		tail.store(position + count, std::memory_order_release);
+	}
+
+	void parallel_search_t::node_table_t::clear() {
+		if (count != 0) {
+			for (node_entry_t& entry : entries) {
+				entry.pos = k_empty;
+			}
+			count = 0;
+		}
+	}
+
+	void parallel_search_t::node_table_t::grow() {
+		std::vector<node_entry_t> previous(std::max<size_t>(entries.size() * 2, 4096), node_entry_t{k_empty, 0, 0});
+		previous.swap(entries);
+		size_t mask = entries.size() - 1;
+		for (const node_entry_t& entry : previous) {
+			if (entry.pos != k_empty) {
+				size_t ii = mix(entry.pos) & mask;
+				while (entries[ii].pos != k_empty) {
+					ii = (ii + 1) & mask;
+				}
+				entries[ii] = entry;
+			}
+		}
+	}
+
+	parallel_search_t::node_entry_t& parallel_search_t::node_table_t::insert(uint32_t pos) {
+		if ((count + 1) * 2 > entries.size()) {
+			grow();
+		}
+		size_t mask = entries.size() - 1;
+		for (size_t ii = mix(pos) & mask;; ii = (ii + 1) & mask) {
+			node_entry_t& entry = entries[ii];
+			if (entry.pos == pos) {
+				return entry;
+			} else if (entry.pos == k_empty) {
+				entry = node_entry_t{pos, 0, obstacle};
+				++count;
+				return entry;
+			}
+		}
+	}
+
+	const parallel_search_t::node_entry_t* parallel_search_t::node_table_t::find(uint32_t pos) const {
+		if (entries.empty()) {
+			return nullptr;
+		}
+		size_t mask = entries.size() - 1;
+		for (size_t ii = mix(pos) & mask;; ii = (ii + 1) & mask) {
+			if (entries[ii].pos == pos) {
+				return &entries[ii];
+			} else if (entries[ii].pos == k_empty) {
+				return nullptr;
+			}
+		}
+	}
+
+	parallel_search_t::parallel_search_t(world_t& world, unsigned thread_count) :
+		world(world),
+		workers(std::clamp<unsigned>(thread_count, 1, k_max_threads)),
+		room_slots(new std::atomic<uint16_t>[k_map_size]()),
+		rooms(k_max_rooms) {
+		size_t count = workers.size();
+		oversubscribed = count > std::max(1u, std::thread::hardware_concurrency());
+		rings.reset(new message_ring_t[count * count]);
+		for (worker_t& worker : workers) {
+			worker.outbox.resize(count);
+		}
+		threads.reserve(count - 1);
+		for (unsigned ii = 1; ii < count; ++ii) {
+			threads.emplace_back(&parallel_search_t::pool_main, this, ii);
+		}
+	}
+
+	parallel_search_t::~parallel_search_t() {
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			stopping = true;
+		}
+		pool_wake.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+	void parallel_search_t::pool_main(unsigned self) {
+		uint64_t seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(pool_mutex);
+				pool_wake.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+			run_worker(self);
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			if (--running == 0) {
+				pool_done.notify_one();
+			}
+		}
+	}
+
+	search_status parallel_search_t::search(const search_request_native& request, search_result_native& result) {
+		result.path.clear();
+		result.operations = 0;
+		result.cost = 0;
+		result.incomplete = false;
+		result.status = search_status::Error;
+
+		goals.assign(request.goals, request.goals + request.goal_count);
+		look_table[0] = request.options.plain_cost;
+		look_table[2] = request.options.swamp_cost;
+		heuristic_weight = request.options.heuristic_weight;
+		max_cost = request.options.max_cost;
+		max_rooms = static_cast<uint16_t>(std::min<size_t>(request.options.max_rooms, k_max_rooms));
+		flee = request.options.flee;
+		use_room_callback = request.options.use_room_callback;
+		ignore_creeps = request.options.ignore_creeps;
+		corridor = request.corridor;
+
+		world_position_t origin = request.origin;
+		if (heuristic(origin) == 0) {
+			result.status = search_status::SamePosition;
+			return result.status;
+		}
+		failed.store(false, std::memory_order_relaxed);
+		finished.store(false, std::memory_order_relaxed);
+		if (load_room(origin.map_position()) == k_blocked_room) {
+			reset_rooms();
+			result.status = failed.load(std::memory_order_relaxed) ? search_status::Error : search_status::InvalidStart;
+			return result.status;
+		}
+
+		size_t count = workers.size();
+		for (worker_t& worker : workers) {
+			worker.open.clear();
+			worker.nodes.clear();
+			for (std::vector<message_t>& box : worker.outbox) {
+				box.clear();
+			}
+			worker.pending = 0;
+			worker.expansions = 0;
+			worker.goal_g_cost = obstacle;
+			worker.closest = origin;
+			worker.closest_h_cost = obstacle;
+			worker.closest_g_cost = 0;
+		}
+		for (size_t ii = 0; ii < count * count; ++ii) {
+			rings[ii].reset(k_ring_capacity);
+		}
+		incumbent.store(obstacle, std::memory_order_relaxed);
+		ops_budget.store(request.options.max_ops, std::memory_order_relaxed);
+		active.store(static_cast<int64_t>(count), std::memory_order_relaxed);
+		relax(workers[owner(origin)], origin, origin, 0);
+
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			++generation;
+			running = static_cast<unsigned>(threads.size());
+		}
+		pool_wake.notify_all();
+		run_worker(0);
+		{
+			std::unique_lock<std::mutex> lock(pool_mutex);
+			pool_done.wait(lock, [&]() { return running == 0; });
+		}
+
+		if (failed.load(std::memory_order_relaxed)) {
+			reset_rooms();
+			return result.status;
+		}
+
+		// The cheapest goal any thread closed, else the node nearest to a goal
+		const worker_t* goal = nullptr;
+		const worker_t* nearest = &workers[0];
+		uint64_t operations = 0;
+		for (const worker_t& worker : workers) {
+			operations += worker.expansions;
+			if (worker.goal_g_cost != obstacle && (goal == nullptr || worker.goal_g_cost < goal->goal_g_cost)) {
+				goal = &worker;
+			}
+			if (worker.closest_h_cost < nearest->closest_h_cost ||
+				(worker.closest_h_cost == nearest->closest_h_cost && worker.closest_g_cost < nearest->closest_g_cost)) {
+				nearest = &worker;
+			}
+		}
+
+		// Parents only ever point at tiles with a lower g cost, so the walk ends at the origin. A parent may
+		// have improved after the fact, so the cost is summed along the path rather than taken from g.
+		std::vector<world_position_t>& reconstructed = result.path;
+		world_position_t pos = goal != nullptr ? goal->goal : nearest->closest;
+		cost_t cost = 0;
+		while (pos != origin) {
+			size_t size = reconstructed.size();
+			if (request.options.waypoints_only && size >= 2 &&
+				reconstructed[size - 2].direction_to(reconstructed[size - 1]) == reconstructed[size - 1].direction_to(pos)) {
+				reconstructed.back() = pos;
+			} else {
+				reconstructed.push_back(pos);
+			}
+			cost += look(pos);
+			pos = world_position_t(workers[owner(pos)].nodes.find(pos.id)->parent);
+		}
+		size_t size = reconstructed.size();
+		if (request.options.waypoints_only && size >= 2 &&
+			reconstructed[size - 2].direction_to(reconstructed[size - 1]) == reconstructed[size - 1].direction_to(origin)) {
+			reconstructed.pop_back();
+		}
+		reset_rooms();
+
+		result.operations = static_cast<uint32_t>(operations);
+		result.cost = cost;
+		result.incomplete = goal == nullptr;
+		result.status = search_status::Success;
+		return result.status;
+	}
+
+	void parallel_search_t::run_worker(unsigned self) {
+		worker_t& worker = workers[self];
+		bool busy = true;
+		uint32_t ops_left = 0;
+		while (!finished.load(std::memory_order_acquire)) {
+			size_t received = receive(worker, self);
+			if (received != 0) {
+				// While idle, the first message taken in carries over as this thread's own count
+				size_t settled = busy ? received : received - 1;
+				if (settled != 0) {
+					active.fetch_sub(static_cast<int64_t>(settled), std::memory_order_acq_rel);
+				}
+				busy = true;
+			}
+			bool progressed = false;
+			for (unsigned ii = 0; ii < k_expansion_batch && expand_next(worker, self, ops_left); ++ii) {
+				progressed = true;
+			}
+			if (worker.pending != 0) {
+				flush(worker, self);
+			}
+			if (oversubscribed) {
+				// Threads sharing a core would otherwise run a whole time slice ahead on stale costs from
+				// the others, expanding far more nodes in total
+				std::this_thread::yield();
+			}
+			if (!progressed && received == 0 && worker.pending == 0) {
+				if (busy) {
+					busy = false;
+					if (active.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+						finished.store(true, std::memory_order_release);
+						break;
+					}
+				}
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Closes the best open node if it can still beat the incumbent; false when there is none
+	bool parallel_search_t::expand_next(worker_t& worker, unsigned self, uint32_t& ops_left) {
+		if (worker.open.empty() || worker.open.front().f_cost >= incumbent.load(std::memory_order_relaxed)) {
+			return false;
+		}
+		open_entry_t current = worker.open.front();
+		std::pop_heap(worker.open.begin(), worker.open.end(), opens_later<open_entry_t>);
+		worker.open.pop_back();
+		if (worker.nodes.find(current.pos)->g_cost != current.g_cost) {
+			// A cheaper arrival reopened this tile after it was queued
+			return true;
+		}
+
+		world_position_t pos(current.pos);
+		cost_t h_cost = heuristic(pos);
+		if (!worth_opening(current.g_cost, h_cost)) {
+			// The incumbent dropped since this node was queued
+			return true;
+		} else if (h_cost == 0) {
+			if (current.g_cost < worker.goal_g_cost) {
+				worker.goal = pos;
+				worker.goal_g_cost = current.g_cost;
+			}
+			cost_t best = incumbent.load(std::memory_order_relaxed);
+			while (current.g_cost < best && !incumbent.compare_exchange_weak(best, current.g_cost, std::memory_order_relaxed)) {
+			}
+			return true;
+		} else if (h_cost < worker.closest_h_cost || (h_cost == worker.closest_h_cost && current.g_cost < worker.closest_g_cost)) {
+			worker.closest = pos;
+			worker.closest_h_cost = h_cost;
+			worker.closest_g_cost = current.g_cost;
+		}
+		if (uint64_t(current.g_cost) + h_cost > max_cost) {
+			return true;
+		}
+
+		if (ops_left == 0) {
+			int64_t remaining = ops_budget.fetch_sub(k_ops_chunk, std::memory_order_relaxed);
+			if (remaining <= 0) {
+				finished.store(true, std::memory_order_release);
+				return false;
+			}
+			ops_left = static_cast<uint32_t>(std::min(remaining, k_ops_chunk));
+		}
+		--ops_left;
+		++worker.expansions;
+		expand(worker, self, pos, current.g_cost);
+		return true;
+	}
+
+	void parallel_search_t::expand(worker_t& worker, unsigned self, world_position_t pos, cost_t g_cost) {
+		for (int dir = world_position_t::TOP; dir <= world_position_t::TOP_LEFT; ++dir) {
+			world_position_t neighbor = pos.position_in_direction(static_cast<world_position_t::direction_t>(dir));
+
+			// Border tiles only lead straight across into the next room, as in path_finder_t::astar
+			if (pos.xx % 50 == 0) {
+				if (neighbor.xx % 50 == 49 && pos.yy != neighbor.yy) {
+					continue;
+				} else if (pos.xx == neighbor.xx) {
+					continue;
+				}
+			} else if (pos.xx % 50 == 49) {
+				if (neighbor.xx % 50 == 0 && pos.yy != neighbor.yy) {
+					continue;
+				} else if (pos.xx == neighbor.xx) {
+					continue;
+				}
+			} else if (pos.yy % 50 == 0) {
+				if (neighbor.yy % 50 == 49 && pos.xx != neighbor.xx) {
+					continue;
+				} else if (pos.yy == neighbor.yy) {
+					continue;
+				}
+			} else if (pos.yy % 50 == 49) {
+				if (neighbor.yy % 50 == 0 && pos.xx != neighbor.xx) {
+					continue;
+				} else if (pos.yy == neighbor.yy) {
+					continue;
+				}
+			}
+
+			cost_t n_cost = look(neighbor);
+			if (n_cost == obstacle) {
+				continue;
+			}
+			unsigned target = owner(neighbor);
+			if (target == self) {
+				relax(worker, neighbor, pos, g_cost + n_cost);
+			} else {
+				worker.outbox[target].push_back(message_t{neighbor.id, pos.id, g_cost + n_cost});
+				++worker.pending;
+			}
+		}
+	}
+
+	// Whether a node can still matter next to the incumbent C. A goal must beat C outright; any other
+	// node is dropped once heuristic_weight * (g + h) >= C, since everything it leads to costs at least
+	// g + h and C is within the bound of that already. Open nodes with f >= C all qualify.
+	bool parallel_search_t::worth_opening(cost_t g_cost, cost_t h_cost) const {
+		cost_t best = incumbent.load(std::memory_order_relaxed);
+		return h_cost == 0 ? g_cost < best : (double(g_cost) + h_cost) * heuristic_weight < best;
+	}
+
+	// Records a route to a tile this thread owns, opening it when it is the cheapest so far and could
+	// still matter next to the incumbent
+	void parallel_search_t::relax(worker_t& worker, world_position_t pos, world_position_t parent, cost_t g_cost) {
+		node_entry_t& node = worker.nodes.insert(pos.id);
+		if (node.g_cost <= g_cost) {
+			return;
+		}
+		node.g_cost = g_cost;
+		node.parent = parent.id;
+		cost_t h_cost = heuristic(pos);
+		if (!worth_opening(g_cost, h_cost)) {
+			return;
+		}
+		worker.open.push_back(open_entry_t{g_cost + cost_t(h_cost * heuristic_weight), g_cost, pos.id});
+		std::push_heap(worker.open.begin(), worker.open.end(), opens_later<open_entry_t>);
+	}
+
+	size_t parallel_search_t::receive(worker_t& worker, unsigned self) {
+		size_t count = workers.size();
+		size_t received = 0;
+		for (size_t sender = 0; sender < count; ++sender) {
+			if (sender != self) {
+				received += rings[sender * count + self].drain([&](const message_t& message) {
+					relax(worker, world_position_t(message.pos), world_position_t(message.parent), message.g_cost);
+				});
+			}
+		}
+		return received;
+	}
+
+	// Moves what fits of each outbox into its ring. Messages are counted as active before they are
+	// published, so the receiver can never settle one that was not counted yet.
+	void parallel_search_t::flush(worker_t& worker, unsigned self) {
+		size_t count = workers.size();
+		for (size_t target = 0; target < count; ++target) {
+			std::vector<message_t>& box = worker.outbox[target];
+			if (box.empty()) {
+				continue;
+			}
+			message_ring_t& ring = rings[self * count + target];
+			size_t sent = std::min(ring.free_space(), box.size());
+			if (sent == 0) {
+				continue;
+			}
+			active.fetch_add(static_cast<int64_t>(sent), std::memory_order_acq_rel);
+			ring.push(box.data(), sent);
+			box.erase(box.begin(), box.begin() + sent);
+			worker.pending -= sent;
+		}
+	}
+
+	// Hash of the tile's 10x10 block, mapped onto the threads
+	unsigned parallel_search_t::owner(world_position_t pos) const {
+		uint32_t block = uint32_t(pos.xx / k_block_size) << 16 | pos.yy / k_block_size;
+		return static_cast<unsigned>(uint64_t(mix(block)) * workers.size() >> 32);
+	}
+
+	// Same estimate as path_finder_t::heuristic for the general multi-goal kernels
+	cost_t parallel_search_t::heuristic(world_position_t pos) const {
+		if (flee) {
+			cost_t ret = 0;
+			for (const goal_t& goal : goals) {
+				cost_t dist = pos.range_to(goal.pos);
+				if (dist < goal.range) {
+					ret = std::max<cost_t>(ret, goal.range - dist);
+				}
+			}
+			return ret;
+		}
+		cost_t ret = std::numeric_limits<cost_t>::max();
+		for (const goal_t& goal : goals) {
+			cost_t dist = pos.range_to(goal.pos);
+			if (dist > goal.range) {
+				ret = std::min<cost_t>(ret, dist - goal.range);
+			} else {
+				ret = 0;
+			}
+		}
+		return ret;
+	}
+
+	cost_t parallel_search_t::look(world_position_t pos) {
+		map_position_t room_pos = pos.map_position();
+		uint16_t slot = room_slots[room_pos.id].load(std::memory_order_acquire);
+		if (slot == 0) {
+			slot = load_room(room_pos);
+		}
+		if (slot == k_blocked_room) {
+			return obstacle;
+		}
+		const room_t& room = rooms[slot - 1];
+		unsigned index = pos.xx % 50 * 50 + pos.yy % 50;
+		if (room.cost_matrix != nullptr && room.cost_matrix[index] != 0) {
+			return room.cost_matrix[index] == 0xff ? obstacle : room.cost_matrix[index];
+		}
+		return look_table[0x03 & room.terrain[index / 4] >> (index % 4 * 2)];
+	}
+
+	// Loads a room on first touch, asking the room callback under room_mutex. Rooms past max_rooms are
+	// refused like blocked ones; room_count never drops during a search, so the answer cannot change.
+	uint16_t parallel_search_t::load_room(map_position_t room_pos) {
+		std::lock_guard<std::mutex> lock(room_mutex);
+		uint16_t slot = room_slots[room_pos.id].load(std::memory_order_relaxed);
+		if (slot != 0) {
+			return slot;
+		}
+		touched_rooms.push_back(room_pos.id);
+		auto refuse = [&]() {
+			room_slots[room_pos.id].store(k_blocked_room, std::memory_order_release);
+			return k_blocked_room;
+		};
+		if (room_count >= max_rooms || (corridor != nullptr && !corridor->contains(room_pos))) {
+			return refuse();
+		}
+		const uint8_t* terrain = world.room_terrain(room_pos);
+		if (terrain == nullptr) {
+			// Like path_finder_t, a search reaching a room without terrain fails as a whole
+			failed.store(true, std::memory_order_relaxed);
+			finished.store(true, std::memory_order_release);
+			return refuse();
+		}
+
+		const uint8_t* cost_matrix = nullptr;
+		if (world.native_room_callback != nullptr && use_room_callback) {
+			if (matrix_storage.size() <= room_count) {
+				matrix_storage.emplace_back(new uint8_t[2500]);
+			}
+			room_callback_result callback_result{};
+			callback_result.matrix_buffer = matrix_storage[room_count].get();
+			callback_result.ignore_creeps = ignore_creeps;
+			if (!world.native_room_callback(room_pos.xx, room_pos.yy, &callback_result, world.native_room_callback_context) || callback_result.block_room) {
+				return refuse();
+			}
+			if (callback_result.cost_matrix != nullptr && callback_result.cost_matrix_length >= 2500) {
+				if (callback_result.cost_matrix != callback_result.matrix_buffer) {
+					std::memcpy(callback_result.matrix_buffer, callback_result.cost_matrix, 2500);
+				}
+				cost_matrix = callback_result.matrix_buffer;
+			}
+		}
+		rooms[room_count] = room_t{terrain, cost_matrix};
+		slot = static_cast<uint16_t>(++room_count);
+		room_slots[room_pos.id].store(slot, std::memory_order_release);
+		return slot;
+	}
+
+	void parallel_search_t::reset_rooms() {
+		for (uint16_t id : touched_rooms) {
+			room_slots[id].store(0, std::memory_order_relaxed);
+		}
+		touched_rooms.clear();
+		room_count = 0;
+	}
@@ -0,0 +1,197 @@
+#pragma once
+#include "pf.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// One search spread over several threads with hash-distributed A* (HDA*). Every tile has an owner
+	// thread, picked by hashing its 10x10 block: most moves stay on one thread, yet each room is spread
+	// over all of them. A thread keeps the open list and g costs of the tiles it owns. It hands a
+	// neighbour owned by another thread to that thread through a lock-free single-producer ring (one
+	// per pair of threads), and reopens a tile whenever a cheaper way to it arrives.
+	//
+	// The first goal any thread closes becomes the incumbent, and cheaper ones replace it. Nodes with
+	// heuristic_weight * (g + h) at or above the incumbent's cost are dropped, and the search ends once
+	// no thread holds another open node and no message is in flight. The path cost then stays within
+	// heuristic_weight times the optimum, as in the sequential search.
+	//
+	// Expansion is plain 8-way A*, without jump points, landmarks or portals. It does more work per
+	// search than path_finder_t, so it only pays off once searches reach hundreds of thousands of ops.
+	// Worlds with portals must use path_finder_t. Paths and operation counts may differ from
+	// path_finder_t, and from run to run, because ties go to whichever thread gets there first.
+	class parallel_search_t {
+		public:
+			static constexpr unsigned k_max_threads = 64;
+
+			// `thread_count` includes the thread calling search(); the others wait in a pool between searches
+			parallel_search_t(world_t& world, unsigned thread_count);
+			~parallel_search_t();
+
+			parallel_search_t(const parallel_search_t&) = delete;
+			parallel_search_t& operator=(const parallel_search_t&) = delete;
+
+			// Same request, result and status rules as path_finder_t::search_native. The world's room
+			// callback is invoked from any of the threads, one room at a time.
+			search_status search(const search_request_native& request, search_result_native& result);
+
+			unsigned thread_count() const {
+				return static_cast<unsigned>(workers.size());
+			}
+
+		private:
+			static constexpr cost_t obstacle = std::numeric_limits<cost_t>::max();
+			static constexpr unsigned k_block_size = 10;
+			static constexpr uint16_t k_blocked_room = std::numeric_limits<uint16_t>::max();
+
+			struct message_t {
+				uint32_t pos;
+				uint32_t parent;
+				cost_t g_cost;
+			};
+
+			//
+			// Bounded single-producer, single-consumer ring of messages. The consumer drains everything
+			// published so far in one pass.
+			class message_ring_t {
+				private:
+					std::unique_ptr<message_t[]> cells;
+					size_t mask = 0;
+					alignas(64) std::atomic<size_t> head{0};
+					alignas(64) std::atomic<size_t> tail{0};
+
+				public:
+					void reset(size_t capacity);
+
+					// Producer side: room for this many more messages
+					size_t free_space() const;
+					// Producer side; `count` must not exceed free_space()
+					void push(const message_t* messages, size_t count);
+
+					// Consumer side: hands every published message to `visit`, returns how many
+					template <class visit_t>
+					size_t drain(visit_t&& visit) {
+						size_t first = head.load(std::memory_order_relaxed);
+						size_t last = tail.load(std::memory_order_acquire);
+						for (size_t ii = first; ii != last; ++ii) {
+							visit(cells[ii & mask]);
+						}
+						head.store(last, std::memory_order_release);
+						return last - first;
+					}
+			};
+
+			struct node_entry_t {
+				uint32_t pos;
+				uint32_t parent;
+				cost_t g_cost;
+			};
+
+			//
+			// Open-addressed g costs and parents of the tiles one thread owns
+			class node_table_t {
+				private:
+					static constexpr uint32_t k_empty = std::numeric_limits<uint32_t>::max();
+					std::vector<node_entry_t> entries;
+					size_t count = 0;
+					void grow();
+
+				public:
+					void clear();
+					// Entry of `pos`, added with an unreachable cost when it is new
+					node_entry_t& insert(uint32_t pos);
+					const node_entry_t* find(uint32_t pos) const;
+					size_t size() const {
+						return count;
+					}
+			};
+
+			struct open_entry_t {
+				cost_t f_cost;
+				cost_t g_cost;
+				uint32_t pos;
+			};
+
+			struct alignas(64) worker_t {
+				std::vector<open_entry_t> open;
+				node_table_t nodes;
+				std::vector<std::vector<message_t>> outbox; // per receiving thread, not yet in its ring
+				size_t pending = 0;
+				uint64_t expansions = 0;
+				// Cheapest goal this thread closed, and the closed node nearest to a goal
+				world_position_t goal;
+				cost_t goal_g_cost;
+				world_position_t closest;
+				cost_t closest_h_cost;
+				cost_t closest_g_cost;
+			};
+
+			struct room_t {
+				const uint8_t* terrain;
+				const uint8_t* cost_matrix;
+			};
+
+			world_t& world;
+			std::vector<worker_t> workers;
+			std::unique_ptr<message_ring_t[]> rings; // [sender * thread_count + receiver]
+			bool oversubscribed = false; // more threads than cores
+
+			// Request being searched
+			std::vector<goal_t> goals;
+			cost_t look_table[4] = {obstacle, obstacle, obstacle, obstacle};
+			double heuristic_weight = 1;
+			uint32_t max_cost = 0;
+			uint16_t max_rooms = 0;
+			bool flee = false;
+			bool use_room_callback = true;
+			bool ignore_creeps = false;
+			const room_set_t* corridor = nullptr;
+
+			// Shared search state. `active` counts busy threads plus messages sent but not yet taken in;
+			// once it drops to zero nothing can reopen the search.
+			alignas(64) std::atomic<cost_t> incumbent{obstacle};
+			alignas(64) std::atomic<int64_t> ops_budget{0};
+			alignas(64) std::atomic<int64_t> active{0};
+			std::atomic<bool> finished{false};
+			std::atomic<bool> failed{false};
+
+			// Rooms loaded by this search: slot + 1 per map position, k_blocked_room when refused
+			std::unique_ptr<std::atomic<uint16_t>[]> room_slots;
+			std::vector<room_t> rooms;
+			std::vector<std::unique_ptr<uint8_t[]>> matrix_storage;
+			std::vector<uint16_t> touched_rooms;
+			size_t room_count = 0;
+			std::mutex room_mutex;
+
+			// Pool of the threads besides the caller
+			std::vector<std::thread> threads;
+			std::mutex pool_mutex;
+			std::condition_variable pool_wake;
+			std::condition_variable pool_done;
+			uint64_t generation = 0;
+			unsigned running = 0;
+			bool stopping = false;
+
+			void pool_main(unsigned self);
+			void run_worker(unsigned self);
+			bool expand_next(worker_t& worker, unsigned self, uint32_t& ops_left);
+			void expand(worker_t& worker, unsigned self, world_position_t pos, cost_t g_cost);
+			void relax(worker_t& worker, world_position_t pos, world_position_t parent, cost_t g_cost);
+			bool worth_opening(cost_t g_cost, cost_t h_cost) const;
+			size_t receive(worker_t& worker, unsigned self);
+			void flush(worker_t& worker, unsigned self);
+
+			unsigned owner(world_position_t pos) const;
+			cost_t heuristic(world_position_t pos) const;
+			cost_t look(world_position_t pos);
+			uint16_t load_room(map_position_t room);
+			void reset_rooms();
+	};
+}
@@ -0,0 +1,111 @@
+#include "path_validation.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace screeps;
+
+	void path_validator_t::validate(
+		const world_t& world,
+		const uint32_t* steps,
+		const uint32_t* offsets,
+		size_t path_count,
+		const cost_matrix_registry_t* matrices,
+		cost_t plain_cost,
+		cost_t swamp_cost,
+		path_check_t* results
+	) {
+		if (room_grid.empty()) {
+			room_grid.resize(size_t(1) << sizeof(map_position_t) * 8);
+			room_stamp.resize(room_grid.size(), 0);
+		}
+		// Grids are rebuilt for every batch so matrix and terrain changes between batches are picked up
+		if (++stamp == 0) {
+			std::fill(room_stamp.begin(), room_stamp.end(), 0);
+			stamp = 1;
+		}
+		grid_count = 0;
+		uint8_t plain = static_cast<uint8_t>(std::min<cost_t>(plain_cost, k_impassable));
+		uint8_t swamp = static_cast<uint8_t>(std::min<cost_t>(swamp_cost, k_impassable));
+
+		uint8_t costs[k_block];
+		uint8_t broken[k_block];
+		for (size_t path = 0; path < path_count; ++path) {
+			const uint32_t* begin = steps + offsets[path];
+			size_t length = offsets[path + 1] - offsets[path];
+			path_check_t& result = results[path];
+			result.first_blocked = -1;
+			result.cost = 0;
+
+			map_position_t cached_room(0, 0);
+			const uint8_t* grid = nullptr;
+			bool have_room = false;
+			for (size_t base = 0; base < length; base += k_block) {
+				size_t count = std::min(k_block, length - base);
+				for (size_t ii = 0; ii < count; ++ii) {
+					world_position_t pos(begin[base + ii] & 0xffff, begin[base + ii] >> 16);
+					map_position_t room = pos.map_position();
+					if (!have_room || room.id != cached_room.id) {
+						grid = merged_grid(world, room, matrices, plain, swamp);
+						cached_room = room;
+						have_room = true;
+					}
+					costs[ii] = grid == nullptr ? k_impassable : grid[(pos.xx % 50) * 50 + pos.yy % 50];
+					uint32_t prev = begin[base + ii == 0 ? 0 : base + ii - 1];
+					broken[ii] = std::abs(int(pos.xx) - int(prev & 0xffff)) > 1 || std::abs(int(pos.yy) - int(prev >> 16)) > 1;
+					if (broken[ii] && world.is_portal_hop(world_position_t(prev & 0xffff, prev >> 16), pos)) {
+						// Arriving through a portal is free, as it is in the search
+						broken[ii] = false;
+						costs[ii] = costs[ii] == k_impassable ? k_impassable : 0;
+					}
+				}
+
+				uint8_t any = 0;
+				uint32_t sum = 0;
+				for (size_t ii = 0; ii < count; ++ii) {
+					broken[ii] |= costs[ii] == k_impassable;
+					any |= broken[ii];
+					sum += costs[ii];
+				}
+				if (any == 0) {
+					result.cost += sum;
+					continue;
+				}
+				size_t first = std::find(broken, broken + count, 1) - broken;
+				for (size_t ii = 0; ii < first; ++ii) {
+					result.cost += costs[ii];
+				}
+				result.first_blocked = static_cast<int32_t>(base + first);
+				break;
+			}
+		}
+	}
+
+	const uint8_t* path_validator_t::merged_grid(const world_t& world, map_position_t room, const cost_matrix_registry_t* matrices, uint8_t plain, uint8_t swamp) {
+		if (room_stamp[room.id] == stamp) {
+			return room_grid[room.id] == k_no_grid ? nullptr : &grids[size_t(room_grid[room.id]) * 2500];
+		}
+		room_stamp[room.id] = stamp;
+		const uint8_t* terrain = world.room_terrain(room);
+		if (terrain == nullptr) {
+			room_grid[room.id] = k_no_grid;
+			return nullptr;
+		}
+		if (grids.size() < size_t(grid_count + 1) * 2500) {
+			grids.resize(size_t(grid_count + 1) * 2500);
+		}
+		room_grid[room.id] = grid_count;
+		uint8_t* grid = &grids[size_t(grid_count++) * 2500];
+
+		// Terrain codes first (wall bit 1, swamp bit 2), then the matrix overrides where it is nonzero
+		const uint8_t lookup[4] = {plain, k_impassable, swamp, k_impassable};
+		for (unsigned index = 0; index < 2500; ++index) {
+			grid[index] = lookup[(terrain[index / 4] >> (index % 4 * 2)) & 3];
+		}
+		const uint8_t* matrix = matrices == nullptr ? nullptr : matrices->get(room);
+		if (matrix != nullptr) {
+			for (unsigned index = 0; index < 2500; ++index) {
+				grid[index] = matrix[index] != 0 ? matrix[index] : grid[index];
+			}
+		}
+		return grid;
+	}
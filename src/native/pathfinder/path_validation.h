@@ -0,0 +1,47 @@
+#pragma once
+#include "cost_matrix_registry.h"
+#include "pf.h"
+#include <cstdint>
+#include <vector>
+
+namespace screeps {
+
+	struct path_check_t {
+		int32_t first_blocked; // index of the first step that is blocked or not adjacent to the previous one (portal hops excepted), -1 when none is
+		uint32_t cost;         // cost of the steps before first_blocked, i.e. of the whole path when it is intact
+	};
+
+	//
+	// Re-prices cached paths against current terrain and registered cost matrices. Each room a batch
+	// touches is flattened once into a merged grid of step costs (255 = impassable); paths are then
+	// walked in fixed-size blocks: a gather pass fills a block of costs and step flags, and the
+	// blocked test and cost sum run as straight byte loops the compiler vectorizes.
+	class path_validator_t {
+		public:
+			// Paths are stored back to back in `steps` as packed world tiles (x | y << 16), walking order
+			// with the first step included; path ii spans [offsets[ii], offsets[ii + 1]). Steps in rooms
+			// without terrain are blocked.
+			void validate(
+				const world_t& world,
+				const uint32_t* steps,
+				const uint32_t* offsets,
+				size_t path_count,
+				const cost_matrix_registry_t* matrices,
+				cost_t plain_cost,
+				cost_t swamp_cost,
+				path_check_t* results);
+
+		private:
+			static constexpr size_t k_block = 64;
+			static constexpr uint8_t k_impassable = 255;
+			static constexpr uint32_t k_no_grid = std::numeric_limits<uint32_t>::max();
+
+			std::vector<uint32_t> room_grid; // merged grid slot per map_position_t::id, valid for room_stamp == stamp
+			std::vector<uint32_t> room_stamp;
+			std::vector<uint8_t> grids;
+			uint32_t grid_count = 0;
+			uint32_t stamp = 0;
+
+			const uint8_t* merged_grid(const world_t& world, map_position_t room, const cost_matrix_registry_t* matrices, uint8_t plain, uint8_t swamp);
+	};
+}
@@ -1,19 +1,137 @@
 #define SCREEPS_PATHFINDER_EXPORTS
 
 #include "pathfinder_exports.h"
+#include "cooperative.h"
+#include "cost_matrix_builder.h"
+#include "min_cut.h"
+#include "parallel_search.h"
+#include "path_validation.h"
 #include "pf.h"
+#include "room_analysis.h"
+#include "room_route.h"
+#include "search_queue.h"
+#include "terrain_query.h"
+#include "threat_map.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <new>
+#include <shared_mutex>
+#include <thread>
 #include <vector>
 
+// State behind one ScreepsWorld handle. Each world has its own locks, so calls on different worlds
+// never wait for each other.
+struct ScreepsWorld
+{
+    // A null `created` stands for the process's default world
+    explicit ScreepsWorld(std::unique_ptr<screeps::world_t> created)
+        : owned(std::move(created)),
+          world(owned != nullptr ? *owned : screeps::world_t::default_world()),
+          syncPathfinder(world)
+    {
+    }
+
+    std::unique_ptr<screeps::world_t> owned;
+    screeps::world_t& world;
+
+    ScreepsRoomCallback roomCallback = nullptr;
+    void* roomUserData = nullptr;
+
+    // Held shared by every synchronous search, route and path expansion while it reads the world, and
+    // exclusively by the calls that change terrain, portals or precomputed tables
+    std::shared_mutex readersMutex;
+
+    // Instance behind the synchronous Search/SearchRouted calls, with its result and route corridor
+    screeps::path_finder_t syncPathfinder;
+    screeps::search_result_native syncResult;
+    screeps::room_set_t syncCorridor;
+
+    // Hash-distributed engine behind searches asking for parallelThreads > 1, rebuilt when the thread
+    // count changes; parallelMutex keeps it to one such search at a time
+    std::mutex parallelMutex;
+    std::unique_ptr<screeps::parallel_search_t> parallelSearch;
+    screeps::search_result_native parallelResult;
+    screeps::room_set_t parallelCorridor;
+
+    // Result arrays are carved from this arena once the caller opts into epochs with AdvanceEpoch;
+    // they then stay valid until the next epoch and FreeResult/FreeRoute release nothing
+    std::mutex epochMutex;
+    screeps::arena_t epochArena{256 * 1024};
+    bool epochResults = false;
+
+    // Registered cost matrices and the validator that reads them
+    std::mutex matrixMutex;
+    screeps::cost_matrix_registry_t costMatrices;
+    screeps::path_validator_t pathValidator;
+    std::atomic<bool> useRegisteredMatrices{false};
+
+    // Reservations shared by every cooperative batch; planning runs one batch at a time
+    std::mutex cooperativeMutex;
+    screeps::reservation_table_t reservations;
+    screeps::cooperative_planner_t cooperativePlanner;
+
+    // Worker pool behind Submit/PollCompletions; created by StartWorkers. Declared last so its workers
+    // stop before the rest of the world goes away.
+    std::mutex queueMutex;
+    std::shared_ptr<screeps::search_queue_t> searchQueue;
+};
+
 namespace
 {
-    ScreepsRoomCallback g_room_callback = nullptr;
-    void* g_room_user_data = nullptr;
+    ScreepsWorld& ResolveWorld(ScreepsWorld* world)
+    {
+        static ScreepsWorld defaultWorld(nullptr);
+        return world != nullptr ? *world : defaultWorld;
+    }
+
+    // World state may only change while none of the world's queued searches are in flight
+    bool QueueIdle(ScreepsWorld& state)
+    {
+        return state.searchQueue == nullptr || state.searchQueue->in_flight() == 0;
+    }
+
+    // Locks the world against readers for a change; the lock is empty when a synchronous search or
+    // expansion is reading it or queued searches are in flight. Callers hold queueMutex, so no
+    // submission slips in before the change is done.
+    std::unique_lock<std::shared_mutex> LockForUpdate(ScreepsWorld& state)
+    {
+        std::unique_lock<std::shared_mutex> lock(state.readersMutex, std::try_to_lock);
+        if (lock.owns_lock() && !QueueIdle(state))
+            lock.unlock();
+        return lock;
+    }
+
+    // Object lists are handed to the builder as they are
+    static_assert(sizeof(ScreepsRoomObjectNative) == sizeof(screeps::room_object_t), "room object layout mismatch");
+    static_assert(offsetof(ScreepsRoomObjectNative, kind) == offsetof(screeps::room_object_t, kind), "room object layout mismatch");
+    static_assert(sizeof(ScreepsCostOverrideNative) == sizeof(screeps::cost_override_t), "cost override layout mismatch");
+    static_assert(offsetof(ScreepsCostOverrideNative, cost) == offsetof(screeps::cost_override_t, cost), "cost override layout mismatch");
+    static_assert(sizeof(ScreepsThreatSourceNative) == sizeof(screeps::threat_source_t), "threat source layout mismatch");
+    static_assert(offsetof(ScreepsThreatSourceNative, strength) == offsetof(screeps::threat_source_t, strength), "threat source layout mismatch");
+
+    template <class T>
+    T* AllocateResultArray(ScreepsWorld& state, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(state.epochMutex);
+        if (state.epochResults)
+            return state.epochArena.allocate_array<T>(count);
+        return new (std::nothrow) T[count];
+    }
+
+    template <class T>
+    void ReleaseResultArray(ScreepsWorld& state, T* array)
+    {
+        std::lock_guard<std::mutex> lock(state.epochMutex);
+        if (!state.epochArena.owns(array))
+            delete[] array;
+    }
 
     bool ParseRoomName(const char* name, uint8_t& xx, uint8_t& yy)
     {
@@ -109,32 +227,40 @@ namespace
         return true;
     }
 
-    bool RoomCallbackBridge(uint8_t roomX, uint8_t roomY, screeps::room_callback_result* result, void*)
+    bool RoomCallbackBridge(uint8_t roomX, uint8_t roomY, screeps::room_callback_result* result, void* context)
     {
-        if (g_room_callback == nullptr)
+        ScreepsWorld& state = *static_cast<ScreepsWorld*>(context);
+        const uint8_t* costMatrix = nullptr;
+        int length = 0;
+        bool blockRoom = false;
+        if (state.roomCallback != nullptr && !state.roomCallback(roomX, roomY, &costMatrix, &length, &blockRoom, state.roomUserData))
         {
             if (result != nullptr)
             {
                 result->cost_matrix = nullptr;
                 result->cost_matrix_length = 0;
-                result->block_room = false;
+                result->block_room = true;
             }
             return true;
         }
 
-        const uint8_t* costMatrix = nullptr;
-        int length = 0;
-        bool blockRoom = false;
-        bool callbackResult = g_room_callback(roomX, roomY, &costMatrix, &length, &blockRoom, g_room_user_data);
-        if (!callbackResult)
+        if (costMatrix != nullptr && length < static_cast<int>(screeps::cost_matrix_registry_t::k_matrix_bytes))
+            costMatrix = nullptr;
+
+        if (!blockRoom && result != nullptr && result->matrix_buffer != nullptr && state.useRegisteredMatrices.load(std::memory_order_relaxed))
         {
-            if (result != nullptr)
+            // Composed straight into the search's buffer under the lock, so a concurrent SetCostMatrix or
+            // SetCostOverlay cannot change it mid-read. A callback matrix without an overlay is left for the
+            // search to copy.
+            screeps::map_position_t room(roomX, roomY);
+            std::lock_guard<std::mutex> lock(state.matrixMutex);
+            bool overlay = !result->ignore_creeps && state.costMatrices.has_overlay(room);
+            if (overlay || (costMatrix == nullptr && state.costMatrices.get(room) != nullptr))
             {
-                result->cost_matrix = nullptr;
-                result->cost_matrix_length = 0;
-                result->block_room = true;
+                state.costMatrices.compose(room, costMatrix, overlay, result->matrix_buffer);
+                costMatrix = result->matrix_buffer;
+                length = static_cast<int>(screeps::cost_matrix_registry_t::k_matrix_bytes);
             }
-            return true;
         }
 
         if (result != nullptr)
@@ -146,74 +272,114 @@ namespace
 
         return true;
     }
-}
 
-extern "C"
-{
-    int ScreepsPathfinder_LoadTerrain(const ScreepsTerrainRoom* rooms, int count)
+    // The bridge only runs when it has something to offer, so plain searches keep the callback-free kernels
+    void InstallRoomCallback(ScreepsWorld& state)
     {
-        if (rooms == nullptr || count <= 0)
+        bool needed = state.roomCallback != nullptr || state.useRegisteredMatrices.load();
+        state.world.set_room_callback(needed ? RoomCallbackBridge : nullptr, &state);
+    }
+
+    bool ToCostMatrixProfile(const ScreepsCostMatrixProfileNative* source, screeps::cost_matrix_profile_t& dest)
+    {
+        if (source == nullptr)
+            return false;
+        const int values[] = {
+            source->road, source->ownSite, source->hostileSite, source->ownRampart,
+            source->hostileRampart, source->blocking, source->ownCreep, source->hostileCreep};
+        for (int value : values)
+        {
+            if (value < 0 || value > 255)
+                return false;
+        }
+        dest.road = static_cast<uint8_t>(source->road);
+        dest.own_site = static_cast<uint8_t>(source->ownSite);
+        dest.hostile_site = static_cast<uint8_t>(source->hostileSite);
+        dest.own_rampart = static_cast<uint8_t>(source->ownRampart);
+        dest.hostile_rampart = static_cast<uint8_t>(source->hostileRampart);
+        dest.blocking = static_cast<uint8_t>(source->blocking);
+        dest.own_creep = static_cast<uint8_t>(source->ownCreep);
+        dest.hostile_creep = static_cast<uint8_t>(source->hostileCreep);
+        return true;
+    }
+
+    bool ToThreatProfile(const ScreepsThreatProfileNative* source, screeps::threat_profile_t& dest)
+    {
+        if (source == nullptr || source->plainCost < 1 || source->plainCost > 254 || source->swampCost < 1 || source->swampCost > 254 ||
+            source->maxCost < 1 || source->maxCost > 254 || source->threatPerCost < 1 || source->threatPerCost > 65535 || source->blockThreshold < 0)
+            return false;
+        dest.plain_cost = static_cast<uint8_t>(source->plainCost);
+        dest.swamp_cost = static_cast<uint8_t>(source->swampCost);
+        dest.max_cost = static_cast<uint8_t>(source->maxCost);
+        dest.threat_per_cost = static_cast<uint16_t>(source->threatPerCost);
+        dest.block_threshold = static_cast<uint32_t>(source->blockThreshold);
+        return true;
+    }
+
+    // Room position and terrain of a threat matrix request; same codes as the exports
+    int ResolveThreatRoom(ScreepsWorld& state, const char* roomName, const ScreepsThreatSourceNative* sources, int count, screeps::map_position_t& room, const uint8_t*& terrain)
+    {
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (count < 0 || (count > 0 && sources == nullptr) || !ParseRoomName(roomName, roomX, roomY))
             return -1;
+        room = screeps::map_position_t(roomX, roomY);
+        terrain = state.world.room_terrain(room);
+        return terrain == nullptr ? -2 : 0;
+    }
 
-        std::vector<screeps::terrain_room_plain> entries;
-        entries.reserve(count);
+    bool ToRouteOptions(
+        const ScreepsRouteOptionsNative* source,
+        std::vector<screeps::room_route_cost_t>& costs,
+        screeps::room_route_options_t& dest)
+    {
+        if (source->roomCostCount < 0 || (source->roomCostCount > 0 && source->roomCosts == nullptr))
+            return false;
 
-        for (int i = 0; i < count; ++i)
+        costs.clear();
+        costs.reserve(static_cast<size_t>(source->roomCostCount));
+        for (int ii = 0; ii < source->roomCostCount; ++ii)
         {
-            const auto& room = rooms[i];
-            if (room.terrainBytes == nullptr || room.terrainLength < static_cast<int>(screeps::k_terrain_bytes))
-                continue;
-
+            const auto& entry = source->roomCosts[ii];
             uint8_t xx = 0;
             uint8_t yy = 0;
-            if (!ParseRoomName(room.roomName, xx, yy))
-                continue;
-
-            screeps::terrain_room_plain plain{
-                xx,
-                yy,
-                room.terrainBytes,
-                static_cast<size_t>(room.terrainLength)
-            };
-            entries.push_back(plain);
+            if (!ParseRoomName(entry.roomName, xx, yy))
+                return false;
+            costs.push_back(screeps::room_route_cost_t{screeps::map_position_t(xx, yy), std::max(entry.cost, 0.0), entry.blocked});
         }
 
-        if (entries.empty())
-            return -2;
-
-        screeps::path_finder_t::load_terrain(entries.data(), entries.size());
-        return 0;
+        dest.costs = costs.empty() ? nullptr : costs.data();
+        dest.cost_count = costs.size();
+        dest.default_cost = source->defaultCost > 0 ? source->defaultCost : 1;
+        if (source->maxRoomsExplored > 0)
+            dest.max_rooms_explored = static_cast<uint32_t>(source->maxRoomsExplored);
+        return true;
     }
 
-    int ScreepsPathfinder_Search(
+    bool ToSearchRequest(
         const ScreepsPathfinderPoint* origin,
         const ScreepsPathfinderGoal* goals,
         int goalCount,
         const ScreepsPathfinderOptionsNative* options,
-        ScreepsPathfinderResultNative* result)
+        screeps::world_position_t& originWorld,
+        std::vector<screeps::goal_t>& goalBuffer,
+        screeps::search_options_native& opts)
     {
-        if (origin == nullptr || result == nullptr || goalCount < 0)
-            return -1;
+        if (origin == nullptr || goalCount < 0)
+            return false;
         if (goalCount > 0 && goals == nullptr)
-            return -1;
-
-        result->path = nullptr;
-        result->pathLength = 0;
-        result->operations = 0;
-        result->cost = 0;
-        result->incomplete = true;
+            return false;
 
-        screeps::world_position_t originWorld;
         if (!ToWorldPosition(origin->x, origin->y, origin->roomName, originWorld))
-            return -1;
+            return false;
 
-        std::vector<screeps::goal_t> goalBuffer;
-        goalBuffer.reserve(static_cast<size_t>(std::max(0, goalCount)));
+        goalBuffer.clear();
+        goalBuffer.reserve(static_cast<size_t>(goalCount));
         for (int ii = 0; ii < goalCount; ++ii)
         {
             screeps::world_position_t goalPos;
             if (!ToWorldPosition(goals[ii].targetX, goals[ii].targetY, goals[ii].roomName, goalPos))
-                return -1;
+                return false;
 
             int rangeValue = goals[ii].range;
             if (rangeValue < 0)
@@ -223,29 +389,69 @@ extern "C"
             goalBuffer.emplace_back(goalPos, clampedRange);
         }
 
-        const screeps::search_options_native opts{
+        opts = screeps::search_options_native{
             static_cast<screeps::cost_t>(options != nullptr ? std::max(options->plainCost, 1) : 1),
             static_cast<screeps::cost_t>(options != nullptr ? std::max(options->swampCost, 1) : 5),
-            static_cast<uint8_t>(options != nullptr ? std::clamp(options->maxRooms, 1, static_cast<int>(screeps::k_max_rooms)) : 16),
+            static_cast<uint16_t>(options != nullptr ? std::clamp(options->maxRooms, 1, static_cast<int>(screeps::k_max_rooms)) : 16),
             static_cast<uint32_t>(options != nullptr ? std::max(options->maxOps, 1) : 20000),
             static_cast<uint32_t>(options != nullptr && options->maxCost > 0 ? options->maxCost : std::numeric_limits<uint32_t>::max()),
             options != nullptr ? options->flee : false,
-            options != nullptr ? options->heuristicWeight : 1.2
+            options != nullptr ? options->heuristicWeight : 1.2,
+            options == nullptr || !options->skipRoomCallback,
+            options != nullptr && options->waypointsOnly,
+            options != nullptr && options->ignoreCreeps,
+            options != nullptr && options->learnHeuristic,
+            static_cast<uint32_t>(options != nullptr ? options->heuristicVersion : 0)
         };
+        return true;
+    }
 
-        static screeps::path_finder_t pathfinder;
-        if (pathfinder.is_in_use())
-            return -5;
+    void ToPoint(screeps::world_position_t pos, ScreepsPathfinderPoint& point)
+    {
+        point.x = static_cast<int>(pos.xx % 50);
+        point.y = static_cast<int>(pos.yy % 50);
+        screeps::map_position_t room = pos.map_position();
+        FormatRoomName(room.xx, room.yy, point.roomName, sizeof(point.roomName));
+    }
 
-        screeps::search_request_native request{
-            originWorld,
-            goalBuffer.empty() ? nullptr : goalBuffer.data(),
-            goalBuffer.size(),
-            opts
-        };
+    // Parses the origin and waypoints of a waypoint-only result; false when any point is malformed
+    bool ToWaypoints(
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderPoint* waypoints,
+        int waypointCount,
+        screeps::world_position_t& originWorld,
+        std::vector<screeps::world_position_t>& buffer)
+    {
+        if (origin == nullptr || waypointCount < 0 || (waypointCount > 0 && waypoints == nullptr))
+            return false;
+        if (!ToWorldPosition(origin->x, origin->y, origin->roomName, originWorld))
+            return false;
+
+        buffer.resize(static_cast<size_t>(waypointCount));
+        for (int ii = 0; ii < waypointCount; ++ii)
+        {
+            if (!ToWorldPosition(waypoints[ii].x, waypoints[ii].y, waypoints[ii].roomName, buffer[ii]))
+                return false;
+        }
+        return true;
+    }
+
+    void ResetResult(ScreepsPathfinderResultNative* result)
+    {
+        result->path = nullptr;
+        result->pathLength = 0;
+        result->operations = 0;
+        result->cost = 0;
+        result->incomplete = true;
+    }
 
-        screeps::search_result_native nativeResult;
-        screeps::search_status status = pathfinder.search_native(request, nativeResult);
+    // Maps a finished search onto the Search return codes and copies its path into `result`
+    int FillResult(
+        ScreepsWorld& state,
+        screeps::search_status status,
+        const screeps::search_result_native& nativeResult,
+        ScreepsPathfinderResultNative* result)
+    {
         if (status == screeps::search_status::InvalidStart)
             return -2;
         if (status == screeps::search_status::Interrupted)
@@ -256,19 +462,12 @@ extern "C"
         const size_t pathLength = nativeResult.path.size();
         if (pathLength > 0)
         {
-            result->path = new (std::nothrow) ScreepsPathfinderPoint[pathLength];
+            result->path = AllocateResultArray<ScreepsPathfinderPoint>(state, pathLength);
             if (result->path == nullptr)
                 return -4;
 
             for (size_t ii = 0; ii < pathLength; ++ii)
-            {
-                const auto& node = nativeResult.path[ii];
-                ScreepsPathfinderPoint& point = result->path[ii];
-                point.x = static_cast<int>(node.xx % 50);
-                point.y = static_cast<int>(node.yy % 50);
-                screeps::map_position_t room = node.map_position();
-                FormatRoomName(room.xx, room.yy, point.roomName, sizeof(point.roomName));
-            }
+                ToPoint(nativeResult.path[ii], result->path[ii]);
         }
 
         result->pathLength = static_cast<int>(pathLength);
@@ -278,26 +477,1015 @@ extern "C"
         return 0;
     }
 
-    void ScreepsPathfinder_FreeResult(ScreepsPathfinderResultNative* result)
+    // Loads the analysis grid for a room; returns 0 or the analysis ABI error code
+    int LoadRoomGrid(ScreepsWorld& state, const char* roomName, const uint8_t* costMatrix, uint8_t* output, screeps::room_grid_t& grid)
     {
-        if (result == nullptr || result->path == nullptr)
-            return;
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (output == nullptr || !ParseRoomName(roomName, roomX, roomY))
+            return -1;
+        if (!grid.load(state.world, screeps::map_position_t(roomX, roomY), costMatrix))
+            return -2;
+        return 0;
+    }
 
-        delete[] result->path;
-        result->path = nullptr;
-        result->pathLength = 0;
+    int RunSearch(
+        ScreepsWorld& state,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        const ScreepsRouteOptionsNative* routeOptions,
+        ScreepsPathfinderResultNative* result)
+    {
+        if (result == nullptr)
+            return -1;
+
+        ResetResult(result);
+
+        screeps::world_position_t originWorld;
+        thread_local std::vector<screeps::goal_t> goalBuffer;
+        screeps::search_options_native opts;
+        if (!ToSearchRequest(origin, goals, goalCount, options, originWorld, goalBuffer, opts))
+            return -1;
+
+        std::shared_lock<std::shared_mutex> reading(state.readersMutex);
+
+        // Parallel searches have their own engine, result and corridor, so they never touch the
+        // sequential instance's state
+        bool parallel = options != nullptr && options->parallelThreads > 1 && state.world.portal_count() == 0;
+        std::unique_lock<std::mutex> parallelLock(state.parallelMutex, std::defer_lock);
+        if (parallel ? !parallelLock.try_lock() : state.syncPathfinder.is_in_use())
+            return -5;
+
+        screeps::search_request_native request{
+            originWorld,
+            goalBuffer.empty() ? nullptr : goalBuffer.data(),
+            goalBuffer.size(),
+            opts
+        };
+
+        // Restrict the search to the room route towards every goal room. If any goal room cannot be
+        // routed the search runs unrestricted rather than failing.
+        if (routeOptions != nullptr && !opts.flee && !goalBuffer.empty())
+        {
+            screeps::room_set_t& corridor = parallel ? state.parallelCorridor : state.syncCorridor;
+            corridor.clear();
+            // Kept per thread, like the goal buffer, so warm routed searches do not allocate either
+            thread_local std::vector<screeps::room_route_cost_t> routeCosts;
+            screeps::room_route_options_t nativeRouteOptions;
+            if (!ToRouteOptions(routeOptions, routeCosts, nativeRouteOptions))
+                return -1;
+
+            thread_local screeps::room_router_t router;
+            thread_local std::vector<screeps::map_position_t> route;
+            bool routed = true;
+            for (const auto& goal : goalBuffer)
+            {
+                if (router.find_route(state.world, originWorld.map_position(), goal.pos.map_position(), nativeRouteOptions, route) != screeps::route_status::Success)
+                {
+                    routed = false;
+                    break;
+                }
+                screeps::room_router_t::build_corridor(route, routeOptions->corridorMargin, corridor);
+            }
+            if (routed)
+                request.corridor = &corridor;
+        }
+
+        if (parallel)
+        {
+            unsigned threadCount = std::min<unsigned>(static_cast<unsigned>(options->parallelThreads), screeps::parallel_search_t::k_max_threads);
+            if (state.parallelSearch == nullptr || state.parallelSearch->thread_count() != threadCount)
+                state.parallelSearch = std::make_unique<screeps::parallel_search_t>(state.world, threadCount);
+            screeps::search_status status = state.parallelSearch->search(request, state.parallelResult);
+            return FillResult(state, status, state.parallelResult, result);
+        }
+        screeps::search_status status = state.syncPathfinder.search_native(request, state.syncResult);
+        return FillResult(state, status, state.syncResult, result);
     }
+}
 
-    void ScreepsPathfinder_SetRoomCallback(ScreepsRoomCallback callback, void* userData)
+extern "C"
+{
+    ScreepsWorld* ScreepsPathfinder_CreateWorld()
     {
-        g_room_callback = callback;
-        g_room_user_data = userData;
-        if (callback == nullptr)
+        try
         {
-            screeps::path_finder_t::set_room_callback(nullptr, nullptr);
-            return;
+            return new ScreepsWorld(std::make_unique<screeps::world_t>());
+        }
+        catch (const std::bad_alloc&)
+        {
+            return nullptr;
+        }
+    }
+
+    void ScreepsPathfinder_DestroyWorld(ScreepsWorld* world)
+    {
+        delete world;
+    }
+
+    int ScreepsPathfinder_LoadTerrain(ScreepsWorld* world, const ScreepsTerrainRoom* rooms, int count)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (rooms == nullptr || count <= 0)
+            return -1;
+
+        std::vector<screeps::terrain_room_plain> entries;
+        entries.reserve(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const auto& room = rooms[i];
+            if (room.terrainBytes == nullptr || room.terrainLength < static_cast<int>(screeps::k_terrain_bytes))
+                continue;
+
+            uint8_t xx = 0;
+            uint8_t yy = 0;
+            if (!ParseRoomName(room.roomName, xx, yy))
+                continue;
+
+            screeps::terrain_room_plain plain{
+                xx,
+                yy,
+                room.terrainBytes,
+                static_cast<size_t>(room.terrainLength)
+            };
+            entries.push_back(plain);
+        }
+
+        if (entries.empty())
+            return -2;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        state.world.load_terrain(entries.data(), entries.size());
+        return 0;
+    }
+
+    int ScreepsPathfinder_LoadTerrainRaw(ScreepsWorld* world, const ScreepsTerrainRoom* rooms, int count, int threads, int* rejected)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (rejected != nullptr)
+            *rejected = 0;
+        if (rooms == nullptr || count <= 0 || threads < 0)
+            return -1;
+
+        std::vector<screeps::terrain_room_plain> entries;
+        entries.reserve(count);
+        int unnamed = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const auto& room = rooms[i];
+            uint8_t xx = 0;
+            uint8_t yy = 0;
+            if (room.terrainLength < 0 || !ParseRoomName(room.roomName, xx, yy))
+            {
+                ++unnamed;
+                continue;
+            }
+            entries.push_back(screeps::terrain_room_plain{
+                xx,
+                yy,
+                room.terrainBytes,
+                static_cast<size_t>(room.terrainLength)
+            });
+        }
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        size_t failed = entries.size();
+        if (!entries.empty())
+        {
+            unsigned workers = threads > 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+            failed = state.world.load_terrain_raw(entries.data(), entries.size(), workers);
         }
+        if (rejected != nullptr)
+            *rejected = unnamed + static_cast<int>(failed);
+        return failed == entries.size() ? -2 : 0;
+    }
+
+    int ScreepsPathfinder_SetLandmarks(ScreepsWorld* world, int landmarksPerRoom, int threads)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (landmarksPerRoom < 0 || landmarksPerRoom > static_cast<int>(screeps::landmark_tables_t::k_max_landmarks) || threads < 0)
+            return -1;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        unsigned workers = threads > 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+        state.world.set_landmarks(static_cast<unsigned>(landmarksPerRoom), workers);
+        return 0;
+    }
 
-        screeps::path_finder_t::set_room_callback(RoomCallbackBridge, nullptr);
+    int ScreepsPathfinder_SetPrecomputeCache(ScreepsWorld* world, const char* path)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+        return state.world.set_precompute_cache(path) ? 1 : 0;
+    }
+
+    int ScreepsPathfinder_SetLearnedHeuristics(ScreepsWorld* world, int maxRoomGrids)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (maxRoomGrids < 0)
+            return -1;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        state.world.learned_heuristic_tables().set_capacity(static_cast<size_t>(maxRoomGrids));
+        return 0;
+    }
+
+    int ScreepsPathfinder_LearnedHeuristicGrids(ScreepsWorld* world)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        return static_cast<int>(state.world.learned_heuristic_tables().room_grids());
+    }
+
+    void ScreepsPathfinder_PrecomputeCacheStats(ScreepsWorld* world, int* cachedRooms, int* computedRooms)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        const screeps::landmark_tables_t& tables = state.world.landmark_table();
+        if (cachedRooms != nullptr)
+            *cachedRooms = static_cast<int>(tables.cached_rooms());
+        if (computedRooms != nullptr)
+            *computedRooms = static_cast<int>(tables.computed_rooms());
+    }
+
+    int ScreepsPathfinder_LoadPortals(ScreepsWorld* world, const ScreepsPortalNative* portals, int count)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (count < 0 || (count > 0 && portals == nullptr))
+            return -1;
+
+        std::vector<screeps::portal_t> entries(count);
+        for (int i = 0; i < count; ++i)
+        {
+            const auto& portal = portals[i];
+            if (portal.expiresTick < 0 ||
+                !ToWorldPosition(portal.source.x, portal.source.y, portal.source.roomName, entries[i].source) ||
+                !ToWorldPosition(portal.destination.x, portal.destination.y, portal.destination.roomName, entries[i].destination))
+                return -1;
+            entries[i].expires = static_cast<uint32_t>(portal.expiresTick);
+        }
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        state.world.load_portals(entries.data(), entries.size());
+        return 0;
+    }
+
+    int ScreepsPathfinder_ExpirePortals(ScreepsWorld* world, int tick)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (tick < 0)
+            return -1;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        std::unique_lock<std::shared_mutex> update = LockForUpdate(state);
+        if (!update.owns_lock())
+            return -3;
+
+        state.world.expire_portals(static_cast<uint32_t>(tick));
+        return 0;
+    }
+
+    int ScreepsPathfinder_Search(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        ScreepsPathfinderResultNative* result)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        return RunSearch(state, origin, goals, goalCount, options, nullptr, result);
+    }
+
+    int ScreepsPathfinder_SearchRouted(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        const ScreepsRouteOptionsNative* routeOptions,
+        ScreepsPathfinderResultNative* result)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (routeOptions == nullptr)
+            return -1;
+        return RunSearch(state, origin, goals, goalCount, options, routeOptions, result);
+    }
+
+    int ScreepsPathfinder_AdvanceEpoch(ScreepsWorld* world)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.epochMutex);
+        state.epochResults = true;
+        state.epochArena.reset();
+        return 0;
+    }
+
+    int ScreepsPathfinder_DumpTrace(ScreepsWorld* world, uint8_t* buffer, int capacity, int* written)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (capacity < 0 || (capacity > 0 && buffer == nullptr) || written == nullptr)
+            return -1;
+        *written = 0;
+
+        screeps::path_finder_t& pathfinder = state.syncPathfinder;
+        if (pathfinder.is_in_use())
+            return -5;
+        const screeps::trace_ring_t* trace = pathfinder.expansion_trace();
+        if (trace == nullptr)
+            return -2;
+
+        *written = static_cast<int>(trace->dump_size());
+        if (trace->dump_size() > static_cast<size_t>(capacity))
+            return -4;
+        trace->dump(buffer, static_cast<size_t>(capacity));
+        return 0;
+    }
+
+    int ScreepsPathfinder_StartWorkers(ScreepsWorld* world, int workerCount, int capacity)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (capacity <= 0)
+            return -1;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        if (!QueueIdle(state))
+            return -5;
+
+        size_t workers = workerCount > 0
+            ? static_cast<size_t>(workerCount)
+            : std::max<size_t>(1, std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+        state.searchQueue.reset();
+        state.searchQueue = std::make_shared<screeps::search_queue_t>(state.world, workers, static_cast<size_t>(capacity));
+        return 0;
+    }
+
+    void ScreepsPathfinder_StopWorkers(ScreepsWorld* world)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        state.searchQueue.reset();
+    }
+
+    int64_t ScreepsPathfinder_Submit(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        int priority)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (priority < 0 || priority >= static_cast<int>(screeps::k_search_priority_count))
+            return -1;
+
+        screeps::world_position_t originWorld;
+        thread_local std::vector<screeps::goal_t> goalBuffer;
+        screeps::search_options_native opts;
+        if (!ToSearchRequest(origin, goals, goalCount, options, originWorld, goalBuffer, opts))
+            return -1;
+
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        if (state.searchQueue == nullptr)
+            return -6;
+
+        screeps::search_ticket_t ticket = state.searchQueue->submit(
+            originWorld, goalBuffer.data(), goalBuffer.size(), opts, static_cast<screeps::search_priority>(priority));
+        if (ticket == 0)
+            return -5;
+        return static_cast<int64_t>(ticket);
+    }
+
+    int ScreepsPathfinder_Cancel(ScreepsWorld* world, int64_t ticket)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.queueMutex);
+        if (state.searchQueue == nullptr || ticket <= 0)
+            return -1;
+        return state.searchQueue->cancel(static_cast<screeps::search_ticket_t>(ticket)) ? 0 : -1;
+    }
+
+    int ScreepsPathfinder_PollCompletions(ScreepsWorld* world, ScreepsPathfinderCompletionNative* completions, int capacity, int timeoutMs)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (completions == nullptr || capacity <= 0)
+            return -1;
+
+        // Keep the pool alive while waiting without holding the lock, so submissions keep flowing
+        std::shared_ptr<screeps::search_queue_t> queue;
+        {
+            std::lock_guard<std::mutex> lock(state.queueMutex);
+            queue = state.searchQueue;
+        }
+        if (queue == nullptr)
+            return -6;
+
+        int count = 0;
+        queue->poll(
+            static_cast<size_t>(capacity),
+            std::chrono::milliseconds(std::max(timeoutMs, 0)),
+            [&](screeps::search_ticket_t ticket, bool cancelled, screeps::search_status status, const screeps::search_result_native& nativeResult)
+            {
+                ScreepsPathfinderCompletionNative& completion = completions[count++];
+                completion.ticket = static_cast<int64_t>(ticket);
+                ResetResult(&completion.result);
+                completion.status = cancelled ? -7 : FillResult(state, status, nativeResult, &completion.result);
+            });
+        return count;
+    }
+
+    int ScreepsPathfinder_DistanceTransform(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        bool edgesBlock,
+        uint8_t* output)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        screeps::room_grid_t grid;
+        int code = LoadRoomGrid(state, roomName, costMatrix, output, grid);
+        if (code != 0)
+            return code;
+
+        grid.distance_transform(edgesBlock, output);
+        return 0;
+    }
+
+    int ScreepsPathfinder_FloodFill(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsRoomTile* sources,
+        int sourceCount,
+        int maxRange,
+        uint8_t* output)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (sourceCount < 0 || (sourceCount > 0 && sources == nullptr) || maxRange < 0)
+            return -1;
+
+        screeps::room_grid_t grid;
+        int code = LoadRoomGrid(state, roomName, costMatrix, output, grid);
+        if (code != 0)
+            return code;
+
+        thread_local std::vector<screeps::room_tile_t> tiles;
+        tiles.clear();
+        for (int ii = 0; ii < sourceCount; ++ii)
+        {
+            if (sources[ii].x < 0 || sources[ii].x >= 50 || sources[ii].y < 0 || sources[ii].y >= 50)
+                return -1;
+            tiles.push_back(screeps::room_tile_t{static_cast<uint8_t>(sources[ii].x), static_cast<uint8_t>(sources[ii].y)});
+        }
+        grid.flood_fill(tiles.data(), tiles.size(), static_cast<unsigned>(maxRange), output);
+        return 0;
+    }
+
+    int ScreepsPathfinder_ExitDistance(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        int exitMask,
+        int maxRange,
+        uint8_t* output)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (exitMask < 0 || exitMask > 15 || maxRange < 0)
+            return -1;
+
+        screeps::room_grid_t grid;
+        int code = LoadRoomGrid(state, roomName, costMatrix, output, grid);
+        if (code != 0)
+            return code;
+
+        grid.exit_distance(static_cast<uint8_t>(exitMask), static_cast<unsigned>(maxRange), output);
+        return 0;
+    }
+
+    int ScreepsPathfinder_MinCut(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsRoomTile* protectedTiles,
+        int protectedCount,
+        ScreepsRoomTile* cut,
+        int cutCapacity,
+        int* cutCount)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (protectedCount <= 0 || protectedTiles == nullptr || cutCapacity < 0 || (cutCapacity > 0 && cut == nullptr) || cutCount == nullptr)
+            return -1;
+        *cutCount = 0;
+
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (!ParseRoomName(roomName, roomX, roomY))
+            return -1;
+
+        thread_local std::vector<screeps::room_tile_t> tiles;
+        tiles.clear();
+        for (int ii = 0; ii < protectedCount; ++ii)
+        {
+            if (protectedTiles[ii].x < 0 || protectedTiles[ii].x >= 50 || protectedTiles[ii].y < 0 || protectedTiles[ii].y >= 50)
+                return -1;
+            tiles.push_back(screeps::room_tile_t{static_cast<uint8_t>(protectedTiles[ii].x), static_cast<uint8_t>(protectedTiles[ii].y)});
+        }
+
+        thread_local screeps::room_min_cut_t solver;
+        thread_local std::vector<screeps::room_tile_t> cutTiles;
+        switch (solver.solve(state.world, screeps::map_position_t(roomX, roomY), costMatrix, tiles.data(), tiles.size(), cutTiles))
+        {
+        case screeps::min_cut_status::InvalidRoom:
+            return -2;
+        case screeps::min_cut_status::NoCut:
+            return -3;
+        case screeps::min_cut_status::Success:
+            break;
+        }
+
+        *cutCount = static_cast<int>(cutTiles.size());
+        if (cutTiles.size() > static_cast<size_t>(cutCapacity))
+            return -4;
+        for (size_t ii = 0; ii < cutTiles.size(); ++ii)
+            cut[ii] = ScreepsRoomTile{cutTiles[ii].xx, cutTiles[ii].yy};
+        return 0;
+    }
+
+    int ScreepsPathfinder_AdvanceReservations(ScreepsWorld* world, int tick)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (tick < 0)
+            return -1;
+        std::lock_guard<std::mutex> lock(state.cooperativeMutex);
+        state.reservations.advance(static_cast<uint32_t>(tick));
+        return 0;
+    }
+
+    int ScreepsPathfinder_PlanCooperative(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsCooperativeAgentNative* agents,
+        int agentCount,
+        const ScreepsCooperativeOptionsNative* options,
+        ScreepsRoomTile* steps,
+        int* stepCounts)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (agentCount < 0 || (agentCount > 0 && (agents == nullptr || steps == nullptr || stepCounts == nullptr)) || options == nullptr)
+            return -1;
+        if (options->plainCost <= 0 || options->swampCost <= 0 || options->plainCost > 255 || options->swampCost > 255)
+            return -1;
+
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (!ParseRoomName(roomName, roomX, roomY))
+            return -1;
+
+        auto inRoom = [](const ScreepsRoomTile& tile) {
+            return tile.x >= 0 && tile.x < 50 && tile.y >= 0 && tile.y < 50;
+        };
+        thread_local std::vector<screeps::cooperative_agent_t> batch;
+        batch.clear();
+        for (int ii = 0; ii < agentCount; ++ii)
+        {
+            const ScreepsCooperativeAgentNative& agent = agents[ii];
+            if (agent.agentId < 0 || !inRoom(agent.origin) || !inRoom(agent.goal) || agent.range < 0)
+                return -1;
+            batch.push_back(screeps::cooperative_agent_t{
+                static_cast<uint32_t>(agent.agentId),
+                screeps::room_tile_t{static_cast<uint8_t>(agent.origin.x), static_cast<uint8_t>(agent.origin.y)},
+                screeps::room_tile_t{static_cast<uint8_t>(agent.goal.x), static_cast<uint8_t>(agent.goal.y)},
+                static_cast<uint8_t>(std::min(agent.range, 49)),
+                agent.priority
+            });
+        }
+
+        screeps::cooperative_options_t nativeOptions;
+        nativeOptions.window = static_cast<unsigned>(std::clamp(options->window, 1, static_cast<int>(screeps::reservation_table_t::k_window) - 1));
+        nativeOptions.plain_cost = static_cast<screeps::cost_t>(options->plainCost);
+        nativeOptions.swamp_cost = static_cast<screeps::cost_t>(options->swampCost);
+
+        std::lock_guard<std::mutex> lock(state.cooperativeMutex);
+        thread_local std::vector<screeps::room_tile_t> tiles;
+        tiles.resize(batch.size() * nativeOptions.window);
+        if (!state.cooperativePlanner.plan(
+                state.world,
+                screeps::map_position_t(roomX, roomY),
+                costMatrix,
+                batch.data(),
+                batch.size(),
+                nativeOptions,
+                state.reservations,
+                tiles.data(),
+                stepCounts))
+            return -2;
+
+        for (size_t ii = 0; ii < batch.size(); ++ii)
+        {
+            for (int step = 0; step < stepCounts[ii]; ++step)
+            {
+                const screeps::room_tile_t& tile = tiles[ii * nativeOptions.window + step];
+                steps[ii * nativeOptions.window + step] = ScreepsRoomTile{tile.xx, tile.yy};
+            }
+        }
+        return 0;
+    }
+
+    int ScreepsPathfinder_SetCostMatrix(ScreepsWorld* world, const char* roomName, const uint8_t* costMatrix)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (!ParseRoomName(roomName, roomX, roomY))
+            return -1;
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        state.costMatrices.set(screeps::map_position_t(roomX, roomY), costMatrix);
+        state.world.note_cost_matrix_change();
+        return 0;
+    }
+
+    void ScreepsPathfinder_ClearCostMatrices(ScreepsWorld* world)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        state.costMatrices.clear();
+        state.world.note_cost_matrix_change();
+    }
+
+    int ScreepsPathfinder_BuildCostMatrix(
+        const ScreepsRoomObjectNative* objects,
+        int count,
+        const ScreepsCostMatrixProfileNative* profile,
+        const uint8_t* baseMatrix,
+        uint8_t* costMatrix)
+    {
+        screeps::cost_matrix_profile_t rules;
+        if (count < 0 || (count > 0 && objects == nullptr) || costMatrix == nullptr || !ToCostMatrixProfile(profile, rules))
+            return -1;
+        screeps::cost_matrix_builder_t::build(
+            reinterpret_cast<const screeps::room_object_t*>(objects), static_cast<size_t>(count), rules, baseMatrix, costMatrix);
+        return 0;
+    }
+
+    int ScreepsPathfinder_SetCostMatrixFromObjects(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsRoomObjectNative* objects,
+        int count,
+        const ScreepsCostMatrixProfileNative* profile,
+        const uint8_t* baseMatrix)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        screeps::cost_matrix_profile_t rules;
+        if (count < 0 || (count > 0 && objects == nullptr) || !ParseRoomName(roomName, roomX, roomY) || !ToCostMatrixProfile(profile, rules))
+            return -1;
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        screeps::cost_matrix_builder_t::build(
+            reinterpret_cast<const screeps::room_object_t*>(objects),
+            static_cast<size_t>(count),
+            rules,
+            baseMatrix,
+            state.costMatrices.edit(screeps::map_position_t(roomX, roomY)));
+        state.world.note_cost_matrix_change();
+        return 0;
+    }
+
+    void ScreepsPathfinder_UseRegisteredCostMatrices(ScreepsWorld* world, int enabled)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        state.useRegisteredMatrices.store(enabled != 0);
+        state.world.note_cost_matrix_change();
+        InstallRoomCallback(state);
+    }
+
+    int ScreepsPathfinder_BuildThreatMatrix(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsThreatSourceNative* sources,
+        int count,
+        const ScreepsThreatProfileNative* profile,
+        const uint8_t* baseMatrix,
+        uint8_t* costMatrix)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        screeps::threat_profile_t rules;
+        if (costMatrix == nullptr || !ToThreatProfile(profile, rules))
+            return -1;
+        screeps::map_position_t room;
+        const uint8_t* terrain = nullptr;
+        int code = ResolveThreatRoom(state, roomName, sources, count, room, terrain);
+        if (code != 0)
+            return code;
+        screeps::threat_map_t::build(
+            reinterpret_cast<const screeps::threat_source_t*>(sources), static_cast<size_t>(count), rules, terrain, baseMatrix, costMatrix);
+        return 0;
+    }
+
+    int ScreepsPathfinder_SetCostMatrixFromThreats(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsThreatSourceNative* sources,
+        int count,
+        const ScreepsThreatProfileNative* profile,
+        const uint8_t* baseMatrix)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        screeps::threat_profile_t rules;
+        if (!ToThreatProfile(profile, rules))
+            return -1;
+        screeps::map_position_t room;
+        const uint8_t* terrain = nullptr;
+        int code = ResolveThreatRoom(state, roomName, sources, count, room, terrain);
+        if (code != 0)
+            return code;
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        screeps::threat_map_t::build(
+            reinterpret_cast<const screeps::threat_source_t*>(sources), static_cast<size_t>(count), rules, terrain, baseMatrix, state.costMatrices.edit(room));
+        state.world.note_cost_matrix_change();
+        return 0;
+    }
+
+    int ScreepsPathfinder_SetCostOverlay(ScreepsWorld* world, const char* roomName, const ScreepsCostOverrideNative* entries, int count)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (count < 0 || (count > 0 && entries == nullptr) || !ParseRoomName(roomName, roomX, roomY))
+            return -1;
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        state.costMatrices.set_overlay(
+            screeps::map_position_t(roomX, roomY), reinterpret_cast<const screeps::cost_override_t*>(entries), static_cast<size_t>(count));
+        state.world.note_cost_overlay_change();
+        return 0;
+    }
+
+    void ScreepsPathfinder_ClearCostOverlays(ScreepsWorld* world)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        state.costMatrices.clear_overlays();
+        state.world.note_cost_overlay_change();
+    }
+
+    int ScreepsPathfinder_PackPath(const ScreepsPathfinderPoint* points, int count, uint32_t* packed)
+    {
+        if (count < 0 || (count > 0 && (points == nullptr || packed == nullptr)))
+            return -1;
+        for (int ii = 0; ii < count; ++ii)
+        {
+            screeps::world_position_t pos;
+            if (!ToWorldPosition(points[ii].x, points[ii].y, points[ii].roomName, pos))
+                return -1;
+            packed[ii] = static_cast<uint32_t>(pos.xx) | static_cast<uint32_t>(pos.yy) << 16;
+        }
+        return 0;
+    }
+
+    int ScreepsPathfinder_ValidatePaths(
+        ScreepsWorld* world,
+        const uint32_t* steps,
+        const int* pathOffsets,
+        int pathCount,
+        int plainCost,
+        int swampCost,
+        ScreepsPathCheckNative* results)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (pathCount < 0 || (pathCount > 0 && (pathOffsets == nullptr || results == nullptr)))
+            return -1;
+        if (plainCost < 1 || plainCost > 254 || swampCost < 1 || swampCost > 254)
+            return -1;
+        if (pathCount == 0)
+            return 0;
+
+        thread_local std::vector<uint32_t> offsets;
+        offsets.resize(static_cast<size_t>(pathCount) + 1);
+        for (int ii = 0; ii <= pathCount; ++ii)
+        {
+            if (pathOffsets[ii] < 0 || (ii > 0 && pathOffsets[ii] < pathOffsets[ii - 1]))
+                return -1;
+            offsets[ii] = static_cast<uint32_t>(pathOffsets[ii]);
+        }
+        if (offsets[pathCount] > offsets[0] && steps == nullptr)
+            return -1;
+
+        thread_local std::vector<screeps::path_check_t> checks;
+        checks.resize(static_cast<size_t>(pathCount));
+        {
+            std::lock_guard<std::mutex> lock(state.matrixMutex);
+            state.pathValidator.validate(state.world, steps, offsets.data(), checks.size(), &state.costMatrices, plainCost, swampCost, checks.data());
+        }
+        for (int ii = 0; ii < pathCount; ++ii)
+            results[ii] = ScreepsPathCheckNative{checks[ii].first_blocked, static_cast<int>(checks[ii].cost)};
+        return 0;
+    }
+
+    int ScreepsPathfinder_GetTerrain(ScreepsWorld* world, const uint32_t* tiles, int count, uint8_t* terrain)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (count < 0 || (count > 0 && (tiles == nullptr || terrain == nullptr)))
+            return -1;
+        screeps::terrain_query_t::terrain_at(state.world, tiles, static_cast<size_t>(count), terrain);
+        return 0;
+    }
+
+    int ScreepsPathfinder_GetMoveCosts(
+        ScreepsWorld* world,
+        const uint32_t* tiles,
+        int count,
+        int plainCost,
+        int swampCost,
+        uint8_t* costs)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (count < 0 || (count > 0 && (tiles == nullptr || costs == nullptr)))
+            return -1;
+        if (plainCost < 1 || plainCost > 254 || swampCost < 1 || swampCost > 254)
+            return -1;
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        screeps::terrain_query_t::move_costs(
+            state.world, tiles, static_cast<size_t>(count), &state.costMatrices, static_cast<uint8_t>(plainCost), static_cast<uint8_t>(swampCost), costs);
+        return 0;
+    }
+
+    int ScreepsPathfinder_GetWalkableMask(
+        ScreepsWorld* world,
+        const char* roomName,
+        int minX,
+        int minY,
+        int maxX,
+        int maxY,
+        int useRegisteredMatrix,
+        uint64_t* rows)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        uint8_t roomX = 0;
+        uint8_t roomY = 0;
+        if (rows == nullptr || minX < 0 || minY < 0 || maxX > 49 || maxY > 49 || minX > maxX || minY > maxY || !ParseRoomName(roomName, roomX, roomY))
+            return -1;
+        screeps::map_position_t room(roomX, roomY);
+        screeps::room_tile_t min{static_cast<uint8_t>(minX), static_cast<uint8_t>(minY)};
+        screeps::room_tile_t max{static_cast<uint8_t>(maxX), static_cast<uint8_t>(maxY)};
+        std::lock_guard<std::mutex> lock(state.matrixMutex);
+        const uint8_t* matrix = useRegisteredMatrix != 0 ? state.costMatrices.get(room) : nullptr;
+        return screeps::terrain_query_t::walkable_mask(state.world, room, min, max, matrix, rows) ? 0 : -2;
+    }
+
+    int ScreepsPathfinder_FindRoute(
+        ScreepsWorld* world,
+        const char* fromRoom,
+        const char* toRoom,
+        const ScreepsRouteOptionsNative* options,
+        ScreepsRouteResultNative* result)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (result == nullptr)
+            return -1;
+
+        result->rooms = nullptr;
+        result->roomCount = 0;
+        result->cost = 0;
+
+        uint8_t fromX = 0;
+        uint8_t fromY = 0;
+        uint8_t toX = 0;
+        uint8_t toY = 0;
+        if (!ParseRoomName(fromRoom, fromX, fromY) || !ParseRoomName(toRoom, toX, toY))
+            return -1;
+
+        thread_local std::vector<screeps::room_route_cost_t> routeCosts;
+        screeps::room_route_options_t nativeOptions;
+        if (options != nullptr && !ToRouteOptions(options, routeCosts, nativeOptions))
+            return -1;
+
+        thread_local screeps::room_router_t router;
+        thread_local std::vector<screeps::map_position_t> route;
+        double cost = 0;
+        std::shared_lock<std::shared_mutex> reading(state.readersMutex);
+        screeps::route_status status = router.find_route(
+            state.world, screeps::map_position_t(fromX, fromY), screeps::map_position_t(toX, toY), nativeOptions, route, &cost);
+        if (status == screeps::route_status::InvalidRoom)
+            return -2;
+        if (status == screeps::route_status::NoRoute)
+            return -3;
+
+        result->rooms = AllocateResultArray<ScreepsRouteRoom>(state, route.size());
+        if (result->rooms == nullptr)
+            return -4;
+
+        for (size_t ii = 0; ii < route.size(); ++ii)
+            FormatRoomName(route[ii].xx, route[ii].yy, result->rooms[ii].roomName, sizeof(result->rooms[ii].roomName));
+        result->roomCount = static_cast<int>(route.size());
+        result->cost = cost;
+        return 0;
+    }
+
+    void ScreepsPathfinder_FreeRoute(ScreepsWorld* world, ScreepsRouteResultNative* result)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (result == nullptr || result->rooms == nullptr)
+            return;
+
+        ReleaseResultArray(state, result->rooms);
+        result->rooms = nullptr;
+        result->roomCount = 0;
+    }
+
+    void ScreepsPathfinder_FreeResult(ScreepsWorld* world, ScreepsPathfinderResultNative* result)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (result == nullptr || result->path == nullptr)
+            return;
+
+        ReleaseResultArray(state, result->path);
+        result->path = nullptr;
+        result->pathLength = 0;
+    }
+
+    int ScreepsPathfinder_PathTileCount(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderPoint* waypoints,
+        int waypointCount)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        screeps::world_position_t originWorld;
+        thread_local std::vector<screeps::world_position_t> buffer;
+        if (!ToWaypoints(origin, waypoints, waypointCount, originWorld, buffer))
+            return -1;
+
+        std::shared_lock<std::shared_mutex> reading(state.readersMutex);
+        size_t tiles = screeps::path_expander_t::tile_count(state.world, originWorld, buffer.data(), buffer.size());
+        return static_cast<int>(std::min<size_t>(tiles, std::numeric_limits<int>::max()));
+    }
+
+    int ScreepsPathfinder_ExpandPath(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderPoint* waypoints,
+        int waypointCount,
+        int firstTile,
+        ScreepsPathfinderPoint* tiles,
+        int tileCapacity)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        if (firstTile < 0 || tileCapacity < 0 || (tileCapacity > 0 && tiles == nullptr))
+            return -1;
+
+        screeps::world_position_t originWorld;
+        thread_local std::vector<screeps::world_position_t> buffer;
+        if (!ToWaypoints(origin, waypoints, waypointCount, originWorld, buffer))
+            return -1;
+
+        std::shared_lock<std::shared_mutex> reading(state.readersMutex);
+        screeps::path_expander_t expander(state.world, originWorld, buffer.data(), buffer.size());
+        expander.seek(static_cast<size_t>(firstTile));
+        int written = 0;
+        screeps::world_position_t chunk[64];
+        while (written < tileCapacity)
+        {
+            size_t count = expander.next(chunk, std::min<size_t>(64, static_cast<size_t>(tileCapacity - written)));
+            if (count == 0)
+                break;
+            for (size_t ii = 0; ii < count; ++ii)
+                ToPoint(chunk[ii], tiles[written++]);
+        }
+        return written;
+    }
+
+    void ScreepsPathfinder_SetRoomCallback(ScreepsWorld* world, ScreepsRoomCallback callback, void* userData)
+    {
+        ScreepsWorld& state = ResolveWorld(world);
+        state.roomCallback = callback;
+        state.roomUserData = userData;
+        InstallRoomCallback(state);
     }
 }
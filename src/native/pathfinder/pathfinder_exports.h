@@ -38,6 +38,12 @@ extern "C"
         int plainCost;
         int swampCost;
         double heuristicWeight;
+        bool skipRoomCallback; // no room callback work for this search (lets the solver use terrain-only kernels)
+        bool waypointsOnly;    // path holds only jump points; expand with ScreepsPathfinder_ExpandPath
+        bool ignoreCreeps;     // leave registered cost overlays (SetCostOverlay) out of this search
+        int parallelThreads;   // >1: Search/SearchRouted spread this one search over that many threads
+        bool learnHeuristic;   // single-goal seeks read and feed the goal's learned heuristic (SetLearnedHeuristics)
+        int heuristicVersion;  // bump when the managed room callback's matrices change; other versions learn apart
     };
 
     struct ScreepsPathfinderPoint
@@ -56,6 +62,121 @@ extern "C"
         bool incomplete;
     };
 
+    struct ScreepsRouteRoomCost
+    {
+        const char* roomName;
+        double cost;
+        bool blocked;
+    };
+
+    struct ScreepsRouteOptionsNative
+    {
+        const ScreepsRouteRoomCost* roomCosts;
+        int roomCostCount;
+        double defaultCost;      // entry cost for rooms without an override (<= 0 means 1)
+        int maxRoomsExplored;    // <= 0 keeps the router default
+        int corridorMargin;      // rooms around the route a routed search may still enter
+    };
+
+    struct ScreepsRouteRoom
+    {
+        char roomName[16];
+    };
+
+    struct ScreepsRouteResultNative
+    {
+        ScreepsRouteRoom* rooms;
+        int roomCount;
+        double cost;
+    };
+
+    struct ScreepsPathfinderCompletionNative
+    {
+        int64_t ticket;
+        int status;                              // Search return code, or -7 when the ticket was cancelled
+        ScreepsPathfinderResultNative result;    // release with ScreepsPathfinder_FreeResult
+    };
+
+    struct ScreepsRoomTile
+    {
+        int x;
+        int y;
+    };
+
+    struct ScreepsCooperativeAgentNative
+    {
+        int agentId;             // stable across ticks; replanning an agent replaces its earlier reservations
+        ScreepsRoomTile origin;
+        ScreepsRoomTile goal;
+        int range;
+        int priority;            // lower values are planned first
+    };
+
+    struct ScreepsCooperativeOptionsNative
+    {
+        int window;              // ticks planned per agent, clamped to 1-63
+        int plainCost;
+        int swampCost;
+    };
+
+    struct ScreepsPathCheckNative
+    {
+        int firstBlocked;        // first step that is blocked or not adjacent to the previous one, -1 when none is
+        int cost;                // cost of the steps before firstBlocked (the whole path when it is intact)
+    };
+
+    struct ScreepsPortalNative
+    {
+        ScreepsPathfinderPoint source;
+        ScreepsPathfinderPoint destination;
+        int expiresTick;         // tick the portal disappears on, 0 for a permanent portal
+    };
+
+    struct ScreepsRoomObjectNative
+    {
+        uint8_t x;
+        uint8_t y;
+        uint8_t kind;            // 0 road, 1 construction site, 2 rampart, 3 blocking structure, 4 creep
+        uint8_t flags;           // 1 when the object is the searching player's own
+    };
+
+    struct ScreepsCostOverrideNative
+    {
+        uint8_t x;
+        uint8_t y;
+        uint8_t cost;            // 255 blocks; never lowers a tile the matrix below already blocks
+    };
+
+    struct ScreepsCostMatrixProfileNative
+    {
+        int road;                // matrix value per kind, 0-255; 0 leaves the tile to the layers below, 255 blocks it
+        int ownSite;
+        int hostileSite;
+        int ownRampart;
+        int hostileRampart;
+        int blocking;
+        int ownCreep;
+        int hostileCreep;
+    };
+
+    struct ScreepsThreatSourceNative
+    {
+        uint8_t x;
+        uint8_t y;
+        uint8_t kind;            // 0 tower, 1 melee creep (range 1), 2 ranged creep (range 3)
+        uint8_t reach;           // extra range for creeps, the tiles they can close before striking
+        uint16_t strength;       // damage per tick; towers deal it up to range 5, a quarter from range 20
+    };
+
+    struct ScreepsThreatProfileNative
+    {
+        int plainCost;           // cost of threatened tiles the base matrix leaves at 0, 1-254
+        int swampCost;
+        int maxCost;             // cap for threatened tiles, 1-254; never lowers a tile
+        int threatPerCost;       // damage per added cost step, at least 1
+        int blockThreshold;      // damage that blocks a tile outright, 0 for never
+    };
+
     typedef bool (*ScreepsRoomCallback)(
         uint8_t roomX,
         uint8_t roomY,
@@ -64,13 +185,290 @@ extern "C"
         bool* blockRoom,
         void* userData);
 
-    SCREEPS_PATHFINDER_API int ScreepsPathfinder_LoadTerrain(const ScreepsTerrainRoom* rooms, int count);
+    // A world holds everything the calls below read and change: terrain, portals, landmarks and the
+    // precompute cache, registered cost matrices and overlays, the room callback, the worker pool, the
+    // result epoch and cooperative reservations. Worlds share nothing, so searches on different worlds run
+    // concurrently without contending with each other. A null world is the process's default world, which
+    // always exists. DestroyWorld stops the world's workers and frees its state, including epoch results;
+    // no call on the world may be running. A null world is left alone.
+    //
+    // LoadTerrain, LoadTerrainRaw, SetLandmarks, SetPrecomputeCache, SetLearnedHeuristics, LoadPortals and
+    // ExpirePortals change what searches read: they return -3 instead while any search on the world is in
+    // flight (queued, synchronous or parallel) or a FindRoute or path expansion runs on it.
+    struct ScreepsWorld;
+    SCREEPS_PATHFINDER_API ScreepsWorld* ScreepsPathfinder_CreateWorld();
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_DestroyWorld(ScreepsWorld* world);
+
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_LoadTerrain(ScreepsWorld* world, const ScreepsTerrainRoom* rooms, int count);
+    // Like LoadTerrain, but takes terrain as the game hands it out: terrainLength 2500 is one code per tile,
+    // y-major (terrain[y * 50 + x]) as 0-3 or '0'-'3'; 625 is already packed. Conversion runs natively on
+    // `threads` threads (0 for one per core). Rooms with a bad name, length or code are skipped and counted
+    // in *rejected when it is non-null. Returns 0, -1 for bad arguments, -2 when no room loaded or -3 while
+    // searches are in flight.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_LoadTerrainRaw(ScreepsWorld* world, const ScreepsTerrainRoom* rooms, int count, int threads, int* rejected);
+    // ALT landmarks: landmarksPerRoom (0-8, 0 turns them off) terrain-only distance tables per room, built now on
+    // `threads` threads (0 for one per core) and again after every LoadTerrain. Searches then bound the
+    // remaining cost inside goal rooms by the landmark triangle inequality as well. Returns 0, -1 for bad
+    // arguments or -3 while searches are in flight.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetLandmarks(ScreepsWorld* world, int landmarksPerRoom, int threads);
+    // Persists terrain-derived tables (landmarks) in the file at `path`, keyed by each room's terrain content.
+    // Call it before LoadTerrain/SetLandmarks: later builds copy the tables of rooms whose terrain the file
+    // holds, compute the rest and rewrite the file when it changed. A null or empty path turns it off.
+    // Returns 1 when an existing file was read, 0 when it was missing or unusable (it is recreated), or -3
+    // while searches are in flight. PrecomputeCacheStats reports the rooms of the last landmark build
+    // taken from the file and computed.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetPrecomputeCache(ScreepsWorld* world, const char* path);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_PrecomputeCacheStats(ScreepsWorld* world, int* cachedRooms, int* computedRooms);
+    // Adaptive A*: searches with options->learnHeuristic to one goal keep, per goal, lower bounds on the cost
+    // to it from every tile a heuristicWeight 1 search expanded, and later searches to the goal estimate
+    // with them. Feeding searches expand tile by tile, so their paths are exact; one that runs out of
+    // rooms (maxRooms) feeds nothing and is searched again with jump points. maxRoomGrids (5 KB
+    // each) caps what is held across goals, least recently used goals first; 0 turns learning off and
+    // drops every table. Terrain and portal loads drop them as well, and registered cost matrix and
+    // overlay changes retire them.
+    // Returns 0, -1 for bad arguments or -3 while searches are in flight. LearnedHeuristicGrids
+    // returns the room grids held.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetLearnedHeuristics(ScreepsWorld* world, int maxRoomGrids);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_LearnedHeuristicGrids(ScreepsWorld* world);
+    // Replaces the portal table. Stepping onto a source moves the creep to its destination at no cost; later
+    // entries win for a repeated source. ExpirePortals drops the portals expiring at or before `tick`. Both
+    // return 0, -1 for bad arguments or -3 while searches are in flight.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_LoadPortals(ScreepsWorld* world, const ScreepsPortalNative* portals, int count);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_ExpirePortals(ScreepsWorld* world, int tick);
+    // Synchronous searches. With options->parallelThreads above 1 (at most 64) the one search is spread
+    // over that many threads with hash-distributed A*: same cost bound as the weighted search, no jump
+    // points, worth it for searches of hundreds of thousands of ops. Worlds with portals always search
+    // on one thread. Returns -5 while the world's parallel engine is busy with another search.
     SCREEPS_PATHFINDER_API int ScreepsPathfinder_Search(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        ScreepsPathfinderResultNative* result);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SearchRouted(
+        ScreepsWorld* world,
         const ScreepsPathfinderPoint* origin,
         const ScreepsPathfinderGoal* goals,
         int goalCount,
         const ScreepsPathfinderOptionsNative* options,
+        const ScreepsRouteOptionsNative* routeOptions,
         ScreepsPathfinderResultNative* result);
-    SCREEPS_PATHFINDER_API void ScreepsPathfinder_FreeResult(ScreepsPathfinderResultNative* result);
-    SCREEPS_PATHFINDER_API void ScreepsPathfinder_SetRoomCallback(ScreepsRoomCallback callback, void* userData);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_FreeResult(ScreepsWorld* world, ScreepsPathfinderResultNative* result);
+
+    // Expansion of waypoint-only results. Tiles come out in full-result order (end of the path first,
+    // origin excluded); `firstTile` skips into the path so callers can expand just the steps they need.
+    // ExpandPath returns the number of tiles written, PathTileCount the full length, -1 on bad arguments.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_PathTileCount(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderPoint* waypoints,
+        int waypointCount);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_ExpandPath(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderPoint* waypoints,
+        int waypointCount,
+        int firstTile,
+        ScreepsPathfinderPoint* tiles,
+        int tileCapacity);
+
+    // Starts a new result epoch, typically once per tick. After the first call, result paths and routes
+    // are served from an epoch arena: they stay valid until the next AdvanceEpoch, and FreeResult /
+    // FreeRoute only clear the struct. Before it, every result is heap allocated and must be freed.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_AdvanceEpoch(ScreepsWorld* world);
+
+    // Copies the expansion trace of the last synchronous search (see trace.h for the format). Returns 0,
+    // -1 for bad arguments, -2 when the library was built without SCREEPS_PATHFINDER_TRACE, -4 when
+    // `capacity` is too small and -5 while a search is running. `written` receives the dump size, also on
+    // -4, so callers can size the buffer with a zero-capacity call.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_DumpTrace(ScreepsWorld* world, uint8_t* buffer, int capacity, int* written);
+
+    // Asynchronous searches. Workers run on native threads, so the room callback must tolerate being
+    // invoked concurrently, and terrain cannot be reloaded while tickets are in flight.
+    // priority: 0 = high, 1 = normal, 2 = low. Submit returns a ticket (> 0), -1 for bad arguments,
+    // -5 when `capacity` tickets are in flight and -6 when the workers were not started.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_StartWorkers(ScreepsWorld* world, int workerCount, int capacity);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_StopWorkers(ScreepsWorld* world);
+    SCREEPS_PATHFINDER_API int64_t ScreepsPathfinder_Submit(
+        ScreepsWorld* world,
+        const ScreepsPathfinderPoint* origin,
+        const ScreepsPathfinderGoal* goals,
+        int goalCount,
+        const ScreepsPathfinderOptionsNative* options,
+        int priority);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_Cancel(ScreepsWorld* world, int64_t ticket);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_PollCompletions(
+        ScreepsWorld* world,
+        ScreepsPathfinderCompletionNative* completions,
+        int capacity,
+        int timeoutMs);
+
+    // Room analysis over loaded terrain. `costMatrix` is optional (2500 bytes, [x * 50 + y]): nonzero entries
+    // override terrain and 255 blocks. Each kernel writes a 2500-byte grid in the same layout, with 255 for
+    // tiles out of range or unreachable. exitMask: 1 top, 2 right, 4 bottom, 8 left, 0 for all exits.
+    // Returns 0, -1 for bad arguments and -2 when the room has no terrain loaded.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_DistanceTransform(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        bool edgesBlock,
+        uint8_t* output);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_FloodFill(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsRoomTile* sources,
+        int sourceCount,
+        int maxRange,
+        uint8_t* output);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_ExitDistance(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        int exitMask,
+        int maxRange,
+        uint8_t* output);
+
+    // Cheapest rampart line separating `protectedTiles` from the room exits. Cost matrix entries other than
+    // 0 and 255 are the price of building on that tile (1 otherwise). Tiles on or next to an exit are never
+    // chosen. Writes up to `cutCapacity` tiles and the full count to `cutCount`. Returns 0, -1 for bad
+    // arguments, -2 when the room has no terrain loaded, -3 when a protected tile is open to an exit and
+    // -4 when `cut` is too small (`cutCount` still holds the required size).
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_MinCut(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsRoomTile* protectedTiles,
+        int protectedCount,
+        ScreepsRoomTile* cut,
+        int cutCapacity,
+        int* cutCount);
+
+    // Cooperative planning for the creeps of one room against a shared (tile, tick) reservation table.
+    // AdvanceReservations sets the current game tick; reservations for earlier ticks expire. PlanCooperative
+    // plans the batch in priority order for `window` ticks after the current one: `steps` holds `window`
+    // tiles per agent (agent i at steps[i * window]) and `stepCounts[i]` the tiles used, fewer when the goal
+    // is reached early and -1 when the agent cannot move without a collision. Returns 0, -1 for bad
+    // arguments and -2 when the room has no terrain loaded.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_AdvanceReservations(ScreepsWorld* world, int tick);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_PlanCooperative(
+        ScreepsWorld* world,
+        const char* roomName,
+        const uint8_t* costMatrix,
+        const ScreepsCooperativeAgentNative* agents,
+        int agentCount,
+        const ScreepsCooperativeOptionsNative* options,
+        ScreepsRoomTile* steps,
+        int* stepCounts);
+
+    // Cost matrices registered per room for bulk operations (2500 bytes, [x * 50 + y], copied). A null matrix
+    // removes the room's entry. Return 0 or -1 for bad arguments.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetCostMatrix(ScreepsWorld* world, const char* roomName, const uint8_t* costMatrix);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_ClearCostMatrices(ScreepsWorld* world);
+
+    // Cost matrices from object lists. Objects apply in layers (roads, sites, ramparts, blocking structures,
+    // creeps): a later layer overrides an earlier one on the same tile and 255 always wins. baseMatrix (2500
+    // bytes, may be null for an empty start) holds earlier layers, e.g. a room's static structures built
+    // once. BuildCostMatrix writes the result to costMatrix, which may be baseMatrix itself; the FromObjects
+    // variant registers it for the room instead. UseRegisteredCostMatrices(1) makes searches read registered
+    // matrices for rooms the room callback leaves without one. All return 0 or -1 for bad arguments.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_BuildCostMatrix(
+        const ScreepsRoomObjectNative* objects,
+        int count,
+        const ScreepsCostMatrixProfileNative* profile,
+        const uint8_t* baseMatrix,
+        uint8_t* costMatrix);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetCostMatrixFromObjects(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsRoomObjectNative* objects,
+        int count,
+        const ScreepsCostMatrixProfileNative* profile,
+        const uint8_t* baseMatrix);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_UseRegisteredCostMatrices(ScreepsWorld* world, int enabled);
+
+    // Threat-weighted cost matrices for flee and combat pathing from hostile towers and creeps. Damage sums
+    // over all sources per tile; a tile with any costs its base value (the terrain cost under a 0) plus
+    // damage / threatPerCost, capped at maxCost, and blocks at blockThreshold. Walls and blocked tiles stay
+    // as they are, as does baseMatrix (may be null for an empty start) elsewhere. BuildThreatMatrix writes
+    // to costMatrix, which may be baseMatrix itself; the SetCostMatrixFromThreats variant registers the
+    // result for the room instead. Both return 0, -1 for bad arguments and -2 when the room has no terrain
+    // loaded.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_BuildThreatMatrix(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsThreatSourceNative* sources,
+        int count,
+        const ScreepsThreatProfileNative* profile,
+        const uint8_t* baseMatrix,
+        uint8_t* costMatrix);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetCostMatrixFromThreats(
+        ScreepsWorld* world,
+        const char* roomName,
+        const ScreepsThreatSourceNative* sources,
+        int count,
+        const ScreepsThreatProfileNative* profile,
+        const uint8_t* baseMatrix);
+
+    // Sparse per-tick layer over a room's registered matrix, typically creep positions: replacing it costs
+    // O(count) rather than a 2500-byte rebuild. count 0 removes it and ClearCostOverlays drops them all. While
+    // UseRegisteredCostMatrices is on, searches lay the overlay over the room's matrix (the room callback's
+    // one, else the registered one, else none) unless their options set ignoreCreeps. ValidatePaths does not
+    // look at overlays. SetCostOverlay returns 0 or -1 for bad arguments.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_SetCostOverlay(ScreepsWorld* world, const char* roomName, const ScreepsCostOverrideNative* entries, int count);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_ClearCostOverlays(ScreepsWorld* world);
+
+    // Cached paths are packed world tiles: worldX | worldY << 16, where worldX = roomX * 50 + x with roomX
+    // 127 - n for Wn and 128 + n for En (likewise for N/S). PackPath converts points into that form.
+    // ValidatePaths re-prices many paths against loaded terrain and the registered matrices: path ii is
+    // steps[pathOffsets[ii] .. pathOffsets[ii + 1]) in walking order. plainCost/swampCost are 1-254.
+    // Both return 0 or -1 for bad arguments.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_PackPath(
+        const ScreepsPathfinderPoint* points,
+        int count,
+        uint32_t* packed);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_ValidatePaths(
+        ScreepsWorld* world,
+        const uint32_t* steps,
+        const int* pathOffsets,
+        int pathCount,
+        int plainCost,
+        int swampCost,
+        ScreepsPathCheckNative* results);
+
+    // Bulk reads of the loaded terrain for movement checks, on packed world tiles as above. GetTerrain writes
+    // the terrain code per tile (0 plain, 1 wall, 2 swamp, 3 wall on swamp, 255 when the room has no terrain).
+    // GetMoveCosts writes what stepping onto each tile costs a search: a nonzero registered matrix value,
+    // else plainCost/swampCost (1-254), and 255 for walls, blocked tiles and rooms without terrain; overlays
+    // are not applied. GetWalkableMask writes one word per column of the room rectangle [minX, maxX] x
+    // [minY, maxY]: rows[x - minX] has bit (y - minY) set when (x, y) is walkable, through the room's
+    // registered matrix when useRegisteredMatrix is nonzero. All return 0 or -1 for bad arguments;
+    // GetWalkableMask also -2 when the room has no terrain loaded.
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_GetTerrain(ScreepsWorld* world, const uint32_t* tiles, int count, uint8_t* terrain);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_GetMoveCosts(
+        ScreepsWorld* world,
+        const uint32_t* tiles,
+        int count,
+        int plainCost,
+        int swampCost,
+        uint8_t* costs);
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_GetWalkableMask(
+        ScreepsWorld* world,
+        const char* roomName,
+        int minX,
+        int minY,
+        int maxX,
+        int maxY,
+        int useRegisteredMatrix,
+        uint64_t* rows);
+
+    SCREEPS_PATHFINDER_API int ScreepsPathfinder_FindRoute(
+        ScreepsWorld* world,
+        const char* fromRoom,
+        const char* toRoom,
+        const ScreepsRouteOptionsNative* options,
+        ScreepsRouteResultNative* result);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_FreeRoute(ScreepsWorld* world, ScreepsRouteResultNative* result);
+    SCREEPS_PATHFINDER_API void ScreepsPathfinder_SetRoomCallback(ScreepsWorld* world, ScreepsRoomCallback callback, void* userData);
 }
@@ -1,9 +1,15 @@
 // Author: Marcel Laverdet <https://github.com/laverdet>
 #include "pf.h"
+#include "precompute_cache.h"
+#include "room_route.h"
+#include "terrain_pack.h"
+#include <atomic>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <cstring>
+#include <thread>
 
 using namespace screeps;
 
@@ -17,13 +23,15 @@ constexpr bool is_near_border_pos(T val) {
 	return (val + 2) % 50 < 4;
 }
 
+// Expansion events for offline profiling; compiles to nothing unless SCREEPS_PATHFINDER_TRACE is set
+#if SCREEPS_PATHFINDER_TRACE
+#define PF_TRACE(kind, xx, yy, cost) trace.record(trace_event_kind::kind, xx, yy, cost)
+#else
+#define PF_TRACE(kind, xx, yy, cost) ((void)0)
+#endif
+
 uint8_t room_info_t::cost_matrix0[2500] = {0};
 
-decltype(path_finder_t::terrain) path_finder_t::terrain = {{ nullptr }};
-std::vector<std::unique_ptr<uint8_t[]>> path_finder_t::terrain_storage;
-std::vector<std::unique_ptr<uint8_t[]>> path_finder_t::cost_matrix_storage;
-room_callback_fn path_finder_t::native_room_callback = nullptr;
-void* path_finder_t::native_room_callback_context = nullptr;
 
 #if SCREEPS_PATHFINDER_HAS_V8
 namespace {
@@ -38,12 +46,14 @@ namespace {
 		room_index_t room_index = reverse_room_table[map_pos.id];
 		if (room_index == 0) {
 			if (room_table_size >= max_rooms) {
+				room_cap_hit = true;
 				return 0;
 			}
-			if (blocked_rooms.find(map_pos) != blocked_rooms.end()) {
+			if (corridor != nullptr && !corridor->contains(map_pos)) {
+				block_room(map_pos);
 				return 0;
 			}
-			uint8_t* terrain_ptr = terrain[map_pos.id];
+			uint8_t* terrain_ptr = world->terrain[map_pos.id];
 			if (terrain_ptr == nullptr) {
 #if SCREEPS_PATHFINDER_HAS_V8
 				Nan::ThrowError("Could not load terrain data");
@@ -65,7 +75,7 @@ namespace {
 				if (!ret.IsEmpty()) {
 					v8::Local<v8::Value> ret_local = ret.ToLocalChecked();
 					if (ret_local->IsBoolean() && ret_local->IsFalse()) {
-						blocked_rooms.insert(map_pos);
+						block_room(map_pos);
 						return 0;
 					}
 					room_data_handles[room_table_size] = ret_local;
@@ -76,79 +86,135 @@ namespace {
 				}
 			} else
 #endif
-			if (native_room_callback != nullptr) {
+			if (world->native_room_callback != nullptr && use_room_callback) {
 				room_callback_result result{};
-				if (!native_room_callback(map_pos.xx, map_pos.yy, &result, native_room_callback_context)) {
-					blocked_rooms.insert(map_pos);
-					return 0;
-				}
-
-				if (result.block_room) {
-					blocked_rooms.insert(map_pos);
+				arena_t::mark_t mark = search_arena.mark();
+				result.matrix_buffer = search_arena.allocate_array<uint8_t>(2500);
+				result.ignore_creeps = ignore_creeps;
+				if (!world->native_room_callback(map_pos.xx, map_pos.yy, &result, world->native_room_callback_context) || result.block_room) {
+					search_arena.rewind(mark);
+					block_room(map_pos);
 					return 0;
 				}
 
 				if (result.cost_matrix != nullptr && result.cost_matrix_length >= 2500) {
-					auto buffer = std::make_unique<uint8_t[]>(2500);
-					std::memcpy(buffer.get(), result.cost_matrix, 2500);
-					cost_matrix = buffer.get();
-					cost_matrix_storage.push_back(std::move(buffer));
+					cost_matrix = result.matrix_buffer;
+					if (result.cost_matrix != cost_matrix) {
+						std::memcpy(cost_matrix, result.cost_matrix, 2500);
+					}
+					if (!landmark_goals.empty()) {
+						check_landmark_room(map_pos, cost_matrix);
+					}
+				} else {
+					search_arena.rewind(mark);
 				}
 			}
+			if (room_table.size() <= room_table_size) {
+				room_table.resize(room_table_size + 1);
+				halo_grids.resize(room_table_size + 1);
+			}
+			nodes.reserve_room(static_cast<room_index_t>(room_table_size));
 			room_table[room_table_size++] = room_info_t(terrain_ptr, cost_matrix, map_pos);
-			return reverse_room_table[map_pos.id] = room_table_size;
+			PF_TRACE(RoomLoad, map_pos.xx, map_pos.yy, room_table_size - 1);
+			reverse_room_table[map_pos.id] = room_table_size;
+			patch_halos(map_pos);
+			return room_table_size;
+		} else if (room_index == k_blocked_room) {
+			return 0;
 		}
 		return room_index;
 	}
 
+	void path_finder_t::block_room(map_position_t map_pos) {
+		PF_TRACE(RoomLoad, map_pos.xx, map_pos.yy, std::numeric_limits<uint32_t>::max());
+		reverse_room_table[map_pos.id] = k_blocked_room;
+		blocked_rooms.push_back(map_pos);
+		patch_halos(map_pos);
+	}
+
 	// Conversions to/from index & world_position_t
 	pos_index_t path_finder_t::index_from_pos(const world_position_t pos) {
 		room_index_t room_index = room_index_from_pos(pos.map_position());
 		if (room_index == 0) {
 			throw std::runtime_error("Invalid invocation of index_from_pos");
 		}
-		return pos_index_t(room_index - 1) * 50 * 50 + pos.xx % 50 * 50 + pos.yy % 50;
+		const room_info_t& terrain = room_table[room_index - 1];
+		return pos_index_t(room_index - 1) << k_room_index_shift |
+			pos_index_t(pos.xx - terrain.pos.xx * 50) << k_local_x_shift |
+			pos_index_t(pos.yy - terrain.pos.yy * 50);
 	}
 
 	world_position_t path_finder_t::pos_from_index(pos_index_t index) const {
-		room_index_t room_index = index / (50 * 50);
-		const room_info_t& terrain = room_table[room_index];
-		unsigned int coord = index - room_index * 50 * 50;
-		return world_position_t(coord / 50 + terrain.pos.xx * 50, coord % 50 + terrain.pos.yy * 50);
+		const room_info_t& terrain = room_table[index >> k_room_index_shift];
+		return world_position_t(
+			terrain.pos.xx * 50 + (index >> k_local_x_shift & k_local_y_mask),
+			terrain.pos.yy * 50 + (index & k_local_y_mask)
+		);
 	}
 
 	// Push a new node to the heap, or update its cost if it already exists
+	template <class policy_t>
 	void path_finder_t::push_node(pos_index_t parent_index, world_position_t node, cost_t g_cost) {
-		pos_index_t index = index_from_pos(node);
-		if (open_closed.is_closed(index)) {
+		pos_index_t index;
+		if constexpr (policy_t::single_room) {
+			// Only tiles of the loaded room are ever pushed, and it sits in slot 0
+			index = pos_index_t(node.xx - grid_origin.xx) << k_local_x_shift | pos_index_t(node.yy - grid_origin.yy);
+		} else {
+			unsigned xx = uint16_t(node.xx - grid_origin.xx);
+			unsigned yy = uint16_t(node.yy - grid_origin.yy);
+			if (xx < 50 && yy < 50) {
+				index = pos_index_t(current_slot) << k_room_index_shift | pos_index_t(xx) << k_local_x_shift | pos_index_t(yy);
+			} else {
+				index = index_from_pos(node);
+			}
+		}
+		if (nodes.is_closed(index)) {
 			return;
 		}
-		cost_t h_cost = heuristic(node) * heuristic_weight;
+		cost_t h_cost = weight_heuristic<policy_t>(estimate<policy_t>(node, heuristic<policy_t>(node)));
 		cost_t f_cost = h_cost + g_cost;
 
-		if (open_closed.is_open(index)) {
+		if (nodes.is_open(index)) {
 			if (heap.priority(index) > f_cost) {
 				heap.update(index, f_cost);
-				parents[index] = parent_index;
-				// std::cout <<"~ " <<node <<": h(" <<h_cost <<") + " <<"g(" <<g_cost <<") = f(" <<f_cost <<")\n";
+				nodes[index].parent = parent_index;
+				PF_TRACE(Update, node.xx, node.yy, f_cost);
 			}
 		} else {
 			heap.insert(index, f_cost);
-			open_closed.open(index);
-			parents[index] = parent_index;
-			// std::cout <<"+ " <<node <<": h(" <<h_cost <<") + " <<"g(" <<g_cost <<") = f(" <<f_cost <<")\n";
+			nodes.open(index);
+			nodes[index].parent = parent_index;
+			PF_TRACE(Push, node.xx, node.yy, f_cost);
 		}
 	}
 
 	// Return cost of moving to a node
+	template <class policy_t>
 	cost_t path_finder_t::look(const world_position_t pos) {
+		if constexpr (policy_t::single_room) {
+			// 16-bit wrap keeps a neighbour left of or above the room on the obstacle ring
+			unsigned xx = uint16_t(pos.xx + 1 - grid_origin.xx);
+			unsigned yy = uint16_t(pos.yy + 1 - grid_origin.yy);
+			return room_grid[xx * k_grid_size + yy];
+		} else {
+			unsigned xx = uint16_t(pos.xx + 1 - grid_origin.xx);
+			unsigned yy = uint16_t(pos.yy + 1 - grid_origin.yy);
+			if (xx < k_grid_size && yy < k_grid_size) {
+				cost_t cost = current_grid[xx * k_grid_size + yy];
+				if (cost != k_unknown_cost) {
+					return cost;
+				}
+			}
+		}
 		room_index_t room_index = room_index_from_pos(pos.map_position());
 		if (room_index == 0) {
 			return obstacle;
 		}
 		const room_info_t& terrain = room_table[room_index - 1];
-		if (terrain.cost_matrix != nullptr) {
-			int tmp = terrain.cost_matrix[pos.xx % 50][pos.yy % 50];
+		unsigned int xx = pos.xx - terrain.pos.xx * 50;
+		unsigned int yy = pos.yy - terrain.pos.yy * 50;
+		if constexpr (policy_t::cost_matrix) {
+			int tmp = terrain.cost_matrix[xx][yy];
 			if (tmp != 0) {
 				if (tmp == 0xff) {
 					return obstacle;
@@ -157,12 +223,148 @@ namespace {
 				}
 			}
 		}
-		return look_table[terrain.look(pos.xx % 50, pos.yy % 50)];
+		return look_table[terrain.look_terrain(xx, yy)];
+	}
+
+	// Fills room_grid from the room in slot 0 with exactly what the general look() would return,
+	// obstacles included for every tile outside it
+	void path_finder_t::prepare_room_grid() {
+		const room_info_t& room = room_table[0];
+		grid_origin = world_position_t(room.pos.xx * 50, room.pos.yy * 50);
+		fill_room_grid(room, room_grid.data());
+	}
+
+	// Writes the costs of `room` into a k_grid_size square grid, with an obstacle ring around them
+	void path_finder_t::fill_room_grid(const room_info_t& room, cost_t* grid) {
+		if (grid_quads_costs[0] != look_table[0] || grid_quads_costs[1] != look_table[2]) {
+			for (unsigned byte = 0; byte < 256; ++byte) {
+				for (unsigned ii = 0; ii < 4; ++ii) {
+					grid_quads[byte][ii] = look_table[byte >> (ii * 2) & 3];
+				}
+			}
+			grid_quads_costs[0] = look_table[0];
+			grid_quads_costs[1] = look_table[2];
+		}
+
+		std::fill(grid, grid + k_grid_size, obstacle);
+		std::fill(grid + (k_grid_size - 1) * k_grid_size, grid + k_grid_size * k_grid_size, obstacle);
+		bool has_matrix = &room.cost_matrix[0][0] != room_info_t::cost_matrix0;
+		for (unsigned xx = 0; xx < 50; ++xx) {
+			// A column's 50 tiles start at an even tile, so 13 terrain bytes cover them with 0 or 2 spare
+			// in front
+			unsigned first = xx * 50;
+			const uint8_t* bytes = room.terrain + first / 4;
+			cost_t decoded[52];
+			for (unsigned ii = 0; ii < 13; ++ii) {
+				std::memcpy(decoded + ii * 4, grid_quads[bytes[ii]].data(), sizeof(grid_quads[0]));
+			}
+			cost_t* column = grid + (xx + 1) * k_grid_size;
+			column[0] = obstacle;
+			std::memcpy(column + 1, decoded + first % 4, 50 * sizeof(cost_t));
+			column[k_grid_size - 1] = obstacle;
+			if (has_matrix) {
+				const uint8_t* matrix = room.cost_matrix[xx];
+				for (unsigned yy = 0; yy < 50; ++yy) {
+					if (matrix[yy] != 0) {
+						column[yy + 1] = matrix[yy] == 0xff ? obstacle : matrix[yy];
+					}
+				}
+			}
+		}
+	}
+
+	// Makes the grid of the room in `slot` current, building it on the first visit of this search
+	void path_finder_t::enter_room(room_index_t slot) {
+		current_slot = slot;
+		const room_info_t& room = room_table[slot];
+		grid_origin = world_position_t(room.pos.xx * 50, room.pos.yy * 50);
+		cost_t*& grid = halo_grids[slot];
+		if (grid == nullptr) {
+			if (halo_storage.size() <= slot) {
+				halo_storage.resize(slot + 1);
+			}
+			if (halo_storage[slot] == nullptr) {
+				halo_storage[slot] = std::make_unique<cost_t[]>(k_grid_size * k_grid_size);
+			}
+			grid = halo_storage[slot].get();
+			fill_room_grid(room, grid);
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					if (dx != 0 || dy != 0) {
+						// Wraps at the world edge exactly as look() does for the same tiles
+						map_position_t neighbor = world_position_t(
+							grid_origin.xx + (dx < 0 ? -1 : dx * 50),
+							grid_origin.yy + (dy < 0 ? -1 : dy * 50)
+						).map_position();
+						write_halo(grid, dx, dy, neighbor);
+					}
+				}
+			}
+		}
+		current_grid = grid;
+	}
+
+	// Copies the side of the halo that faces direction (dx, dy) from what look() would find there now
+	void path_finder_t::write_halo(cost_t* grid, int dx, int dy, map_position_t neighbor) {
+		room_index_t room_index = reverse_room_table[neighbor.id];
+		const room_info_t* room = nullptr;
+		cost_t fill = k_unknown_cost;
+		if (room_index == k_blocked_room) {
+			fill = obstacle;
+		} else if (room_index == 0 && room_table_size >= max_rooms) {
+			room_cap_hit = true;
+			fill = obstacle;
+		} else if (room_index != 0) {
+			room = &room_table[room_index - 1];
+		}
+		// Halo cell `hh` along a side maps to tile `hh - 1` of this room's edge, and to the opposite
+		// edge of the neighbour
+		unsigned first_x = dx < 0 ? 0 : dx > 0 ? k_grid_size - 1 : 1;
+		unsigned last_x = dx == 0 ? k_grid_size - 2 : first_x;
+		unsigned first_y = dy < 0 ? 0 : dy > 0 ? k_grid_size - 1 : 1;
+		unsigned last_y = dy == 0 ? k_grid_size - 2 : first_y;
+		for (unsigned xx = first_x; xx <= last_x; ++xx) {
+			for (unsigned yy = first_y; yy <= last_y; ++yy) {
+				grid[xx * k_grid_size + yy] = room == nullptr ? fill : tile_cost(*room, (xx + 49) % 50, (yy + 49) % 50);
+			}
+		}
+	}
+
+	// Brings the halos facing `room` up to date after it was loaded or blocked
+	void path_finder_t::patch_halos(map_position_t room) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			for (int dy = -1; dy <= 1; ++dy) {
+				if (dx == 0 && dy == 0) {
+					continue;
+				}
+				room_index_t room_index = reverse_room_table[map_position_t(room.xx - dx, room.yy - dy).id];
+				if (room_index != 0 && room_index != k_blocked_room && halo_grids[room_index - 1] != nullptr) {
+					write_halo(halo_grids[room_index - 1], dx, dy, room);
+				}
+			}
+		}
+	}
+
+	cost_t path_finder_t::tile_cost(const room_info_t& room, unsigned xx, unsigned yy) const {
+		int tmp = room.cost_matrix[xx][yy];
+		if (tmp != 0) {
+			return tmp == 0xff ? obstacle : tmp;
+		}
+		return look_table[room.look_terrain(xx, yy)];
 	}
 
 	// Returns the minimum Chebyshev distance to a goal
+	template <class policy_t>
 	cost_t path_finder_t::heuristic(const world_position_t pos) const {
-		if (flee) {
+		if constexpr (!policy_t::multi_goal) {
+			const goal_t& goal = goals.front();
+			cost_t dist = pos.range_to(goal.pos);
+			if constexpr (policy_t::flee) {
+				return dist < goal.range ? goal.range - dist : 0;
+			} else {
+				return dist > goal.range ? dist - goal.range : 0;
+			}
+		} else if constexpr (policy_t::flee) {
 			cost_t ret = 0;
 			for (size_t ii = 0; ii < goals.size(); ++ii) {
 				cost_t dist = pos.range_to(goals[ii].pos);
@@ -185,8 +387,256 @@ namespace {
 		}
 	}
 
+	// Scales a heuristic value by heuristic_weight, truncating like the floating point product does
+	template <class policy_t>
+	cost_t path_finder_t::weight_heuristic(cost_t h_cost) const {
+		if constexpr (policy_t::fixed_weight) {
+			return static_cast<cost_t>(uint64_t(h_cost) * fixed_heuristic_weight >> k_fixed_weight_shift);
+		} else {
+			return cost_t(h_cost * heuristic_weight);
+		}
+	}
+
+	// Heuristic that stays admissible when portals can shortcut the way to the goals
+	template <class policy_t>
+	cost_t path_finder_t::estimate(world_position_t pos, cost_t h_cost) const {
+		if constexpr (policy_t::landmarks) {
+			if (!landmark_goals.empty()) {
+				h_cost = std::max(h_cost, landmark_heuristic<policy_t>(pos));
+			}
+			if (learned_table != nullptr) {
+				h_cost = std::max(h_cost, learned_bound(pos));
+			}
+		}
+		if constexpr (policy_t::portals) {
+			cost_t best = std::min(h_cost, portal_floor);
+			for (const portal_bound_t& bound : portal_bounds) {
+				best = std::min<cost_t>(best, pos.range_to(bound.source) + bound.remaining);
+			}
+			return best;
+		} else {
+			return h_cost;
+		}
+	}
+
+	// Landmark counterpart of heuristic(): per goal the larger of the Chebyshev and triangle bounds
+	template <class policy_t>
+	cost_t path_finder_t::landmark_heuristic(world_position_t pos) const {
+		if constexpr (policy_t::flee) {
+			return 0;
+		} else if constexpr (!policy_t::multi_goal) {
+			return landmark_bound(landmark_goals.front(), pos);
+		} else {
+			cost_t ret = std::numeric_limits<cost_t>::max();
+			for (size_t ii = 0; ii < goals.size(); ++ii) {
+				cost_t dist = pos.range_to(goals[ii].pos);
+				cost_t chebyshev = dist > goals[ii].range ? dist - goals[ii].range : 0;
+				ret = std::min(ret, std::max(chebyshev, landmark_bound(landmark_goals[ii], pos)));
+			}
+			return ret;
+		}
+	}
+
+	cost_t path_finder_t::landmark_bound(const landmark_goal_t& goal, world_position_t pos) const {
+		if (goal.table == nullptr || pos.map_position().id != goal.room.id) {
+			return 0;
+		}
+		unsigned count = world->landmark_tables.landmark_count();
+		const uint16_t* from = goal.table + ((pos.xx % 50) * 50 + pos.yy % 50) * count;
+		cost_t bound = 0;
+		for (unsigned ii = 0; ii < count; ++ii) {
+			cost_t dist = from[ii];
+			if (dist == landmark_tables_t::k_unreached) {
+				continue;
+			}
+			// An empty range (low > high) never bounds anything
+			if (dist < goal.low[ii] && goal.low[ii] <= goal.high[ii]) {
+				bound = std::max<cost_t>(bound, goal.low[ii] - dist);
+			} else if (dist > goal.high[ii] && goal.low[ii] <= goal.high[ii]) {
+				bound = std::max<cost_t>(bound, dist - goal.high[ii]);
+			}
+		}
+		return bound;
+	}
+
+	cost_t path_finder_t::learned_bound(world_position_t pos) const {
+		uint32_t room = learned_table_t::room_id(pos.xx, pos.yy);
+		if (room != learned_room) {
+			learned_room = room;
+			learned_grid = learned_table->room(static_cast<uint16_t>(room));
+		}
+		return learned_grid == nullptr ? 0 : learned_grid[(pos.xx % 50) * 50 + pos.yy % 50];
+	}
+
+	// Looks up the learned table of a single-goal seek, and decides whether this search feeds it: only
+	// unweighted searches over the full room graph learn bounds that hold for later searches, and the
+	// kernel then expands them without jump points so that they are exact
+	bool path_finder_t::prepare_learned_heuristic(const search_request_native& request) {
+		learned_table.reset();
+		learning = false;
+		learned_samples.clear();
+		learned_room = k_no_learned_room;
+		const search_options_native& options = request.options;
+		learned_heuristics_t& store = world->learned_heuristics;
+		if (!options.learn_heuristic || options.flee || goals.size() != 1 || !store.enabled()) {
+			return false;
+		}
+		learned_key = learned_key_t{
+			goals.front().pos.xx,
+			goals.front().pos.yy,
+			goals.front().range,
+			look_table[0],
+			look_table[2],
+			static_cast<uint32_t>(max_rooms),
+			options.heuristic_version,
+			uint32_t(use_room_callback) | uint32_t(ignore_creeps) << 1,
+			world->cost_matrix_version.load(std::memory_order_relaxed),
+			ignore_creeps ? 0 : world->cost_overlay_version.load(std::memory_order_relaxed)
+		};
+		learning = heuristic_weight == 1.0 && corridor == nullptr;
+		learned_table = store.find(learned_key);
+		return learned_table != nullptr;
+	}
+
+	bool path_finder_t::prepare_landmark_goals() {
+		landmark_goals.clear();
+		unsigned count = world->landmark_tables.landmark_count();
+		bool any = false;
+		for (const goal_t& goal : goals) {
+			landmark_goal_t entry{nullptr, goal.pos.map_position(), {}, {}};
+			int xx = goal.pos.xx % 50;
+			int yy = goal.pos.yy % 50;
+			int range = static_cast<int>(goal.range);
+			const uint16_t* table = world->landmark_tables.room(entry.room.id);
+			if (table != nullptr && goal.range <= k_max_landmark_goal_range && xx >= range && yy >= range && xx + range < 50 && yy + range < 50) {
+				std::fill(entry.low, entry.low + count, landmark_tables_t::k_unreached);
+				std::fill(entry.high, entry.high + count, 0);
+				for (int tx = xx - range; tx <= xx + range; ++tx) {
+					for (int ty = yy - range; ty <= yy + range; ++ty) {
+						// Walls never end a walk; unreached tiles are on no path from the goal room
+						const uint16_t* dist = table + (tx * 50 + ty) * count;
+						for (unsigned ii = 0; ii < count; ++ii) {
+							if (dist[ii] != landmark_tables_t::k_unreached && !(world->terrain[entry.room.id][(tx * 50 + ty) / 4] >> ((tx * 50 + ty) % 4 * 2) & 1)) {
+								entry.low[ii] = std::min(entry.low[ii], dist[ii]);
+								entry.high[ii] = std::max(entry.high[ii], dist[ii]);
+							}
+						}
+					}
+				}
+				entry.table = table;
+				any = true;
+			}
+			landmark_goals.push_back(entry);
+		}
+		if (!any) {
+			landmark_goals.clear();
+		}
+		return any;
+	}
+
+	void path_finder_t::check_landmark_room(map_position_t room, const uint8_t* cost_matrix) {
+		const uint8_t* room_terrain = world->terrain[room.id];
+		for (landmark_goal_t& goal : landmark_goals) {
+			if (goal.table == nullptr || goal.room.id != room.id) {
+				continue;
+			}
+			// Terrain-only distances are no bound once the matrix opens a wall tile
+			for (unsigned tile = 0; tile < 2500; ++tile) {
+				if (cost_matrix[tile] != 0 && cost_matrix[tile] != 0xff && (room_terrain[tile / 4] >> (tile % 4 * 2) & 1)) {
+					goal.table = nullptr;
+					break;
+				}
+			}
+		}
+	}
+
+	// A portal's remaining cost is at least the heuristic at its destination, or, when it chains into
+	// other portals, the range to the next portal plus the best heuristic at any destination
+	template <class policy_t>
+	void path_finder_t::prepare_portal_bounds() {
+		cost_t best_exit = std::numeric_limits<cost_t>::max();
+		const std::vector<portal_t>& portals = world->portals;
+		const std::vector<cost_t>& portal_reach = world->portal_reach;
+		for (const portal_t& portal : portals) {
+			best_exit = std::min(best_exit, heuristic<policy_t>(portal.destination));
+		}
+		portal_bounds.clear();
+		portal_floor = std::numeric_limits<cost_t>::max();
+		for (size_t ii = 0; ii < portals.size(); ++ii) {
+			cost_t direct = heuristic<policy_t>(portals[ii].destination);
+			cost_t chained = portal_reach[ii] == std::numeric_limits<cost_t>::max() ? direct : portal_reach[ii] + best_exit;
+			portal_bounds.push_back(portal_bound_t{portals[ii].source, std::min(direct, chained)});
+		}
+		auto by_remaining = [](const portal_bound_t& left, const portal_bound_t& right) {
+			return left.remaining < right.remaining;
+		};
+		if (portal_bounds.size() > k_portal_bounds) {
+			std::nth_element(portal_bounds.begin(), portal_bounds.begin() + k_portal_bounds, portal_bounds.end(), by_remaining);
+			portal_floor = std::min_element(portal_bounds.begin() + k_portal_bounds, portal_bounds.end(), by_remaining)->remaining;
+			portal_bounds.resize(k_portal_bounds);
+		}
+	}
+
+	// Expands a portal tile: its only move is the free hop to the destination
+	template <class policy_t>
+	bool path_finder_t::enter_portal(pos_index_t index, world_position_t pos, cost_t g_cost) {
+		if constexpr (policy_t::portals) {
+			// Only stepping onto a portal moves a creep: the origin and a tile just arrived at through
+			// the paired portal are left on foot
+			const world_position_t* destination = g_cost == 0 ? nullptr : world->portal_destination(pos);
+			if (destination == nullptr || world->is_portal_hop(pos_from_index(nodes[index].parent), pos)) {
+				return false;
+			}
+			if (look<policy_t>(*destination) != obstacle) {
+				push_node<policy_t>(index, *destination, g_cost);
+			}
+			return true;
+		} else {
+			return false;
+		}
+	}
+
+	bool world_t::is_portal_hop(world_position_t from, world_position_t to) const {
+		if (portals.empty()) {
+			return false;
+		}
+		const world_position_t* destination = portal_destination(from);
+		return destination != nullptr && destination->id == to.id;
+	}
+
+	// Finds a fixed-point multiplier that truncates to exactly cost_t(h * weight) for every h up to
+	// max_h. Verified results are cached, so the common repeated weights only pay for the check once.
+	bool path_finder_t::prepare_fixed_weight(double weight, cost_t max_h) {
+		if (weight == fixed_weight_source && max_h <= fixed_weight_checked_h) {
+			return fixed_heuristic_weight != 0;
+		}
+		fixed_weight_source = weight;
+		fixed_weight_checked_h = max_h;
+		fixed_heuristic_weight = 0;
+		if (!(weight >= 0) || weight > 1 << 10 || max_h > k_max_fixed_weight_h) {
+			return false;
+		}
+		double scaled = weight * double(1 << k_fixed_weight_shift);
+		uint64_t candidates[2] = { static_cast<uint64_t>(std::ceil(scaled)), static_cast<uint64_t>(std::floor(scaled)) };
+		for (uint64_t candidate : candidates) {
+			bool exact = true;
+			for (cost_t hh = 0; hh <= max_h && exact; ++hh) {
+				exact = static_cast<cost_t>(uint64_t(hh) * candidate >> k_fixed_weight_shift) == cost_t(hh * weight);
+			}
+			if (exact) {
+				fixed_heuristic_weight = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
 	// Run an iteration of basic A*
+	template <class policy_t>
 	void path_finder_t::astar(pos_index_t index, world_position_t pos, cost_t g_cost) {
+		if (enter_portal<policy_t>(index, pos, g_cost)) {
+			return;
+		}
 		for (int dir = world_position_t::TOP; dir <= world_position_t::TOP_LEFT; ++dir) {
 			world_position_t neighbor = pos.position_in_direction(static_cast<world_position_t::direction_t>(dir));
 
@@ -218,26 +668,27 @@ namespace {
 			}
 
 			// Calculate cost of this move
-			cost_t n_cost = look(neighbor);
+			cost_t n_cost = look<policy_t>(neighbor);
 			if (n_cost == obstacle) {
 				// std::cout <<"# " <<neighbor <<"\n";
 				continue;
 			}
-			push_node(index, neighbor, g_cost + n_cost);
+			push_node<policy_t>(index, neighbor, g_cost + n_cost);
 		}
 	}
 
 	// JPS dragons
+	template <class policy_t>
 	world_position_t path_finder_t::jump_x(cost_t cost, world_position_t pos, int dx) {
-		cost_t prev_cost_u = look(world_position_t(pos.xx, pos.yy - 1));
-		cost_t prev_cost_d = look(world_position_t(pos.xx, pos.yy + 1));
+		cost_t prev_cost_u = look<policy_t>(world_position_t(pos.xx, pos.yy - 1));
+		cost_t prev_cost_d = look<policy_t>(world_position_t(pos.xx, pos.yy + 1));
 		while (true) {
-			if (heuristic(pos) == 0 || is_near_border_pos(pos.xx)) {
+			if (heuristic<policy_t>(pos) == 0 || is_near_border_pos(pos.xx) || is_jump_stop<policy_t>(pos)) {
 				break;
 			}
 
-			cost_t cost_u = look(world_position_t(pos.xx + dx, pos.yy - 1));
-			cost_t cost_d = look(world_position_t(pos.xx + dx, pos.yy + 1));
+			cost_t cost_u = look<policy_t>(world_position_t(pos.xx + dx, pos.yy - 1));
+			cost_t cost_d = look<policy_t>(world_position_t(pos.xx + dx, pos.yy + 1));
 			if (
 				(cost_u != obstacle && prev_cost_u != cost) ||
 				(cost_d != obstacle && prev_cost_d != cost)
@@ -248,7 +699,7 @@ namespace {
 			prev_cost_d = cost_d;
 			pos.xx += dx;
 
-			cost_t jump_cost = look(pos);
+			cost_t jump_cost = look<policy_t>(pos);
 			if (jump_cost == obstacle) {
 				pos = world_position_t::null();
 				break;
@@ -259,16 +710,17 @@ namespace {
 		return pos;
 	}
 
+	template <class policy_t>
 	world_position_t path_finder_t::jump_y(cost_t cost, world_position_t pos, int dy) {
-		cost_t prev_cost_l = look(world_position_t(pos.xx - 1, pos.yy));
-		cost_t prev_cost_r = look(world_position_t(pos.xx + 1, pos.yy));
+		cost_t prev_cost_l = look<policy_t>(world_position_t(pos.xx - 1, pos.yy));
+		cost_t prev_cost_r = look<policy_t>(world_position_t(pos.xx + 1, pos.yy));
 		while (true) {
-			if (heuristic(pos) == 0 || is_near_border_pos(pos.yy)) {
+			if (heuristic<policy_t>(pos) == 0 || is_near_border_pos(pos.yy) || is_jump_stop<policy_t>(pos)) {
 				break;
 			}
 
-			cost_t cost_l = look(world_position_t(pos.xx - 1, pos.yy + dy));
-			cost_t cost_r = look(world_position_t(pos.xx + 1, pos.yy + dy));
+			cost_t cost_l = look<policy_t>(world_position_t(pos.xx - 1, pos.yy + dy));
+			cost_t cost_r = look<policy_t>(world_position_t(pos.xx + 1, pos.yy + dy));
 			if (
 				(cost_l != obstacle && prev_cost_l != cost) ||
 				(cost_r != obstacle && prev_cost_r != cost)
@@ -279,7 +731,7 @@ namespace {
 			prev_cost_r = cost_r;
 			pos.yy += dy;
 
-			cost_t jump_cost = look(pos);
+			cost_t jump_cost = look<policy_t>(pos);
 			if (jump_cost == obstacle) {
 				pos = world_position_t::null();
 				break;
@@ -290,25 +742,26 @@ namespace {
 		return pos;
 	}
 
+	template <class policy_t>
 	world_position_t path_finder_t::jump_xy(cost_t cost, world_position_t pos, int dx, int dy) {
-		cost_t prev_cost_x = look(world_position_t(pos.xx - dx, pos.yy));
-		cost_t prev_cost_y = look(world_position_t(pos.xx, pos.yy - dy));
+		cost_t prev_cost_x = look<policy_t>(world_position_t(pos.xx - dx, pos.yy));
+		cost_t prev_cost_y = look<policy_t>(world_position_t(pos.xx, pos.yy - dy));
 		while (true) {
-			if (heuristic(pos) == 0 || is_near_border_pos(pos.xx) || is_near_border_pos(pos.yy)) {
+			if (heuristic<policy_t>(pos) == 0 || is_near_border_pos(pos.xx) || is_near_border_pos(pos.yy) || is_jump_stop<policy_t>(pos)) {
 				break;
 			}
 
 			if (
-				(look(world_position_t(pos.xx - dx, pos.yy + dy)) != obstacle && prev_cost_x != cost) ||
-				(look(world_position_t(pos.xx + dx, pos.yy - dy)) != obstacle && prev_cost_y != cost)
+				(look<policy_t>(world_position_t(pos.xx - dx, pos.yy + dy)) != obstacle && prev_cost_x != cost) ||
+				(look<policy_t>(world_position_t(pos.xx + dx, pos.yy - dy)) != obstacle && prev_cost_y != cost)
 			) {
 				break;
 			}
-			prev_cost_x = look(world_position_t(pos.xx, pos.yy + dy));
-			prev_cost_y = look(world_position_t(pos.xx + dx, pos.yy));
+			prev_cost_x = look<policy_t>(world_position_t(pos.xx, pos.yy + dy));
+			prev_cost_y = look<policy_t>(world_position_t(pos.xx + dx, pos.yy));
 			if (
-				(prev_cost_y != obstacle && !jump_x(cost, world_position_t(pos.xx + dx, pos.yy), dx).is_null()) ||
-				(prev_cost_x != obstacle && !jump_y(cost, world_position_t(pos.xx, pos.yy + dy), dy).is_null())
+				(prev_cost_y != obstacle && !jump_x<policy_t>(cost, world_position_t(pos.xx + dx, pos.yy), dx).is_null()) ||
+				(prev_cost_x != obstacle && !jump_y<policy_t>(cost, world_position_t(pos.xx, pos.yy + dy), dy).is_null())
 			) {
 				break;
 			}
@@ -316,7 +769,7 @@ namespace {
 			pos.xx += dx;
 			pos.yy += dy;
 
-			cost_t jump_cost = look(pos);
+			cost_t jump_cost = look<policy_t>(pos);
 			if (jump_cost == obstacle) {
 				pos = world_position_t::null();
 				break;
@@ -327,20 +780,31 @@ namespace {
 		return pos;
 	}
 
+	template <class policy_t>
 	world_position_t path_finder_t::jump(cost_t cost, world_position_t pos, int dx, int dy) {
 		if (dx != 0) {
 			if (dy != 0) {
-				return jump_xy(cost, pos, dx, dy);
+				return jump_xy<policy_t>(cost, pos, dx, dy);
 			} else {
-				return jump_x(cost, pos, dx);
+				return jump_x<policy_t>(cost, pos, dx);
 			}
 		} else {
-			return jump_y(cost, pos, dy);
+			return jump_y<policy_t>(cost, pos, dy);
 		}
 	}
 
+	template <class policy_t>
 	void path_finder_t::jps(pos_index_t index, world_position_t pos, cost_t g_cost) {
-		world_position_t parent = pos_from_index(parents[index]);
+		world_position_t parent = pos_from_index(nodes[index].parent);
+		if constexpr (policy_t::portals) {
+			// Arriving through a portal has no direction to prune by, so every neighbour is open
+			if (enter_portal<policy_t>(index, pos, g_cost)) {
+				return;
+			} else if (world->is_portal_hop(parent, pos)) {
+				astar<policy_t>(index, pos, g_cost);
+				return;
+			}
+		}
 		int dx = pos.xx > parent.xx ? 1 : (pos.xx < parent.xx ? -1 : 0);
 		int dy = pos.yy > parent.yy ? 1 : (pos.yy < parent.yy ? -1 : 0);
 
@@ -392,11 +856,11 @@ namespace {
 		// Add special nodes from the above blocks to the heap
 		if (neighbor_count != 0) {
 			for (int ii = 0; ii < neighbor_count; ++ii) {
-				cost_t n_cost = look(neighbors[ii]);
+				cost_t n_cost = look<policy_t>(neighbors[ii]);
 				if (n_cost == obstacle) {
 					continue;
 				}
-				push_node(index, neighbors[ii], g_cost + n_cost);
+				push_node<policy_t>(index, neighbors[ii], g_cost + n_cost);
 			}
 			return;
 		}
@@ -418,26 +882,26 @@ namespace {
 		}
 
 		// Now execute the logic that is shared between diagonal and straight jumps
-		cost_t cost = look(pos);
+		cost_t cost = look<policy_t>(pos);
 		if (dx != 0) {
 			world_position_t neighbor = world_position_t(pos.xx + dx, pos.yy);
-			cost_t n_cost = look(neighbor);
+			cost_t n_cost = look<policy_t>(neighbor);
 			if (n_cost != obstacle) {
 				if (border_dy == 0) {
-					jump_neighbor(pos, index, neighbor, g_cost, cost, n_cost);
+					jump_neighbor<policy_t>(pos, index, neighbor, g_cost, cost, n_cost);
 				} else {
-					push_node(index, neighbor, g_cost + n_cost);
+					push_node<policy_t>(index, neighbor, g_cost + n_cost);
 				}
 			}
 		}
 		if (dy != 0) {
 			world_position_t neighbor = world_position_t(pos.xx, pos.yy + dy);
-			cost_t n_cost = look(neighbor);
+			cost_t n_cost = look<policy_t>(neighbor);
 			if (n_cost != obstacle) {
 				if (border_dx == 0) {
-					jump_neighbor(pos, index, neighbor, g_cost, cost, n_cost);
+					jump_neighbor<policy_t>(pos, index, neighbor, g_cost, cost, n_cost);
 				} else {
-					push_node(index, neighbor, g_cost + n_cost);
+					push_node<policy_t>(index, neighbor, g_cost + n_cost);
 				}
 			}
 		}
@@ -446,34 +910,35 @@ namespace {
 		if (dx != 0) {
 			if (dy != 0) { // Jumping diagonally
 				world_position_t neighbor = world_position_t(pos.xx + dx, pos.yy + dy);
-				cost_t n_cost = look(neighbor);
+				cost_t n_cost = look<policy_t>(neighbor);
 				if (n_cost != obstacle) {
-					jump_neighbor(pos, index, neighbor, g_cost, cost, n_cost);
+					jump_neighbor<policy_t>(pos, index, neighbor, g_cost, cost, n_cost);
 				}
-				if (look(world_position_t(pos.xx - dx, pos.yy)) != cost) {
-					jump_neighbor(pos, index, world_position_t(pos.xx - dx, pos.yy + dy), g_cost, cost, look(world_position_t(pos.xx - dx, pos.yy + dy)));
+				if (look<policy_t>(world_position_t(pos.xx - dx, pos.yy)) != cost) {
+					jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx - dx, pos.yy + dy), g_cost, cost, look<policy_t>(world_position_t(pos.xx - dx, pos.yy + dy)));
 				}
-				if (look(world_position_t(pos.xx, pos.yy - dy)) != cost) {
-					jump_neighbor(pos, index, world_position_t(pos.xx + dx, pos.yy - dy), g_cost, cost, look(world_position_t(pos.xx + dx, pos.yy - dy)));
+				if (look<policy_t>(world_position_t(pos.xx, pos.yy - dy)) != cost) {
+					jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx + dx, pos.yy - dy), g_cost, cost, look<policy_t>(world_position_t(pos.xx + dx, pos.yy - dy)));
 				}
 			} else { // Jumping left / right
-				if (border_dy == 1 || look(world_position_t(pos.xx, pos.yy + 1)) != cost) {
-					jump_neighbor(pos, index, world_position_t(pos.xx + dx, pos.yy + 1), g_cost, cost, look(world_position_t(pos.xx + dx, pos.yy + 1)));
+				if (border_dy == 1 || look<policy_t>(world_position_t(pos.xx, pos.yy + 1)) != cost) {
+					jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx + dx, pos.yy + 1), g_cost, cost, look<policy_t>(world_position_t(pos.xx + dx, pos.yy + 1)));
 				}
-				if (border_dy == -1 || look(world_position_t(pos.xx, pos.yy - 1)) != cost) {
-					jump_neighbor(pos, index, world_position_t(pos.xx + dx, pos.yy - 1), g_cost, cost, look(world_position_t(pos.xx + dx, pos.yy - 1)));
+				if (border_dy == -1 || look<policy_t>(world_position_t(pos.xx, pos.yy - 1)) != cost) {
+					jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx + dx, pos.yy - 1), g_cost, cost, look<policy_t>(world_position_t(pos.xx + dx, pos.yy - 1)));
 				}
 			}
 		} else { // Jumping up / down
-			if (border_dx == 1 || look(world_position_t(pos.xx + 1, pos.yy)) != cost) {
-				jump_neighbor(pos, index, world_position_t(pos.xx + 1, pos.yy + dy), g_cost, cost, look(world_position_t(pos.xx + 1, pos.yy + dy)));
+			if (border_dx == 1 || look<policy_t>(world_position_t(pos.xx + 1, pos.yy)) != cost) {
+				jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx + 1, pos.yy + dy), g_cost, cost, look<policy_t>(world_position_t(pos.xx + 1, pos.yy + dy)));
 			}
-			if (border_dx == -1 || look(world_position_t(pos.xx - 1, pos.yy)) != cost) {
-				jump_neighbor(pos, index, world_position_t(pos.xx - 1, pos.yy + dy), g_cost, cost, look(world_position_t(pos.xx - 1, pos.yy + dy)));
+			if (border_dx == -1 || look<policy_t>(world_position_t(pos.xx - 1, pos.yy)) != cost) {
+				jump_neighbor<policy_t>(pos, index, world_position_t(pos.xx - 1, pos.yy + dy), g_cost, cost, look<policy_t>(world_position_t(pos.xx - 1, pos.yy + dy)));
 			}
 		}
 	}
 
+	template <class policy_t>
 	void path_finder_t::jump_neighbor(world_position_t pos, pos_index_t index, world_position_t neighbor, cost_t g_cost, cost_t cost, cost_t n_cost) {
 		if (n_cost != cost || is_border_pos(neighbor.xx) || is_border_pos(neighbor.yy)) {
 			if (n_cost == obstacle) {
@@ -481,14 +946,18 @@ namespace {
 			}
 			g_cost += n_cost;
 		} else {
-			neighbor = jump(n_cost, neighbor, neighbor.xx - pos.xx, neighbor.yy - pos.yy);
+			PF_TRACE(JumpStart, neighbor.xx, neighbor.yy, n_cost);
+			[[maybe_unused]] world_position_t start = neighbor;
+			neighbor = jump<policy_t>(n_cost, neighbor, neighbor.xx - pos.xx, neighbor.yy - pos.yy);
 			if (neighbor.is_null()) {
+				PF_TRACE(JumpEnd, start.xx, start.yy, std::numeric_limits<uint32_t>::max());
 				return;
 			}
-			g_cost += n_cost * (pos.range_to(neighbor) - 1) + look(neighbor);
+			g_cost += n_cost * (pos.range_to(neighbor) - 1) + look<policy_t>(neighbor);
+			PF_TRACE(JumpEnd, neighbor.xx, neighbor.yy, g_cost);
 		}
 
-		push_node(index, neighbor, g_cost);
+		push_node<policy_t>(index, neighbor, g_cost);
 	}
 
 	search_status path_finder_t::search_native(
@@ -499,13 +968,21 @@ namespace {
 
 		for (size_t ii = 0; ii < room_table_size; ++ii) {
 			reverse_room_table[room_table[ii].pos.id] = 0;
+			halo_grids[ii] = nullptr;
 		}
 		room_table_size = 0;
+		room_cap_hit = false;
+		for (map_position_t room : blocked_rooms) {
+			reverse_room_table[room.id] = 0;
+		}
 		blocked_rooms.clear();
 		goals.clear();
-		open_closed.clear();
+		nodes.clear();
 		heap.clear();
-		cost_matrix_storage.clear();
+		search_arena.reset();
+#if SCREEPS_PATHFINDER_TRACE
+		trace.clear();
+#endif
 
 		result.path.clear();
 		result.operations = 0;
@@ -522,14 +999,86 @@ namespace {
 		look_table[2] = request.options.swamp_cost;
 		this->max_rooms = request.options.max_rooms;
 		this->heuristic_weight = request.options.heuristic_weight;
+		this->use_room_callback = request.options.use_room_callback;
+		this->ignore_creeps = request.options.ignore_creeps;
+		this->corridor = request.corridor;
+
+		// Pick the kernel for this request's shape once, instead of re-testing options on every node
+		bool flee = request.options.flee;
+		cost_t max_h = k_world_size;
+		if (flee) {
+			max_h = 0;
+			for (const goal_t& goal : goals) {
+				max_h = std::max(max_h, goal.range);
+			}
+		}
+		bool has_room_callback = use_room_callback && world->native_room_callback != nullptr;
+#if SCREEPS_PATHFINDER_HAS_V8
+		has_room_callback = has_room_callback || room_callback != nullptr;
+#endif
+		landmark_goals.clear();
+		bool learned = prepare_learned_heuristic(request);
+		// Landmark bounds stop at the goal room's edge, which a search feeding learned bounds cannot afford
+		bool landmarks = !flee && !learning && world->landmark_tables.landmark_count() != 0 && prepare_landmark_goals();
+		// The room grid folds in the cost matrix, so single-room kernels never need the matrix flag
+		bool single_room = specialize_kernels && use_room_grid && max_rooms == 1 && world->portals.empty();
+		const bool shape[7] = {
+			flee,
+			!specialize_kernels || goals.size() != 1,
+			specialize_kernels && prepare_fixed_weight(heuristic_weight, max_h),
+			!single_room && (!specialize_kernels || has_room_callback),
+			!world->portals.empty(),
+			landmarks || learned,
+			single_room
+		};
+		search_status status = dispatch_search<>(shape, request, result, should_abort);
+		// Tile by tile, a feeding search may spend max_rooms on rooms jump point search would never open,
+		// and the rooms it got depend on where it started. Such a search feeds nothing, and is made
+		// again the usual way.
+		if (learning && room_cap_hit && status == search_status::Success) {
+			search_request_native retry = request;
+			retry.options.learn_heuristic = false;
+			return search_native(retry, result, should_abort);
+		}
+		return status;
+	}
+
+	template <bool... decided>
+	search_status path_finder_t::dispatch_search(
+		const bool (&shape)[7],
+		const search_request_native& request,
+		search_result_native& result,
+		abort_callback_fn should_abort
+	) {
+		constexpr bool flags[] = {decided..., false};
+		if constexpr (sizeof...(decided) == 7) {
+			return search_kernel<search_policy_t<decided...>>(request, result, should_abort);
+		} else if constexpr (sizeof...(decided) == 5 && flags[0]) {
+			// Landmarks never apply to flee searches; skip instantiating those kernels
+			return dispatch_search<decided..., false>(shape, request, result, should_abort);
+		} else if constexpr (sizeof...(decided) == 6 && (flags[3] || flags[4])) {
+			// Nor does the room grid go with a matrix flag or portals
+			return dispatch_search<decided..., false>(shape, request, result, should_abort);
+		} else if (shape[sizeof...(decided)]) {
+			return dispatch_search<decided..., true>(shape, request, result, should_abort);
+		} else {
+			return dispatch_search<decided..., false>(shape, request, result, should_abort);
+		}
+	}
+
+	template <class policy_t>
+	search_status path_finder_t::search_kernel(
+		const search_request_native& request,
+		search_result_native& result,
+		abort_callback_fn should_abort
+	) {
 		uint32_t ops_remaining = request.options.max_ops;
-		this->flee = request.options.flee;
 		world_position_t origin = request.origin;
 		cost_t min_node_h_cost = std::numeric_limits<cost_t>::max();
 		cost_t min_node_g_cost = std::numeric_limits<cost_t>::max();
 		pos_index_t min_node = 0;
 
-		if (heuristic(origin) == 0) {
+		if (heuristic<policy_t>(origin) == 0) {
 			result.status = search_status::SamePosition;
 			return result.status;
 		}
@@ -542,16 +1091,33 @@ namespace {
 				return result.status;
 			}
 
+			if constexpr (policy_t::portals) {
+				prepare_portal_bounds<policy_t>();
+			}
+			if constexpr (policy_t::single_room) {
+				prepare_room_grid();
+			}
 			min_node = index_from_pos(origin);
-			astar(min_node, origin, 0);
+			if (learning) {
+				learned_samples.push_back(learned_sample_t{origin.xx, origin.yy, 0});
+			}
+			if constexpr (!policy_t::single_room) {
+				enter_room(min_node >> k_room_index_shift);
+			}
+			astar<policy_t>(min_node, origin, 0);
 
 			while (!heap.empty() && ops_remaining > 0) {
 				std::pair<pos_index_t, cost_t> current = heap.pop();
-				open_closed.close(current.first);
+				nodes.close(current.first);
 
 				world_position_t pos = pos_from_index(current.first);
-				cost_t h_cost = heuristic(pos);
-				cost_t g_cost = current.second - cost_t(h_cost * heuristic_weight);
+				PF_TRACE(Close, pos.xx, pos.yy, current.second);
+				cost_t h_cost = heuristic<policy_t>(pos);
+				cost_t estimate_cost = estimate<policy_t>(pos, h_cost);
+				cost_t g_cost = current.second - weight_heuristic<policy_t>(estimate_cost);
+				if (learning) {
+					learned_samples.push_back(learned_sample_t{pos.xx, pos.yy, g_cost});
+				}
 
 				if (h_cost == 0) {
 					min_node = current.first;
@@ -563,11 +1129,20 @@ namespace {
 					min_node_h_cost = h_cost;
 					min_node_g_cost = g_cost;
 				}
-				if (g_cost + h_cost > request.options.max_cost) {
+				if (g_cost + estimate_cost > request.options.max_cost) {
 					break;
 				}
 
-				jps(current.first, pos, g_cost);
+				if constexpr (!policy_t::single_room) {
+					if ((current.first >> k_room_index_shift) != current_slot) {
+						enter_room(current.first >> k_room_index_shift);
+					}
+				}
+				if (learning) {
+					astar<policy_t>(current.first, pos, g_cost);
+				} else {
+					jps<policy_t>(current.first, pos, g_cost);
+				}
 				--ops_remaining;
 
 				if (should_abort != nullptr && should_abort()) {
@@ -582,28 +1157,54 @@ namespace {
 			return result.status;
 		}
 
-		std::vector<world_position_t> reconstructed;
+		// Reconstruct straight into the caller's path so its capacity carries over between searches
+		std::vector<world_position_t>& reconstructed = result.path;
 		pos_index_t index = min_node;
 		world_position_t pos = pos_from_index(index);
-		while (pos != origin) {
-			reconstructed.push_back(pos);
-			index = parents[index];
-			world_position_t next = pos_from_index(index);
-			if (next.range_to(pos) > 1) {
-				world_position_t::direction_t dir = pos.direction_to(next);
-				do {
-					pos = pos.position_in_direction(dir);
+		if (request.options.waypoints_only) {
+			// Jump points that continue the previous segment in the same direction add nothing to the
+			// expansion, so the last waypoint slides forward instead
+			while (pos != origin) {
+				size_t size = reconstructed.size();
+				if (size >= 2 && reconstructed[size - 2].direction_to(reconstructed[size - 1]) == reconstructed[size - 1].direction_to(pos) &&
+					!world->is_portal_hop(pos, reconstructed[size - 1]) && !world->is_portal_hop(reconstructed[size - 1], reconstructed[size - 2])) {
+					reconstructed.back() = pos;
+				} else {
 					reconstructed.push_back(pos);
-				} while (pos.range_to(next) > 1);
+				}
+				index = nodes[index].parent;
+				pos = pos_from_index(index);
+			}
+			size_t size = reconstructed.size();
+			if (size >= 2 && reconstructed[size - 2].direction_to(reconstructed[size - 1]) == reconstructed[size - 1].direction_to(origin) &&
+				!world->is_portal_hop(origin, reconstructed[size - 1]) && !world->is_portal_hop(reconstructed[size - 1], reconstructed[size - 2])) {
+				reconstructed.pop_back();
+			}
+		} else {
+			while (pos != origin) {
+				reconstructed.push_back(pos);
+				index = nodes[index].parent;
+				world_position_t next = pos_from_index(index);
+				if (next.range_to(pos) > 1 && !world->is_portal_hop(next, pos)) {
+					world_position_t::direction_t dir = pos.direction_to(next);
+					do {
+						pos = pos.position_in_direction(dir);
+						reconstructed.push_back(pos);
+					} while (pos.range_to(next) > 1);
+				}
+				pos = next;
 			}
-			pos = next;
 		}
 
-		result.path = std::move(reconstructed);
 		result.operations = request.options.max_ops - ops_remaining;
 		result.cost = min_node_g_cost;
 		result.incomplete = (min_node_h_cost != 0);
 		result.status = search_status::Success;
+		// A search that filled max_rooms found its costs on a room graph that depends on where it
+		// started; they are no bounds for searches from elsewhere
+		if (learning && !result.incomplete && !room_cap_hit && room_table_size < max_rooms) {
+			world->learned_heuristics.learn(learned_key, min_node_g_cost, learned_samples.data(), learned_samples.size());
+		}
 		_is_in_use = false;
 		return result.status;
 	}
@@ -686,24 +1287,130 @@ namespace {
 	}
 #endif
 
-	void path_finder_t::reset_terrain_storage() {
+	path_expander_t::path_expander_t(const world_t& world, world_position_t origin, const world_position_t* waypoints, size_t count) :
+		world(&world), origin(origin), waypoints(waypoints), count(count) {
+		start_segment(0);
+	}
+
+	void path_expander_t::start_segment(size_t index) {
+		segment = index;
+		if (segment < count) {
+			pos = waypoints[segment];
+			dir = pos.direction_to(segment_end(segment));
+		}
+	}
+
+	bool path_expander_t::hop_segment() const {
+		return world->is_portal_hop(segment_end(segment), waypoints[segment]);
+	}
+
+	size_t path_expander_t::tile_count(const world_t& world, world_position_t origin, const world_position_t* waypoints, size_t count) {
+		size_t tiles = 0;
+		for (size_t ii = 0; ii < count; ++ii) {
+			world_position_t end = ii + 1 < count ? waypoints[ii + 1] : origin;
+			tiles += world.is_portal_hop(end, waypoints[ii]) ? 1 : waypoints[ii].range_to(end);
+		}
+		return tiles;
+	}
+
+	void path_expander_t::seek(size_t index) {
+		start_segment(0);
+		while (segment < count) {
+			size_t length = hop_segment() ? 1 : pos.range_to(segment_end(segment));
+			if (index < length) {
+				for (; index > 0; --index) {
+					pos = pos.position_in_direction(dir);
+				}
+				return;
+			}
+			index -= length;
+			start_segment(segment + 1);
+		}
+	}
+
+	size_t path_expander_t::next(world_position_t* out, size_t max_count) {
+		size_t written = 0;
+		while (written < max_count && segment < count) {
+			out[written++] = pos;
+			if (!hop_segment() && pos.range_to(segment_end(segment)) > 1) {
+				pos = pos.position_in_direction(dir);
+			} else {
+				start_segment(segment + 1);
+			}
+		}
+		return written;
+	}
+
+	void path_finder_t::release_search_storage() {
+		if (_is_in_use) {
+			return;
+		}
+		for (size_t ii = 0; ii < room_table_size; ++ii) {
+			reverse_room_table[room_table[ii].pos.id] = 0;
+		}
+		room_table_size = 0;
+		room_table.clear();
+		room_table.shrink_to_fit();
+		halo_grids.clear();
+		halo_grids.shrink_to_fit();
+		halo_storage.clear();
+		halo_storage.shrink_to_fit();
+		learned_table.reset();
+		learned_samples.clear();
+		learned_samples.shrink_to_fit();
+		for (map_position_t room : blocked_rooms) {
+			reverse_room_table[room.id] = 0;
+		}
+		blocked_rooms.clear();
+		blocked_rooms.shrink_to_fit();
+		heap.release();
+		nodes.release_pages();
+		search_arena.release();
+	}
+
+	world_t::world_t() = default;
+
+	world_t::~world_t() = default;
+
+	world_t& world_t::default_world() {
+		static world_t world;
+		return world;
+	}
+
+	void world_t::reset_terrain_storage() {
+		landmark_tables.clear();
+		learned_heuristics.clear();
 		std::fill(terrain.begin(), terrain.end(), nullptr);
+		std::fill(exits.begin(), exits.end(), 0);
 		terrain_storage.clear();
 	}
 
-	void path_finder_t::ingest_terrain_chunk(map_position_t pos, const uint8_t* source, size_t length) {
+	void world_t::ingest_terrain_chunk(map_position_t pos, const uint8_t* source, size_t length) {
 		if (source == nullptr || length < terrain_bytes_per_room)
 			return;
 
 		auto buffer = std::make_unique<uint8_t[]>(terrain_bytes_per_room);
 		std::memcpy(buffer.get(), source, terrain_bytes_per_room);
 		terrain[pos.id] = buffer.get();
+		exits[pos.id] = terrain_exits(pos, buffer.get());
 		terrain_storage.push_back(std::move(buffer));
 	}
 
+	uint8_t world_t::terrain_exits(map_position_t pos, uint8_t* bits) {
+		room_info_t room(bits, nullptr, pos);
+		uint8_t room_exits = 0;
+		for (unsigned int ii = 0; ii < 50; ++ii) {
+			room_exits |= (room.look_terrain(ii, 0) & 1) ? 0 : EXIT_TOP;
+			room_exits |= (room.look_terrain(49, ii) & 1) ? 0 : EXIT_RIGHT;
+			room_exits |= (room.look_terrain(ii, 49) & 1) ? 0 : EXIT_BOTTOM;
+			room_exits |= (room.look_terrain(0, ii) & 1) ? 0 : EXIT_LEFT;
+		}
+		return room_exits;
+	}
+
 #if SCREEPS_PATHFINDER_HAS_V8
 	// Loads static terrain data into module upfront (legacy V8 path)
-	void path_finder_t::load_terrain(v8::Local<v8::Array> terrain_array) {
+	void world_t::load_terrain(v8::Local<v8::Array> terrain_array) {
 		if (terrain_array.IsEmpty())
 			return;
 
@@ -716,11 +1423,14 @@ namespace {
 			if (bits.length() >= terrain_bytes_per_room)
 				ingest_terrain_chunk(pos, *bits, terrain_bytes_per_room);
 		}
+		if (landmark_setting != 0) {
+			build_landmarks();
+		}
 	}
 #endif
 
 	// Loads terrain data from POD structs (native bridge)
-	void path_finder_t::load_terrain(const terrain_room_plain* rooms, size_t count) {
+	void world_t::load_terrain(const terrain_room_plain* rooms, size_t count) {
 		if (rooms == nullptr || count == 0)
 			return;
 
@@ -730,9 +1440,130 @@ namespace {
 			map_position_t pos(room.xx, room.yy);
 			ingest_terrain_chunk(pos, room.bits, room.length);
 		}
+		if (landmark_setting != 0) {
+			build_landmarks();
+		}
+	}
+
+	size_t world_t::load_terrain_raw(const terrain_room_plain* rooms, size_t count, unsigned threads) {
+		if (rooms == nullptr || count == 0)
+			return 0;
+
+		// Workers pack into disjoint slices of one block and work out exits; publishing stays on this
+		// thread so duplicates resolve in input order
+		auto block = std::make_unique<uint8_t[]>(count * terrain_bytes_per_room);
+		std::vector<uint8_t> room_exits(count);
+		std::vector<uint8_t> packed(count);
+		std::atomic<size_t> next{0};
+		auto work = [&]() {
+			for (size_t ii = next++; ii < count; ii = next++) {
+				const terrain_room_plain& room = rooms[ii];
+				uint8_t* out = block.get() + ii * terrain_bytes_per_room;
+				if (room.bits != nullptr && terrain_packer_t::pack(room.bits, room.length, out)) {
+					room_exits[ii] = terrain_exits(map_position_t(room.xx, room.yy), out);
+					packed[ii] = 1;
+				}
+			}
+		};
+		threads = std::clamp<unsigned>(threads, 1, static_cast<unsigned>(std::min<size_t>(count, 64)));
+		std::vector<std::thread> workers;
+		for (unsigned ii = 1; ii < threads; ++ii) {
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+
+		// With no usable room the current terrain stays, as ScreepsPathfinder_LoadTerrain does
+		size_t rejected = std::count(packed.begin(), packed.end(), 0);
+		if (rejected == count)
+			return rejected;
+
+		reset_terrain_storage();
+		for (size_t ii = 0; ii < count; ++ii) {
+			if (packed[ii] == 0)
+				continue;
+			map_position_t pos(rooms[ii].xx, rooms[ii].yy);
+			terrain[pos.id] = block.get() + ii * terrain_bytes_per_room;
+			exits[pos.id] = room_exits[ii];
+		}
+		terrain_storage.push_back(std::move(block));
+		if (landmark_setting != 0) {
+			build_landmarks();
+		}
+		return rejected;
+	}
+
+	void world_t::set_landmarks(unsigned count, unsigned threads) {
+		landmark_setting = std::min(count, landmark_tables_t::k_max_landmarks);
+		landmark_threads = std::max(threads, 1u);
+		if (landmark_setting == 0) {
+			landmark_tables.clear();
+		} else {
+			build_landmarks();
+		}
+	}
+
+	void world_t::build_landmarks() {
+		landmark_tables.build(terrain.data(), terrain.size(), landmark_setting, landmark_threads, precompute_cache.get());
+		// Saved only when it changed: a room was computed or a stale entry can be dropped
+		if (precompute_cache != nullptr && precompute_cache->entry_count() != landmark_tables.cached_rooms()) {
+			precompute_cache->save(precompute_cache_path.c_str());
+		}
+	}
+
+	bool world_t::set_precompute_cache(const char* path) {
+		if (path == nullptr || *path == 0) {
+			precompute_cache.reset();
+			precompute_cache_path.clear();
+			return false;
+		}
+		precompute_cache = std::make_unique<precompute_cache_t>();
+		precompute_cache_path = path;
+		return precompute_cache->load(path);
+	}
+
+	void world_t::load_portals(const portal_t* entries, size_t count) {
+		portals.assign(entries, entries + (entries == nullptr ? 0 : count));
+		// Stable so that a later entry for the same source replaces the earlier one
+		std::stable_sort(portals.begin(), portals.end(), [](const portal_t& left, const portal_t& right) {
+			return left.source.id < right.source.id;
+		});
+		auto last = std::unique(portals.rbegin(), portals.rend(), [](const portal_t& left, const portal_t& right) {
+			return left.source.id == right.source.id;
+		});
+		portals.erase(portals.begin(), last.base());
+		index_portals();
+		// New portals can only shorten paths, which may undercut learned bounds
+		learned_heuristics.clear();
+	}
+
+	void world_t::expire_portals(uint32_t tick) {
+		auto expired = std::remove_if(portals.begin(), portals.end(), [&](const portal_t& portal) {
+			return portal.expires != 0 && portal.expires <= tick;
+		});
+		if (expired != portals.end()) {
+			portals.erase(expired, portals.end());
+			index_portals();
+		}
+	}
+
+	void world_t::index_portals() {
+		std::fill(portal_rooms.begin(), portal_rooms.end(), 0);
+		for (const portal_t& portal : portals) {
+			portal_rooms[portal.source.map_position().id] = 1;
+		}
+		// Portals come in the dozens, so the pairwise scan is cheap next to a single search
+		portal_reach.assign(portals.size(), std::numeric_limits<cost_t>::max());
+		for (size_t ii = 0; ii < portals.size(); ++ii) {
+			for (const portal_t& next : portals) {
+				portal_reach[ii] = std::min<cost_t>(portal_reach[ii], portals[ii].destination.range_to(next.source));
+			}
+		}
 	}
 
-	void path_finder_t::set_room_callback(room_callback_fn callback, void* userData)
+	void world_t::set_room_callback(room_callback_fn callback, void* userData)
 	{
 		native_room_callback = callback;
 		native_room_callback_context = userData;
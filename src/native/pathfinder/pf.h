@@ -1,25 +1,44 @@
 // Author: Marcel Laverdet <https://github.com/laverdet>
+#pragma once
 #ifndef SCREEPS_PATHFINDER_NO_V8
 #include <nan.h>
 #define SCREEPS_PATHFINDER_HAS_V8 1
 #else
 #define SCREEPS_PATHFINDER_HAS_V8 0
 #endif
+#include "arena.h"
+#include "landmarks.h"
+#include "learned_heuristic.h"
+#include "trace.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <limits>
 #include <memory>
 #include <stdexcept>
-#include <unordered_set>
+#include <string>
 #include <vector>
 
 namespace screeps {
 	typedef uint32_t cost_t; // maximum: longest chebyshev distance of whole map
-	typedef uint32_t pos_index_t; // maximum: k_max_rooms * 2500
+	typedef uint32_t pos_index_t; // maximum: k_max_rooms << k_room_index_shift
 	typedef uint32_t room_index_t; // maximum: k_max_rooms (32 bits tested faster than uint8_t)
-	constexpr size_t k_max_rooms = 64;
+	// Upper bound on rooms per search. Search storage is paged per room, so this only bounds the
+	// index space; memory grows with the rooms a search actually enters.
+	constexpr size_t k_max_rooms = 1024;
 	constexpr size_t k_terrain_bytes = 2500 * 2 / 8;
+	constexpr cost_t k_world_size = 256 * 50; // longest chebyshev distance of whole map
+
+	// Node indices are laid out as (room slot << 12) | (local x << 6) | local y. Converting an index
+	// back to a position is then shifts and masks instead of div/mod by 2500 and 50. A room's page
+	// only holds the 50 * 64 slots that local indices can reach.
+	constexpr unsigned k_room_index_shift = 12;
+	constexpr unsigned k_local_x_shift = 6;
+	constexpr uint32_t k_local_y_mask = (1 << k_local_x_shift) - 1;
+	constexpr size_t k_room_index_span = size_t(1) << k_room_index_shift;
+	constexpr size_t k_room_page_nodes = 50 << k_local_x_shift;
 
 	struct terrain_room_plain {
 		uint8_t xx;
@@ -32,11 +51,17 @@ namespace screeps {
 		const uint8_t* cost_matrix;
 		size_t cost_matrix_length;
 		bool block_room;
+		// Set by the search before the call: 2500 bytes the callback may compose the room's matrix into
+		// and return as cost_matrix, sparing the search its own copy
+		uint8_t* matrix_buffer;
+		// Set by the search: leave dynamic layers such as creeps out of the matrix
+		bool ignore_creeps;
 	};
 
 	using room_callback_fn = bool (*)(uint8_t room_x, uint8_t room_y, room_callback_result* result, void* context);
 
-	static_assert(std::numeric_limits<pos_index_t>::max() > 2500 * k_max_rooms, "pos_index_t is too small");
+	static_assert(std::numeric_limits<pos_index_t>::max() >= k_room_index_span * k_max_rooms - 1, "pos_index_t is too small");
+	static_assert(50 << k_local_x_shift <= k_room_index_span, "local coordinates overflow the room index span");
 
 	//
 	// Stores coordinates of a room on the global world map.
@@ -85,9 +110,9 @@ namespace screeps {
 
 		public:
 			union {
-				uint64_t id;
+				uint32_t id;
 				struct {
-					uint32_t xx, yy; // maximum: world_size[255] * 50 (32 bits tested faster than uint16_t)
+					uint16_t xx, yy; // maximum: world_size[256] * 50 = 12800
 				};
 			};
 
@@ -97,7 +122,7 @@ namespace screeps {
 
 			world_position_t(uint32_t xx, uint32_t yy) : xx(xx), yy(yy) {}
 
-			explicit world_position_t(uint64_t id) : id(id) {}
+			explicit world_position_t(uint32_t id) : id(id) {}
 
 #if SCREEPS_PATHFINDER_HAS_V8
 			world_position_t(v8::Local<v8::Value> pos) {
@@ -108,7 +133,7 @@ namespace screeps {
 #endif
 
 			static world_position_t null() {
-				return world_position_t(0);
+				return world_position_t(uint32_t(0));
 			}
 
 			friend std::ostream& operator<< (std::ostream& os, const world_position_t& that) {
@@ -198,21 +223,63 @@ namespace screeps {
 	};
 
 	//
-	// Simple open-closed list
-	template <size_t capacity>
-	class open_closed_t {
+	// Search state of a single tile. Everything an expansion reads or writes about a node lives in
+	// one 16 byte record, so touching a node costs one cache line instead of one per parallel array.
+	struct node_t {
+		pos_index_t parent;
+		cost_t f_cost; // heap priority; g_cost is recovered as f_cost - weighted heuristic
+		uint32_t heap_slot; // position in heap_t while the node is open
+		uint32_t marker; // open/closed generation, see node_table_t
+	};
+	static_assert(sizeof(node_t) == 16, "node_t should stay a quarter of a cache line");
+
+	//
+	// Node records, one page per room slot, with generation markers in place of an open-closed list.
+	// Pages are only allocated the first time a search enters that many rooms and are then reused by
+	// every later search, so memory tracks the largest search rather than k_max_rooms.
+	class node_pages_t {
 
 		private:
 			using marker_t = uint32_t;
-			std::array<marker_t, capacity> list;
+			using page_t = std::array<node_t, k_room_page_nodes>;
+			std::vector<std::unique_ptr<page_t>> pages;
 			marker_t marker;
 
 		public:
-			open_closed_t() : list{}, marker(1) {}
+			node_pages_t() : marker(1) {}
+
+			node_t& operator[](size_t index) {
+				return (*pages[index >> k_room_index_shift])[index & (k_room_index_span - 1)];
+			}
+
+			const node_t& operator[](size_t index) const {
+				return (*pages[index >> k_room_index_shift])[index & (k_room_index_span - 1)];
+			}
+
+			// Makes sure the page backing a room slot exists. New pages are zeroed, which no marker
+			// treats as open or closed.
+			void reserve_room(room_index_t slot) {
+				while (pages.size() <= slot) {
+					pages.push_back(std::make_unique<page_t>());
+				}
+			}
+
+			size_t page_count() const {
+				return pages.size();
+			}
+
+			void release_pages() {
+				pages.clear();
+				pages.shrink_to_fit();
+			}
 
 			void clear() {
 				if (std::numeric_limits<marker_t>::max() - 2 <= marker) {
-					std::fill(list.begin(), list.end(), 0);
+					for (auto& page : pages) {
+						for (node_t& node : *page) {
+							node.marker = 0;
+						}
+					}
 					marker = 1;
 				} else {
 					marker += 2;
@@ -220,19 +287,19 @@ namespace screeps {
 			}
 
 			bool is_open(size_t index) const {
-				return list[index] == marker;
+				return (*this)[index].marker == marker;
 			}
 
 			bool is_closed(size_t index) const {
-				return list[index] == marker + 1;
+				return (*this)[index].marker == marker + 1;
 			}
 
 			void open(size_t index) {
-				list[index] = marker;
+				(*this)[index].marker = marker;
 			}
 
 			void close(size_t index) {
-				list[index] = marker + 1;
+				(*this)[index].marker = marker + 1;
 			}
 	};
 
@@ -257,6 +324,10 @@ namespace screeps {
 			if (cost_matrix[xx][yy]) {
 				return cost_matrix[xx][yy];
 			}
+			return look_terrain(xx, yy);
+		}
+
+		uint8_t look_terrain(unsigned int xx, unsigned int yy) const {
 			unsigned int index = xx * 50 + yy;
 			return 0x03 & terrain[index / 4] >> (index % 4 * 2);
 		}
@@ -278,21 +349,46 @@ namespace screeps {
 		goal_t(world_position_t position, cost_t goal_range) : range(goal_range), pos(position) {}
 	};
 
+	//
+	// Portal between two tiles: stepping onto `source` continues at `destination` at no extra cost
+	struct portal_t {
+		world_position_t source;
+		world_position_t destination;
+		uint32_t expires; // game tick the portal disappears on, 0 when it is permanent
+	};
+
 	struct search_options_native {
 		cost_t plain_cost;
 		cost_t swamp_cost;
-		uint8_t max_rooms;
+		uint16_t max_rooms;
 		uint32_t max_ops;
 		uint32_t max_cost;
 		bool flee;
 		double heuristic_weight;
+		// false when the caller knows its room callback has nothing for this search
+		bool use_room_callback = true;
+		// Return only the jump points of the path; path_expander_t produces the tiles in between
+		bool waypoints_only = false;
+		// Passed on to the room callback, which then leaves creep layers out of its matrices
+		bool ignore_creeps = false;
+		// Read the world's learned heuristic for this goal. At heuristic weight 1 (and without a corridor)
+		// also feed it, which makes the search expand tile by tile so that its costs are exact
+		bool learn_heuristic = false;
+		// Version of the cost matrices the room callback hands out; tables learned under another are ignored
+		uint32_t heuristic_version = 0;
 	};
 
+	class room_set_t;
+	class precompute_cache_t;
+	class world_t;
+
 	struct search_request_native {
 		world_position_t origin;
 		const goal_t* goals;
 		size_t goal_count;
 		search_options_native options;
+		// When set, rooms outside this set are treated as blocked without asking the room callback
+		const room_set_t* corridor = nullptr;
 	};
 
 	enum class search_status {
@@ -314,50 +410,117 @@ namespace screeps {
 	using abort_callback_fn = bool (*)();
 
 	//
-	// Priority queue implementation w/ support for updating priorities
-	template <class index_t, class priority_t, size_t capacity>
+	// Walks a waypoint-only path tile by tile. Consecutive waypoints (and the last one and the origin)
+	// always lie on a straight or diagonal line, so the expander yields exactly the tiles a full result
+	// would hold, in the same order: from the end of the path back towards the origin, origin excluded.
+	class path_expander_t {
+		private:
+			const world_t* world;
+			world_position_t origin;
+			const world_position_t* waypoints;
+			size_t count;
+			size_t segment = 0; // waypoint the current segment starts from
+			world_position_t pos; // next tile to emit
+			world_position_t::direction_t dir;
+
+			world_position_t segment_end(size_t index) const {
+				return index + 1 < count ? waypoints[index + 1] : origin;
+			}
+
+			void start_segment(size_t index);
+			// The current segment is a portal hop, which is a single step whatever the distance
+			bool hop_segment() const;
+
+		public:
+			// `world` holds the portals the path was searched with
+			path_expander_t(const world_t& world, world_position_t origin, const world_position_t* waypoints, size_t count);
+
+			// Number of tiles in the expanded path, computed from the segment lengths alone
+			static size_t tile_count(const world_t& world, world_position_t origin, const world_position_t* waypoints, size_t count);
+
+			// Positions the expander at tile `index` of the expanded path
+			void seek(size_t index);
+
+			// Writes up to `max_count` tiles to `out` and returns how many were written; 0 once exhausted
+			size_t next(world_position_t* out, size_t max_count);
+
+			bool done() const {
+				return segment >= count;
+			}
+	};
+
+	//
+	// Compile-time shape of a search. search_native picks the matching instantiation once per
+	// request, so the inner loop carries no per-node tests for options the request cannot use.
+	template <bool flee_, bool multi_goal_, bool fixed_weight_, bool cost_matrix_, bool portals_, bool landmarks_, bool single_room_>
+	struct search_policy_t {
+		static constexpr bool flee = flee_; // maximize distance from goals instead of reaching one
+		static constexpr bool multi_goal = multi_goal_; // heuristic loops over goals, otherwise goals.front()
+		static constexpr bool fixed_weight = fixed_weight_; // heuristic_weight as a verified fixed-point multiplier
+		static constexpr bool cost_matrix = cost_matrix_; // rooms may carry a cost matrix overlay
+		static constexpr bool portals = portals_; // portal tiles are jump points and lead to their destination
+		static constexpr bool landmarks = landmarks_; // landmark triangle bounds or learned bounds raise the estimate
+		static constexpr bool single_room = single_room_; // max_rooms 1: costs come from the padded room grid
+	};
+
+	//
+	// Priority queue implementation w/ support for updating priorities. Priorities and heap slots are
+	// kept in the node records, so an update is a bubble up from a known slot rather than a scan.
+	template <class index_t, class nodes_t>
 	class heap_t {
 
 		private:
-			std::array<priority_t, capacity> priorities;
-			// Theoretical max number of open nodes is total node divided by 8. 1 node opens all its
-			// neighbors repeated perfectly over the whole graph. It's impossible to actually hit this
-			// limit with a regular pathfinder operation
-			std::array<index_t, 2500 * k_max_rooms / 8> heap;
+			nodes_t& nodes;
+			std::vector<index_t> heap;
 			size_t size_;
 
+			void place(size_t slot, index_t index) {
+				heap[slot] = index;
+				nodes[index].heap_slot = static_cast<uint32_t>(slot);
+			}
+
+			void swap_slots(size_t aa, size_t bb) {
+				index_t tmp = heap[aa];
+				place(aa, heap[bb]);
+				place(bb, tmp);
+			}
+
+			cost_t priority_at(size_t slot) const {
+				return nodes[heap[slot]].f_cost;
+			}
+
 		public:
-			heap_t() : size_(0) {}
+			explicit heap_t(nodes_t& nodes) : nodes(nodes), size_(0) {}
 
 			bool empty() const {
 				return size_ == 0;
 			}
 
-			priority_t priority(index_t index) const {
-				return priorities[index];
+			cost_t priority(index_t index) const {
+				return nodes[index].f_cost;
 			}
 
-			std::pair<index_t, priority_t> pop() {
-				std::pair<index_t, priority_t> ret(heap[1], priorities[heap[1]]);
-				heap[1] = heap[size_];
+			std::pair<index_t, cost_t> pop() {
+				std::pair<index_t, cost_t> ret(heap[1], priority_at(1));
+				place(1, heap[size_]);
 				--size_;
 				size_t vv = 1;
 				do {
 					size_t uu = vv;
 					if ((uu << 1) + 1 <= size_) {
-						if (priorities[heap[uu]] >= priorities[heap[uu << 1]]) {
+						if (priority_at(uu) >= priority_at(uu << 1)) {
 							vv = uu << 1;
 						}
-						if (priorities[heap[vv]] >= priorities[heap[(uu << 1) + 1]]) {
+						if (priority_at(vv) >= priority_at((uu << 1) + 1)) {
 							vv = (uu << 1) + 1;
 						}
 					} else if (uu << 1 <= size_) {
-						if (priorities[heap[uu]] >= priorities[heap[uu << 1]]) {
+						if (priority_at(uu) >= priority_at(uu << 1)) {
 							vv = uu << 1;
 						}
 					}
 					if (uu != vv) {
-						std::swap(heap[uu], heap[vv]);
+						swap_slots(uu, vv);
 					} else {
 						break;
 					}
@@ -365,30 +528,25 @@ namespace screeps {
 				return ret;
 			}
 
-			void insert(index_t index, priority_t priority) {
-				if (size_ == heap.size() - 1) {
-					throw std::runtime_error("Max heap");
+			void insert(index_t index, cost_t priority) {
+				if (size_ + 1 >= heap.size()) {
+					heap.resize(std::max<size_t>(heap.size() * 2, 1024));
 				}
-				priorities[index] = priority;
+				nodes[index].f_cost = priority;
 				++size_;
-				heap[size_] = index;
+				place(size_, index);
 				bubble_up(size_);
 			}
 
-			void update(index_t index, priority_t priority) {
-				for (size_t ii = size_; ii > 0; --ii) {
-					if (heap[ii] == index) {
-						priorities[index] = priority;
-						bubble_up(ii);
-						return;
-					}
-				}
+			void update(index_t index, cost_t priority) {
+				nodes[index].f_cost = priority;
+				bubble_up(nodes[index].heap_slot);
 			}
 
 			void bubble_up(size_t ii) {
 				while (ii != 1) {
-					if (priorities[heap[ii]] <= priorities[heap[ii >> 1]]) {
-						std::swap(heap[ii], heap[ii >> 1]);
+					if (priority_at(ii) <= priority_at(ii >> 1)) {
+						swap_slots(ii, ii >> 1);
 						ii = ii >> 1;
 					} else {
 						return;
@@ -399,6 +557,146 @@ namespace screeps {
 			void clear() {
 				size_ = 0;
 			}
+
+			void release() {
+				heap.clear();
+				heap.shrink_to_fit();
+				size_ = 0;
+			}
+	};
+
+	//
+	// Everything a search reads besides its request: terrain, portals, the tables precomputed from
+	// terrain and the native room callback. Each path_finder_t searches one world; worlds share
+	// nothing, so several (shards, or a simulation beside the live game) can live in one process and
+	// be searched concurrently.
+	//
+	// Sharing rules: any number of searches may read one world at once, and the learned heuristic
+	// tables and cost versions may be updated under them. Everything else (terrain, portals,
+	// landmarks, the precompute cache, the room callback) may only change while no search on the
+	// world is running; the world does not check this, its owner has to.
+	class world_t {
+		public:
+			world_t();
+			~world_t();
+			world_t(const world_t&) = delete;
+			world_t& operator=(const world_t&) = delete;
+
+			// World of path finders constructed without one
+			static world_t& default_world();
+
+#if SCREEPS_PATHFINDER_HAS_V8
+			void load_terrain(v8::Local<v8::Array> terrain);
+#endif
+			void load_terrain(const terrain_room_plain* rooms, size_t count);
+			// Loads terrain in any raw format terrain_packer_t accepts (picked per room by `length`),
+			// packing rooms on `threads` threads into one block. Rooms that fail to convert are skipped;
+			// returns how many. A later room replaces an earlier one with the same position.
+			size_t load_terrain_raw(const terrain_room_plain* rooms, size_t count, unsigned threads);
+			void set_room_callback(room_callback_fn callback, void* userData);
+
+			// Room edges with at least one walkable tile, derived from terrain when it is loaded
+			enum exit_mask_t : uint8_t { EXIT_TOP = 1, EXIT_RIGHT = 2, EXIT_BOTTOM = 4, EXIT_LEFT = 8 };
+
+			bool has_terrain(map_position_t room) const {
+				return terrain[room.id] != nullptr;
+			}
+
+			uint8_t room_exits(map_position_t room) const {
+				return exits[room.id];
+			}
+
+			// Packed terrain of a loaded room (2 bits per tile, [x * 50 + y]), nullptr when not loaded
+			const uint8_t* room_terrain(map_position_t room) const {
+				return terrain[room.id];
+			}
+
+			// Builds `count` ALT landmarks per room (0 drops them) on `threads` threads, now and after every
+			// terrain load
+			void set_landmarks(unsigned count, unsigned threads);
+
+			// File of terrain-derived tables (landmarks so far) reused across processes: rooms whose terrain
+			// it holds skip the precompute, and it is rewritten after builds that changed it. Takes effect
+			// from the next terrain load or set_landmarks; null or "" turns it off. Returns whether an
+			// existing file was read. Worlds may share a file only if they never build at the same time.
+			bool set_precompute_cache(const char* path);
+
+			const landmark_tables_t& landmark_table() const {
+				return landmark_tables;
+			}
+
+			// Per-goal heuristics learned from earlier searches; cleared with the terrain and on portal loads
+			learned_heuristics_t& learned_heuristic_tables() {
+				return learned_heuristics;
+			}
+
+			// Called by whoever owns the cost matrices and overlays the room callback composes, after every
+			// change to them. Learned tables are keyed by these versions, so bounds learned under the old
+			// costs are never read again; overlay changes only retire tables of searches that see overlays.
+			void note_cost_matrix_change() {
+				cost_matrix_version.fetch_add(1, std::memory_order_relaxed);
+			}
+			void note_cost_overlay_change() {
+				cost_overlay_version.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// Replaces the portal table
+			void load_portals(const portal_t* entries, size_t count);
+			// Drops portals whose expiry tick is at or before `tick`
+			void expire_portals(uint32_t tick);
+
+			size_t portal_count() const {
+				return portals.size();
+			}
+
+			// Where stepping onto `source` leads, nullptr when it is not a portal
+			const world_position_t* portal_destination(world_position_t source) const {
+				if (portal_rooms[source.map_position().id] == 0) {
+					return nullptr;
+				}
+				auto it = std::lower_bound(portals.begin(), portals.end(), source.id, [](const portal_t& portal, uint32_t id) {
+					return portal.source.id < id;
+				});
+				return it != portals.end() && it->source.id == source.id ? &it->destination : nullptr;
+			}
+
+			// Whether a path step from `from` to `to` is a portal hop rather than a walk
+			bool is_portal_hop(world_position_t from, world_position_t to) const;
+
+		private:
+			friend class path_finder_t;
+			friend class parallel_search_t;
+			static constexpr size_t map_position_size = 1 << sizeof(map_position_t) * 8;
+			static constexpr size_t terrain_bytes_per_room = k_terrain_bytes;
+
+			std::array<uint8_t*, map_position_size> terrain{};
+			std::array<uint8_t, map_position_size> exits{};
+			std::vector<std::unique_ptr<uint8_t[]>> terrain_storage;
+			room_callback_fn native_room_callback = nullptr;
+			void* native_room_callback_context = nullptr;
+
+			// Portal table sorted by source. portal_reach holds, per portal, the range from its destination
+			// to the nearest portal source, which bounds how much chaining portals can save.
+			std::vector<portal_t> portals;
+			std::vector<cost_t> portal_reach;
+			std::array<uint8_t, map_position_size> portal_rooms{}; // rooms holding a portal source
+			void index_portals();
+
+			// ALT tables, rebuilt with the terrain while landmark_setting is nonzero
+			landmark_tables_t landmark_tables;
+			unsigned landmark_setting = 0;
+			unsigned landmark_threads = 1;
+			std::unique_ptr<precompute_cache_t> precompute_cache;
+			std::string precompute_cache_path;
+			void build_landmarks();
+
+			learned_heuristics_t learned_heuristics;
+			std::atomic<uint32_t> cost_matrix_version{0};
+			std::atomic<uint32_t> cost_overlay_version{0};
+
+			void reset_terrain_storage();
+			void ingest_terrain_chunk(map_position_t pos, const uint8_t* source, size_t length);
+			static uint8_t terrain_exits(map_position_t pos, uint8_t* bits);
 	};
 
 	//
@@ -407,55 +705,159 @@ namespace screeps {
 		private:
 			static constexpr size_t map_position_size = 1 << sizeof(map_position_t) * 8;
 			static constexpr cost_t obstacle = std::numeric_limits<cost_t>::max();
-			static constexpr size_t terrain_bytes_per_room = k_terrain_bytes;
-			std::array<room_info_t, k_max_rooms> room_table;
+			std::vector<room_info_t> room_table;
 			size_t room_table_size = 0;
-			std::array<room_index_t, map_position_size> reverse_room_table;
-			std::unordered_set<map_position_t, map_position_t::hash_t> blocked_rooms;
-			std::array<pos_index_t, 2500 * k_max_rooms> parents;
-			open_closed_t<2500 * k_max_rooms> open_closed;
-			heap_t<pos_index_t, cost_t, 2500 * k_max_rooms> heap;
+			// Room slot + 1 for rooms loaded in this search, k_blocked_room for rooms refused by the room
+			// callback or corridor, 0 for rooms not seen yet
+			std::array<room_index_t, map_position_size> reverse_room_table{};
+			static constexpr room_index_t k_blocked_room = std::numeric_limits<room_index_t>::max();
+			std::vector<map_position_t> blocked_rooms;
+			// Set when a room was refused because the search already holds max_rooms rooms
+			bool room_cap_hit = false;
+			node_pages_t nodes;
+			heap_t<pos_index_t, node_pages_t> heap{nodes};
 			std::vector<goal_t> goals;
 			cost_t look_table[4] = {obstacle, obstacle, obstacle, obstacle};
 			double heuristic_weight;
+			static constexpr unsigned k_fixed_weight_shift = 16;
+			static constexpr cost_t k_max_fixed_weight_h = 1 << 16;
+			uint64_t fixed_heuristic_weight = 0;
+			double fixed_weight_source = -1;
+			cost_t fixed_weight_checked_h = 0;
 			room_index_t max_rooms;
-			bool flee;
+			const room_set_t* corridor = nullptr;
+			bool use_room_callback = true;
+			bool ignore_creeps = false;
+			bool specialize_kernels = true;
+			bool use_room_grid = true;
 #if SCREEPS_PATHFINDER_HAS_V8
 			v8::Local<v8::Value>* room_data_handles;
 			v8::Local<v8::Function>* room_callback;
 #endif
-			static room_callback_fn native_room_callback;
-			static void* native_room_callback_context;
+			world_t* world;
 			bool _is_in_use = false;
 
-			static std::array<uint8_t*, map_position_size> terrain;
-			static std::vector<std::unique_ptr<uint8_t[]>> terrain_storage;
-			static std::vector<std::unique_ptr<uint8_t[]>> cost_matrix_storage;
+			// Per-search heuristic bound through portals: the estimate from a tile is at most the range to a
+			// portal plus the least remaining cost after it. The closest k_portal_bounds portals are checked
+			// one by one; the rest are covered by portal_floor.
+			struct portal_bound_t {
+				world_position_t source;
+				cost_t remaining;
+			};
+			static constexpr size_t k_portal_bounds = 16;
+			std::vector<portal_bound_t> portal_bounds;
+			cost_t portal_floor = 0;
+
+			// Per goal of the search: the range of each landmark's distances over the goal's target tiles.
+			// The walk from a tile of the goal room is at least its distance below the lowest or above the
+			// highest. Goals whose targets reach past their room, or whose room's cost matrix turns a wall
+			// into a passage, keep table == nullptr and only the Chebyshev bound.
+			struct landmark_goal_t {
+				const uint16_t* table;
+				map_position_t room;
+				uint16_t low[landmark_tables_t::k_max_landmarks];
+				uint16_t high[landmark_tables_t::k_max_landmarks];
+			};
+			static constexpr cost_t k_max_landmark_goal_range = 5;
+			std::vector<landmark_goal_t> landmark_goals; // parallel to goals
+			bool prepare_landmark_goals();
+			void check_landmark_room(map_position_t room, const uint8_t* cost_matrix);
+			cost_t landmark_bound(const landmark_goal_t& goal, world_position_t pos) const;
+
+			// Adaptive A*: snapshot of the goal's learned table, and the expansions of an exact search that
+			// will feed it. Such a search expands tile by tile instead of jumping, so its costs are exact.
+			// The last room looked up is cached; expansions rarely leave it.
+			static constexpr uint32_t k_no_learned_room = std::numeric_limits<uint32_t>::max();
+			std::shared_ptr<const learned_table_t> learned_table;
+			learned_key_t learned_key{};
+			bool learning = false;
+			std::vector<learned_sample_t> learned_samples;
+			mutable uint32_t learned_room = k_no_learned_room;
+			mutable const uint16_t* learned_grid = nullptr;
+			bool prepare_learned_heuristic(const search_request_native& request);
+			cost_t learned_bound(world_position_t pos) const;
+			arena_t search_arena; // search-scoped copies of callback cost matrices
+
+			// Move costs of the one room a max_rooms 1 search may enter, [(x + 1) * 52 + y + 1] in local
+			// coordinates. The ring of obstacles around it stands in for the rooms such a search cannot
+			// load, so look() is a single load with no room lookup or bounds test.
+			static constexpr unsigned k_grid_size = 52;
+			std::array<cost_t, k_grid_size * k_grid_size> room_grid;
+			world_position_t grid_origin; // world position of local (0, 0)
+			// Costs of the four tiles packed in each terrain byte, for the look_table they were made from
+			std::array<std::array<cost_t, 4>, 256> grid_quads;
+			cost_t grid_quads_costs[2] = {0, 0};
+			void prepare_room_grid();
+			void fill_room_grid(const room_info_t& room, cost_t* grid);
+
+			// The multi-room kernels read the same layout per loaded room, built the first time a node of the
+			// room is expanded. Instead of obstacles the ring holds the edge tiles of the neighbouring rooms:
+			// copied once they are loaded, obstacles once they are blocked and k_unknown_cost until then,
+			// which sends look() through room_index_from_pos to load the room. Moves from the expanded node
+			// and jumps, which stop two tiles short of every edge, then never resolve rooms at all.
+			static constexpr cost_t k_unknown_cost = obstacle - 1;
+			std::vector<cost_t*> halo_grids; // per room slot, null until built in this search
+			std::vector<std::unique_ptr<cost_t[]>> halo_storage; // per room slot, kept across searches
+			const cost_t* current_grid = nullptr; // grid of the room holding the node being expanded
+			room_index_t current_slot = 0;
+			void enter_room(room_index_t slot);
+			void write_halo(cost_t* grid, int dx, int dy, map_position_t neighbor);
+			void patch_halos(map_position_t room);
+			cost_t tile_cost(const room_info_t& room, unsigned xx, unsigned yy) const;
+#if SCREEPS_PATHFINDER_TRACE
+			trace_ring_t trace;
+#endif
 
 			class js_error: public std::runtime_error {
 				public: js_error() : std::runtime_error("js error") {}
 			};
 
 			room_index_t room_index_from_pos(const map_position_t map_pos);
+			void block_room(map_position_t map_pos);
 			pos_index_t index_from_pos(const world_position_t pos);
 			world_position_t pos_from_index(pos_index_t index) const;
-			void push_node(pos_index_t parent_index, world_position_t node, cost_t g_cost);
+			template <class policy_t> void push_node(pos_index_t parent_index, world_position_t node, cost_t g_cost);
+
+			template <class policy_t> cost_t look(const world_position_t pos);
+			template <class policy_t> cost_t heuristic(const world_position_t pos) const;
+			template <class policy_t> cost_t weight_heuristic(cost_t h_cost) const;
+			template <class policy_t> cost_t estimate(world_position_t pos, cost_t h_cost) const;
+			template <class policy_t> cost_t landmark_heuristic(world_position_t pos) const;
+			template <class policy_t> void prepare_portal_bounds();
+			template <class policy_t> bool enter_portal(pos_index_t index, world_position_t pos, cost_t g_cost);
+			// Portal tiles end jump scans the way goal tiles do
+			template <class policy_t>
+			bool is_jump_stop(world_position_t pos) const {
+				return policy_t::portals && world->portal_destination(pos) != nullptr;
+			}
+			bool prepare_fixed_weight(double weight, cost_t max_h);
 
-			cost_t look(const world_position_t pos);
-			cost_t heuristic(const world_position_t pos) const;
+			template <class policy_t> void astar(pos_index_t index, world_position_t pos, cost_t g_cost);
 
-			void astar(pos_index_t index, world_position_t pos, cost_t g_cost);
+			template <class policy_t> world_position_t jump_x(cost_t cost, world_position_t pos, int dx);
+			template <class policy_t> world_position_t jump_y(cost_t cost, world_position_t pos, int dx);
+			template <class policy_t> world_position_t jump_xy(cost_t cost, world_position_t pos, int dx, int dy);
+			template <class policy_t> world_position_t jump(cost_t cost, world_position_t pos, int dx, int dy);
+			template <class policy_t> void jps(pos_index_t index, world_position_t pos, cost_t g_cost);
+			template <class policy_t> void jump_neighbor(world_position_t pos, pos_index_t index, world_position_t neighbor, cost_t g_cost, cost_t cost, cost_t n_cost);
 
-			world_position_t jump_x(cost_t cost, world_position_t pos, int dx);
-			world_position_t jump_y(cost_t cost, world_position_t pos, int dx);
-			world_position_t jump_xy(cost_t cost, world_position_t pos, int dx, int dy);
-			world_position_t jump(cost_t cost, world_position_t pos, int dx, int dy);
-			void jps(pos_index_t index, world_position_t pos, cost_t g_cost);
-			void jump_neighbor(world_position_t pos, pos_index_t index, world_position_t neighbor, cost_t g_cost, cost_t cost, cost_t n_cost);
-			static void reset_terrain_storage();
-			static void ingest_terrain_chunk(map_position_t pos, const uint8_t* source, size_t length);
+			template <bool... decided>
+			search_status dispatch_search(const bool (&shape)[7], const search_request_native& request, search_result_native& result, abort_callback_fn should_abort);
+			template <class policy_t>
+			search_status search_kernel(const search_request_native& request, search_result_native& result, abort_callback_fn should_abort);
 
 		public:
+			explicit path_finder_t(world_t& world = world_t::default_world()) : world(&world) {}
+
+			// Searches from now on read `world`; not while a search is running
+			void set_world(world_t& world) {
+				this->world = &world;
+			}
+
+			world_t& current_world() const {
+				return *world;
+			}
+
 #if SCREEPS_PATHFINDER_HAS_V8
 			v8::Local<v8::Value> search(
 				v8::Local<v8::Value> origin_js, v8::Local<v8::Array> goals_js,
@@ -476,10 +878,31 @@ namespace screeps {
 				return _is_in_use;
 			}
 
-#if SCREEPS_PATHFINDER_HAS_V8
-			static void load_terrain(v8::Local<v8::Array> terrain);
+			// When false every request runs the most general kernel; used to measure specialization
+			void set_kernel_specialization(bool enabled) {
+				specialize_kernels = enabled;
+			}
+
+			// When false max_rooms 1 searches run the multi-room kernels; used to measure the room grid
+			void set_room_grid(bool enabled) {
+				use_room_grid = enabled;
+			}
+
+			// Number of room pages currently held by this instance
+			size_t allocated_room_pages() const {
+				return nodes.page_count();
+			}
+
+			// Returns all search storage to the allocator; pages are recreated on demand
+			void release_search_storage();
+
+			// Events recorded by the most recent search, or nullptr unless built with SCREEPS_PATHFINDER_TRACE
+			const trace_ring_t* expansion_trace() const {
+#if SCREEPS_PATHFINDER_TRACE
+				return &trace;
+#else
+				return nullptr;
 #endif
-			static void load_terrain(const terrain_room_plain* rooms, size_t count);
-			static void set_room_callback(room_callback_fn callback, void* userData);
+			}
 	};
 };
@@ -0,0 +1,149 @@
+#include "precompute_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+using namespace screeps;
+
+namespace {
+	struct file_header_t {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t entries;
+	};
+
+	struct entry_header_t {
+		uint64_t hash;
+		uint16_t kind;
+		uint16_t parameter;
+		uint32_t bytes;
+	};
+
+	// Tables are at most a few dozen KB per room; anything larger is a corrupt file
+	constexpr uint32_t k_max_payload = 1 << 20;
+
+	struct file_closer_t {
+		void operator()(FILE* file) const {
+			std::fclose(file);
+		}
+	};
+	using file_t = std::unique_ptr<FILE, file_closer_t>;
+}
+
+	// FNV-1a over 64-bit words; the terrain is compared byte for byte on every hit anyway
+	uint64_t precompute_cache_t::terrain_hash(const uint8_t* terrain) {
+		uint64_t hash = 0xcbf29ce484222325ull;
+		size_t ii = 0;
+		for (; ii + 8 <= k_terrain_bytes; ii += 8) {
+			uint64_t word;
+			std::memcpy(&word, terrain + ii, sizeof(word));
+			hash = (hash ^ word) * 0x100000001b3ull;
+		}
+		for (; ii < k_terrain_bytes; ++ii) {
+			hash = (hash ^ terrain[ii]) * 0x100000001b3ull;
+		}
+		return hash ^ (hash >> 29);
+	}
+
+	bool precompute_cache_t::load(const char* path) {
+		entries.clear();
+		file_t file(std::fopen(path, "rb"));
+		file_header_t header;
+		if (file == nullptr || std::fread(&header, sizeof(header), 1, file.get()) != 1 || header.magic != k_magic || header.version != k_version) {
+			return false;
+		}
+		decltype(entries) loaded;
+		for (uint64_t ii = 0; ii < header.entries; ++ii) {
+			entry_header_t entry_header;
+			auto entry = std::make_unique<entry_t>();
+			if (std::fread(&entry_header, sizeof(entry_header), 1, file.get()) != 1 || entry_header.bytes > k_max_payload ||
+				std::fread(entry->terrain, k_terrain_bytes, 1, file.get()) != 1) {
+				return false;
+			}
+			entry->kind = static_cast<table_kind>(entry_header.kind);
+			entry->parameter = entry_header.parameter;
+			entry->used = false;
+			entry->payload.resize(entry_header.bytes);
+			if ((entry_header.bytes != 0 && std::fread(entry->payload.data(), entry_header.bytes, 1, file.get()) != 1) ||
+				terrain_hash(entry->terrain) != entry_header.hash) {
+				return false;
+			}
+			loaded.emplace(entry_header.hash, std::move(entry));
+		}
+		entries = std::move(loaded);
+		return true;
+	}
+
+	bool precompute_cache_t::save(const char* path) {
+		for (auto it = entries.begin(); it != entries.end();) {
+			it = it->second->used ? std::next(it) : entries.erase(it);
+		}
+		std::string temporary = std::string(path) + ".tmp";
+		{
+			file_t file(std::fopen(temporary.c_str(), "wb"));
+			if (file == nullptr) {
+				return false;
+			}
+			file_header_t header{k_magic, k_version, entries.size()};
+			bool written = std::fwrite(&header, sizeof(header), 1, file.get()) == 1;
+			for (auto& item : entries) {
+				entry_t& entry = *item.second;
+				entry_header_t entry_header{item.first, static_cast<uint16_t>(entry.kind), entry.parameter, static_cast<uint32_t>(entry.payload.size())};
+				written = written &&
+					std::fwrite(&entry_header, sizeof(entry_header), 1, file.get()) == 1 &&
+					std::fwrite(entry.terrain, k_terrain_bytes, 1, file.get()) == 1 &&
+					(entry.payload.empty() || std::fwrite(entry.payload.data(), entry.payload.size(), 1, file.get()) == 1);
+				entry.used = false;
+			}
+			if (!written || std::fflush(file.get()) != 0) {
+				file.reset();
+				std::remove(temporary.c_str());
+				return false;
+			}
+		}
+		// std::rename refuses to replace an existing file on the Windows CRT; this one replaces it everywhere
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+		if (error) {
+			std::remove(temporary.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	const uint8_t* precompute_cache_t::find(const uint8_t* terrain, table_kind kind, uint16_t parameter, size_t bytes) {
+		entry_t* entry = lookup(terrain_hash(terrain), terrain, kind, parameter);
+		if (entry == nullptr || entry->payload.size() != bytes) {
+			return nullptr;
+		}
+		entry->used = true;
+		return entry->payload.data();
+	}
+
+	void precompute_cache_t::store(const uint8_t* terrain, table_kind kind, uint16_t parameter, const void* payload, size_t bytes) {
+		uint64_t hash = terrain_hash(terrain);
+		entry_t* entry = lookup(hash, terrain, kind, parameter);
+		if (entry == nullptr) {
+			auto created = std::make_unique<entry_t>();
+			created->kind = kind;
+			created->parameter = parameter;
+			std::memcpy(created->terrain, terrain, k_terrain_bytes);
+			entry = created.get();
+			entries.emplace(hash, std::move(created));
+		}
+		auto source = static_cast<const uint8_t*>(payload);
+		entry->payload.assign(source, source + bytes);
+		entry->used = true;
+	}
+
+	precompute_cache_t::entry_t* precompute_cache_t::lookup(uint64_t hash, const uint8_t* terrain, table_kind kind, uint16_t parameter) {
+		auto range = entries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			entry_t& entry = *it->second;
+			if (entry.kind == kind && entry.parameter == parameter && std::memcmp(entry.terrain, terrain, k_terrain_bytes) == 0) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// Terrain-derived tables keyed by the content of a room's packed terrain (625 bytes), kept in a
+	// versioned file so a restarted process only recomputes the rooms whose terrain changed. Entries
+	// hold their terrain bytes as well as its hash, so a hash collision is a miss rather than a wrong
+	// table, and identical rooms anywhere in the world share an entry.
+	//
+	// File layout, native byte order: a header (magic, k_version, entry count) followed by entries of
+	// { hash, kind, parameter, payload bytes, terrain[625], payload }. Files with another magic or
+	// version, or that end early, load as empty.
+	class precompute_cache_t {
+		public:
+			static constexpr uint32_t k_magic = 0x43465053; // "SPFC"
+			static constexpr uint32_t k_version = 1;
+			static constexpr size_t k_terrain_bytes = 625;
+
+			enum class table_kind : uint16_t {
+				Landmarks = 1, // landmark_tables_t distances, parameter = landmarks per room
+			};
+
+			static uint64_t terrain_hash(const uint8_t* terrain);
+
+			// Replaces the contents with the file at `path`; false when it is missing or unusable
+			bool load(const char* path);
+
+			// Writes the entries used since the last load or save, through a temporary file renamed over
+			// `path` so concurrent readers see the old file or the new one. Unused entries are dropped.
+			bool save(const char* path);
+
+			// Payload stored for this terrain, kind and parameter, nullptr when there is none. A hit counts
+			// as a use.
+			const uint8_t* find(const uint8_t* terrain, table_kind kind, uint16_t parameter, size_t bytes);
+
+			void store(const uint8_t* terrain, table_kind kind, uint16_t parameter, const void* payload, size_t bytes);
+
+			size_t entry_count() const {
+				return entries.size();
+			}
+
+		private:
+			struct entry_t {
+				table_kind kind;
+				uint16_t parameter;
+				bool used;
+				uint8_t terrain[k_terrain_bytes];
+				std::vector<uint8_t> payload;
+			};
+			std::unordered_multimap<uint64_t, std::unique_ptr<entry_t>> entries;
+
+			entry_t* lookup(uint64_t hash, const uint8_t* terrain, table_kind kind, uint16_t parameter);
+	};
+}
@@ -0,0 +1,179 @@
+#include "room_analysis.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace screeps;
+
+namespace {
+	using row_t = room_grid_t::row_t;
+	constexpr unsigned k_size = room_grid_t::k_size;
+	constexpr row_t k_row_mask = room_grid_t::k_row_mask;
+	constexpr row_t k_first_bit = 1;
+	constexpr row_t k_last_bit = row_t(1) << (k_size - 1);
+
+	unsigned count_trailing_zeros(row_t value) {
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#elif defined(_MSC_VER)
+		// 32-bit MSVC has no 64-bit scan; rows are never zero here, so one of the halves has a bit set
+		unsigned long index;
+		if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+			return index;
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+		return index + 32;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	// Writes `value` into the output cell of every set bit in row `xx`
+	void assign_row(row_t bits, unsigned xx, uint8_t value, uint8_t* out) {
+		while (bits != 0) {
+			out[xx * k_size + count_trailing_zeros(bits)] = value;
+			bits &= bits - 1;
+		}
+	}
+
+	// Tiles whose left/right neighbours (including themselves) are all set; `outside` is what lies
+	// past the room border
+	row_t erode_row(row_t row, row_t outside) {
+		row_t up = (row << 1) | (outside & k_first_bit);
+		row_t down = (row >> 1) | (outside & k_last_bit);
+		return row & up & down & k_row_mask;
+	}
+
+	row_t dilate_row(row_t row) {
+		return (row | (row << 1) | (row >> 1)) & k_row_mask;
+	}
+}
+
+	bool room_grid_t::load(const world_t& world, map_position_t room, const uint8_t* cost_matrix) {
+		const uint8_t* terrain = world.room_terrain(room);
+		if (terrain == nullptr) {
+			return false;
+		}
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			row_t row = 0;
+			for (unsigned yy = 0; yy < k_size; ++yy) {
+				unsigned index = xx * k_size + yy;
+				uint8_t cost = cost_matrix == nullptr ? 0 : cost_matrix[index];
+				bool blocked = cost != 0 ? cost == 0xff : (terrain[index / 4] >> (index % 4 * 2)) & 1;
+				row |= row_t(!blocked) << yy;
+			}
+			rows[xx] = row;
+		}
+		return true;
+	}
+
+	void room_grid_t::distance_transform(bool edges_block, uint8_t* out) const {
+		std::memset(out, 0, k_size * k_size);
+		row_t outside = edges_block ? 0 : k_row_mask;
+
+		// Level k holds the tiles whose (2k+1)^2 square is walkable; a tile leaving the set after k
+		// erosions is at distance k + 1 from the nearest blocked tile
+		row_t level[k_size];
+		std::copy(rows, rows + k_size, level);
+		for (unsigned distance = 1;; ++distance) {
+			row_t eroded[k_size];
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				eroded[xx] = erode_row(level[xx], outside);
+			}
+			row_t next[k_size];
+			row_t remaining = 0;
+			bool changed = false;
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				row_t above = xx > 0 ? eroded[xx - 1] : outside;
+				row_t below = xx + 1 < k_size ? eroded[xx + 1] : outside;
+				next[xx] = above & eroded[xx] & below;
+				remaining |= next[xx];
+				changed |= next[xx] != level[xx];
+			}
+			// An open room without blocked tiles never erodes further; everything left saturates
+			bool saturated = !changed || distance == k_unreached;
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				if (saturated) {
+					assign_row(level[xx], xx, k_unreached, out);
+				} else {
+					assign_row(level[xx] & ~next[xx], xx, static_cast<uint8_t>(distance), out);
+				}
+			}
+			if (saturated || remaining == 0) {
+				return;
+			}
+			std::copy(next, next + k_size, level);
+		}
+	}
+
+	void room_grid_t::flood_fill(const room_tile_t* sources, size_t source_count, unsigned max_range, uint8_t* out) const {
+		row_t frontier[k_size] = {};
+		for (size_t ii = 0; ii < source_count; ++ii) {
+			if (sources[ii].xx < k_size && sources[ii].yy < k_size) {
+				frontier[sources[ii].xx] |= row_t(1) << sources[ii].yy;
+			}
+		}
+		flood_rows(frontier, max_range, out);
+	}
+
+	void room_grid_t::exit_distance(uint8_t exit_mask, unsigned max_range, uint8_t* out) const {
+		if (exit_mask == 0) {
+			exit_mask = world_t::EXIT_TOP | world_t::EXIT_RIGHT | world_t::EXIT_BOTTOM | world_t::EXIT_LEFT;
+		}
+		row_t frontier[k_size] = {};
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			if (exit_mask & world_t::EXIT_TOP) {
+				frontier[xx] |= rows[xx] & k_first_bit;
+			}
+			if (exit_mask & world_t::EXIT_BOTTOM) {
+				frontier[xx] |= rows[xx] & k_last_bit;
+			}
+		}
+		if (exit_mask & world_t::EXIT_LEFT) {
+			frontier[0] |= rows[0];
+		}
+		if (exit_mask & world_t::EXIT_RIGHT) {
+			frontier[k_size - 1] |= rows[k_size - 1];
+		}
+		flood_rows(frontier, max_range, out);
+	}
+
+	void room_grid_t::flood_rows(row_t* frontier, unsigned max_range, uint8_t* out) const {
+		std::memset(out, k_unreached, k_size * k_size);
+		max_range = std::min<unsigned>(max_range, k_unreached - 1);
+
+		row_t reached[k_size];
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			reached[xx] = frontier[xx];
+			assign_row(frontier[xx], xx, 0, out);
+		}
+		for (unsigned distance = 1; distance <= max_range; ++distance) {
+			row_t spread[k_size];
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				spread[xx] = dilate_row(frontier[xx]);
+			}
+			row_t any = 0;
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				row_t neighbours = spread[xx];
+				if (xx > 0) {
+					neighbours |= spread[xx - 1];
+				}
+				if (xx + 1 < k_size) {
+					neighbours |= spread[xx + 1];
+				}
+				frontier[xx] = neighbours & rows[xx] & ~reached[xx];
+				any |= frontier[xx];
+			}
+			if (any == 0) {
+				return;
+			}
+			for (unsigned xx = 0; xx < k_size; ++xx) {
+				reached[xx] |= frontier[xx];
+				assign_row(frontier[xx], xx, static_cast<uint8_t>(distance), out);
+			}
+		}
+	}
@@ -0,0 +1,57 @@
+#pragma once
+#include "pf.h"
+#include <cstdint>
+
+namespace screeps {
+
+	// Local tile inside a room, 0-49 on both axes
+	struct room_tile_t {
+		uint8_t xx;
+		uint8_t yy;
+	};
+
+	//
+	// Walkability of one room as 50 bit rows (row = x, bit = y), built from loaded terrain and an
+	// optional cost matrix. The kernels below work a whole row per instruction: dilation and erosion
+	// are shifts and ANDs/ORs of neighbouring rows, so a full-room pass is ~150 word operations.
+	//
+	// Output grids are 2500 bytes indexed [x * 50 + y], like terrain and cost matrices.
+	class room_grid_t {
+		public:
+			using row_t = uint64_t;
+			static constexpr unsigned k_size = 50;
+			static constexpr row_t k_row_mask = (row_t(1) << k_size) - 1;
+			static constexpr uint8_t k_unreached = 255;
+
+			// Loads the room's terrain from `world`; a cost matrix overrides terrain where it is nonzero and
+			// blocks at 255, the same rule searches use. Returns false when the room has no terrain loaded.
+			bool load(const world_t& world, map_position_t room, const uint8_t* cost_matrix);
+
+			bool walkable(unsigned xx, unsigned yy) const {
+				return (rows[xx] >> yy) & 1;
+			}
+
+			// Walkable bits of column `xx`, bit y set for a walkable (xx, y)
+			row_t row(unsigned xx) const {
+				return rows[xx];
+			}
+
+			// Chebyshev distance from every walkable tile to the nearest blocked one (0 on blocked tiles).
+			// With `edges_block` the tiles beyond the room border count as blocked; otherwise open rooms
+			// saturate at 255.
+			void distance_transform(bool edges_block, uint8_t* out) const;
+
+			// Multi-source 8-neighbour BFS over walkable tiles. Tiles farther than `max_range` steps, or not
+			// reachable at all, are left at 255.
+			void flood_fill(const room_tile_t* sources, size_t source_count, unsigned max_range, uint8_t* out) const;
+
+			// Flood fill seeded from the walkable border tiles on the sides in `exit_mask`
+			// (world_t::exit_mask_t bits, 0 for every side)
+			void exit_distance(uint8_t exit_mask, unsigned max_range, uint8_t* out) const;
+
+		private:
+			row_t rows[k_size];
+
+			void flood_rows(row_t* frontier, unsigned max_range, uint8_t* out) const;
+	};
+}
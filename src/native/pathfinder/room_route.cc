@@ -0,0 +1,157 @@
+#include "room_route.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <tuple>
+
+using namespace screeps;
+
+	void room_set_t::insert_around(map_position_t room, int margin) {
+		for (int dx = -margin; dx <= margin; ++dx) {
+			for (int dy = -margin; dy <= margin; ++dy) {
+				int xx = room.xx + dx;
+				int yy = room.yy + dy;
+				if (xx >= 0 && xx <= 255 && yy >= 0 && yy <= 255) {
+					insert(map_position_t(xx, yy));
+				}
+			}
+		}
+	}
+
+	double room_router_t::room_cost(map_position_t room, const room_route_options_t& options) const {
+		if (options.blocked != nullptr && options.blocked->contains(room)) {
+			return std::numeric_limits<double>::infinity();
+		}
+		for (size_t ii = 0; ii < options.cost_count; ++ii) {
+			if (options.costs[ii].room == room) {
+				return options.costs[ii].blocked ? std::numeric_limits<double>::infinity() : options.costs[ii].cost;
+			}
+		}
+		return options.default_cost;
+	}
+
+	route_status room_router_t::find_route(
+		const world_t& world,
+		map_position_t from,
+		map_position_t to,
+		const room_route_options_t& options,
+		std::vector<map_position_t>& route,
+		double* total_cost
+	) {
+		route.clear();
+		if (!world.has_terrain(from) || !world.has_terrain(to)) {
+			return route_status::InvalidRoom;
+		}
+		if (from == to) {
+			route.push_back(from);
+			if (total_cost != nullptr) {
+				*total_cost = 0;
+			}
+			return route_status::Success;
+		}
+
+		// Manhattan distance times the cheapest room cost stays admissible
+		double min_cost = options.default_cost;
+		for (size_t ii = 0; ii < options.cost_count; ++ii) {
+			if (!options.costs[ii].blocked) {
+				min_cost = std::min(min_cost, options.costs[ii].cost);
+			}
+		}
+		min_cost = std::max(min_cost, 0.0);
+		auto heuristic = [&](map_position_t room) {
+			return (std::abs(room.xx - to.xx) + std::abs(room.yy - to.yy)) * min_cost;
+		};
+
+		// Many routes tie under the Manhattan metric; prefer the ones that hug the straight line between
+		// the endpoints, since that is where the tile search will want to walk
+		auto deviation = [&](map_position_t room) {
+			int cross = (room.xx - to.xx) * (from.yy - to.yy) - (from.xx - to.xx) * (room.yy - to.yy);
+			return std::abs(cross);
+		};
+
+		if (nodes.empty()) {
+			nodes.resize(size_t(1) << sizeof(map_position_t) * 8, room_node_t{0, 0, map_position_t(0, 0), false});
+		}
+		if (++visit == 0) {
+			// The stamp wrapped: entries from 2^32 calls ago would look current
+			for (room_node_t& node : nodes) {
+				node.visit = 0;
+			}
+			visit = 1;
+		}
+		auto push = [&](double f_cost, int deviation, uint16_t id) {
+			open.emplace_back(f_cost, deviation, id);
+			std::push_heap(open.begin(), open.end(), std::greater<open_entry_t>());
+		};
+		open.clear();
+		nodes[from.id] = room_node_t{0, visit, from, false};
+		push(heuristic(from), 0, from.id);
+
+		static constexpr int dx[4] = { 0, 1, 0, -1 };
+		static constexpr int dy[4] = { -1, 0, 1, 0 };
+		static constexpr uint8_t exit_bits[4] = {
+			world_t::EXIT_TOP, world_t::EXIT_RIGHT, world_t::EXIT_BOTTOM, world_t::EXIT_LEFT
+		};
+		uint32_t explored = 0;
+		while (!open.empty()) {
+			map_position_t current;
+			current.id = std::get<2>(open.front());
+			std::pop_heap(open.begin(), open.end(), std::greater<open_entry_t>());
+			open.pop_back();
+			room_node_t& node = nodes[current.id];
+			if (node.closed) {
+				continue;
+			}
+			node.closed = true;
+			if (current == to) {
+				break;
+			}
+			if (++explored > options.max_rooms_explored) {
+				return route_status::NoRoute;
+			}
+
+			uint8_t exits = world.room_exits(current);
+			for (int dir = 0; dir < 4; ++dir) {
+				int xx = current.xx + dx[dir];
+				int yy = current.yy + dy[dir];
+				if (!(exits & exit_bits[dir]) || xx < 0 || xx > 255 || yy < 0 || yy > 255) {
+					continue;
+				}
+				map_position_t neighbor(xx, yy);
+				if (!(world.room_exits(neighbor) & exit_bits[(dir + 2) % 4])) {
+					continue;
+				}
+				double cost = room_cost(neighbor, options);
+				if (cost == std::numeric_limits<double>::infinity()) {
+					continue;
+				}
+				double g_cost = node.g_cost + cost;
+				room_node_t& next = nodes[neighbor.id];
+				if (next.visit != visit || (!next.closed && g_cost < next.g_cost)) {
+					next = room_node_t{g_cost, visit, current, false};
+					push(g_cost + heuristic(neighbor), deviation(neighbor), neighbor.id);
+				}
+			}
+		}
+
+		const room_node_t& found = nodes[to.id];
+		if (found.visit != visit || !found.closed) {
+			return route_status::NoRoute;
+		}
+		if (total_cost != nullptr) {
+			*total_cost = found.g_cost;
+		}
+		for (map_position_t room = to; !(room == from); room = nodes[room.id].parent) {
+			route.push_back(room);
+		}
+		route.push_back(from);
+		std::reverse(route.begin(), route.end());
+		return route_status::Success;
+	}
+
+	void room_router_t::build_corridor(const std::vector<map_position_t>& route, int margin, room_set_t& corridor) {
+		for (map_position_t room : route) {
+			corridor.insert_around(room, std::max(margin, 0));
+		}
+	}
@@ -0,0 +1,98 @@
+#pragma once
+#include "pf.h"
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace screeps {
+
+	//
+	// Bit set over every map_position_t on the world map. Used for route blocking masks and for the
+	// corridor of rooms a tile search may enter.
+	class room_set_t {
+
+		private:
+			static constexpr size_t word_bits = 64;
+			std::vector<uint64_t> words;
+
+		public:
+			room_set_t() : words((size_t(1) << sizeof(map_position_t) * 8) / word_bits, 0) {}
+
+			bool contains(map_position_t room) const {
+				return (words[room.id / word_bits] >> (room.id % word_bits)) & 1;
+			}
+
+			void insert(map_position_t room) {
+				words[room.id / word_bits] |= uint64_t(1) << (room.id % word_bits);
+			}
+
+			void clear() {
+				std::fill(words.begin(), words.end(), 0);
+			}
+
+			// Adds every room within `margin` rooms (Chebyshev) of `room`
+			void insert_around(map_position_t room, int margin);
+	};
+
+	//
+	// Per-room entry cost override for the room router. `cost` is the price of entering the room;
+	// blocked rooms are never entered.
+	struct room_route_cost_t {
+		map_position_t room;
+		double cost;
+		bool blocked;
+	};
+
+	struct room_route_options_t {
+		const room_route_cost_t* costs = nullptr;
+		size_t cost_count = 0;
+		const room_set_t* blocked = nullptr; // rooms that may not be entered, e.g. hostile or novice areas
+		double default_cost = 1;
+		uint32_t max_rooms_explored = 4096;
+	};
+
+	enum class route_status {
+		Success,
+		NoRoute,
+		InvalidRoom
+	};
+
+	//
+	// Room-level A* over the exit graph derived from loaded terrain, similar to Game.map.findRoute.
+	// Two rooms are connected when both have walkable tiles on their shared edge. The node table
+	// (1 MB, one entry per map position) and open list are kept between calls, so a warm router
+	// routes without allocating. Not thread-safe; keep one per thread.
+	class room_router_t {
+
+		public:
+			// Writes the rooms from `from` to `to`, both included, into `route`
+			route_status find_route(
+				const world_t& world,
+				map_position_t from,
+				map_position_t to,
+				const room_route_options_t& options,
+				std::vector<map_position_t>& route,
+				double* total_cost = nullptr);
+
+			// Builds the set of rooms a search may enter: every room on the route plus `margin` rooms
+			// around each of them
+			static void build_corridor(const std::vector<map_position_t>& route, int margin, room_set_t& corridor);
+
+		private:
+			struct room_node_t {
+				double g_cost;
+				// Entries from an earlier call have an older visit and count as unseen
+				uint32_t visit;
+				map_position_t parent;
+				bool closed;
+			};
+			// f cost, deviation from the straight line, room id
+			using open_entry_t = std::tuple<double, int, uint16_t>;
+
+			std::vector<room_node_t> nodes;
+			std::vector<open_entry_t> open;
+			uint32_t visit = 0;
+
+			double room_cost(map_position_t room, const room_route_options_t& options) const;
+	};
+}
@@ -0,0 +1,168 @@
+#!/usr/bin/env node
+
+// Renders per-room heatmaps from a pathfinder expansion trace (ScreepsPathfinder_DumpTrace or
+// `pathfinder_bench --trace FILE` on a build configured with -DSCREEPS_PATHFINDER_TRACE=ON).
+//
+//   node render-trace-heatmap.js <trace.bin> [--kind close|push|update|jump|all] [--rooms N] [--out DIR]
+//
+// Prints a summary and an ASCII heatmap for the N busiest rooms; with --out, also writes one PGM
+// image per rendered room (50x50, scaled 8x) into DIR.
+
+const fs = require('fs');
+const path = require('path');
+
+const KINDS = ['', 'push', 'update', 'close', 'jump-start', 'jump-end', 'room-load'];
+const SHADES = ' .:-=+*#%@';
+const SCALE = 8;
+
+const args = process.argv.slice(2);
+let tracePath;
+let kindFilter = 'close';
+let roomLimit = 4;
+let outDir;
+
+for (let i = 0; i < args.length; i++) {
+  if (args[i] === '--kind' || args[i] === '--rooms' || args[i] === '--out') {
+    if (i + 1 >= args.length) {
+      console.error(`${args[i]} requires a value`);
+      process.exit(1);
+    }
+    const value = args[++i];
+    if (args[i - 1] === '--kind') {
+      kindFilter = value;
+    } else if (args[i - 1] === '--rooms') {
+      roomLimit = Math.max(1, parseInt(value, 10) || 1);
+    } else {
+      outDir = path.resolve(value);
+    }
+  } else if (!tracePath) {
+    tracePath = path.resolve(args[i]);
+  } else {
+    console.warn(`Unknown argument ignored: ${args[i]}`);
+  }
+}
+
+if (!tracePath) {
+  console.error('Usage: render-trace-heatmap.js <trace.bin> [--kind close|push|update|jump|all] [--rooms N] [--out DIR]');
+  process.exit(1);
+}
+
+const selectedKinds = {
+  close: ['close'],
+  push: ['push'],
+  update: ['update'],
+  jump: ['jump-start', 'jump-end'],
+  all: ['push', 'update', 'close', 'jump-start', 'jump-end'],
+}[kindFilter];
+if (!selectedKinds) {
+  console.error(`Unknown --kind ${kindFilter}`);
+  process.exit(1);
+}
+
+function readTrace(file) {
+  const buffer = fs.readFileSync(file);
+  if (buffer.length < 16 || buffer.toString('latin1', 0, 4) !== 'PFTR') {
+    throw new Error(`${file} is not a pathfinder trace`);
+  }
+  const version = buffer.readUInt16LE(4);
+  const eventSize = buffer.readUInt16LE(6);
+  const count = buffer.readUInt32LE(8);
+  const dropped = buffer.readUInt32LE(12);
+  if (version !== 1 || eventSize < 9 || buffer.length < 16 + count * eventSize) {
+    throw new Error(`${file}: unsupported trace version ${version} or truncated file`);
+  }
+  const events = [];
+  for (let i = 0; i < count; i++) {
+    const offset = 16 + i * eventSize;
+    events.push({
+      x: buffer.readUInt16LE(offset),
+      y: buffer.readUInt16LE(offset + 2),
+      cost: buffer.readUInt32LE(offset + 4),
+      kind: KINDS[buffer.readUInt8(offset + 8)] || 'unknown',
+    });
+  }
+  return { events, dropped };
+}
+
+// Inverse of the native room numbering: x 0-127 is W127-W0, 128-255 is E0-E127; same for N/S on y
+function roomName(roomX, roomY) {
+  const horizontal = roomX <= 127 ? `W${127 - roomX}` : `E${roomX - 128}`;
+  const vertical = roomY <= 127 ? `N${127 - roomY}` : `S${roomY - 128}`;
+  return horizontal + vertical;
+}
+
+function writePgm(file, counts, max) {
+  const size = 50 * SCALE;
+  const header = Buffer.from(`P5\n${size} ${size}\n255\n`, 'latin1');
+  const pixels = Buffer.alloc(size * size);
+  for (let py = 0; py < size; py++) {
+    for (let px = 0; px < size; px++) {
+      const count = counts[Math.floor(px / SCALE) * 50 + Math.floor(py / SCALE)];
+      pixels[py * size + px] = max === 0 ? 0 : Math.round(255 * Math.sqrt(count / max));
+    }
+  }
+  fs.writeFileSync(file, Buffer.concat([header, pixels]));
+}
+
+const { events, dropped } = readTrace(tracePath);
+const totals = {};
+const rooms = new Map();
+let loadedRooms = 0;
+let blockedRooms = 0;
+let deadJumps = 0;
+
+for (const event of events) {
+  totals[event.kind] = (totals[event.kind] || 0) + 1;
+  if (event.kind === 'room-load') {
+    if (event.cost === 0xffffffff) {
+      blockedRooms++;
+    } else {
+      loadedRooms++;
+    }
+    continue;
+  }
+  if (event.kind === 'jump-end' && event.cost === 0xffffffff) {
+    deadJumps++;
+  }
+  if (!selectedKinds.includes(event.kind)) {
+    continue;
+  }
+  const key = roomName(Math.floor(event.x / 50), Math.floor(event.y / 50));
+  let room = rooms.get(key);
+  if (!room) {
+    room = { name: key, total: 0, counts: new Uint32Array(2500) };
+    rooms.set(key, room);
+  }
+  room.counts[(event.x % 50) * 50 + (event.y % 50)]++;
+  room.total++;
+}
+
+console.log(`${events.length} events${dropped ? ` (${dropped} older events dropped)` : ''}`);
+console.log(
+  Object.keys(totals)
+    .map((kind) => `  ${kind}: ${totals[kind]}`)
+    .join('\n')
+);
+console.log(`  rooms loaded: ${loadedRooms}, blocked: ${blockedRooms}, jumps into obstacles: ${deadJumps}`);
+
+const ranked = [...rooms.values()].sort((a, b) => b.total - a.total);
+if (outDir) {
+  fs.mkdirSync(outDir, { recursive: true });
+}
+
+for (const room of ranked.slice(0, roomLimit)) {
+  const max = room.counts.reduce((a, b) => Math.max(a, b), 0);
+  console.log(`\n${room.name}: ${room.total} ${kindFilter} events, hottest tile ${max}`);
+  // Screeps draws y downwards, so each output line is one y across all x
+  for (let y = 0; y < 50; y++) {
+    let line = '';
+    for (let x = 0; x < 50; x++) {
+      const count = room.counts[x * 50 + y];
+      line += count === 0 ? ' ' : SHADES[Math.min(SHADES.length - 1, 1 + Math.floor((SHADES.length - 2) * Math.sqrt(count / max)))];
+    }
+    console.log(`  |${line}|`);
+  }
+  if (outDir) {
+    writePgm(path.join(outDir, `${room.name}-${kindFilter}.pgm`), room.counts, max);
+  }
+}
@@ -0,0 +1,206 @@
+#include "search_queue.h"
+#include <algorithm>
+
+using namespace screeps;
+
+namespace {
+	// Cancellation flag of the search running on this worker; read by the kernel's abort hook
+	thread_local const std::atomic<bool>* current_cancel_flag = nullptr;
+
+	bool current_search_cancelled() {
+		return current_cancel_flag->load(std::memory_order_relaxed);
+	}
+
+	size_t ring_size_for(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		return size;
+	}
+}
+
+	completion_ring_t::completion_ring_t(size_t capacity) :
+		cells(new cell_t[ring_size_for(std::max<size_t>(capacity, 1))]),
+		mask(ring_size_for(std::max<size_t>(capacity, 1)) - 1) {
+		for (size_t ii = 0; ii <= mask; ++ii) {
+			cells[ii].sequence.store(ii, std::memory_order_relaxed);
+		}
+	}
+
+	bool completion_ring_t::push(uint32_t value) {
+		size_t position = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			cell_t& cell = cells[position & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if (difference == 0) {
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.value = value;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				return false;
+			} else {
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool completion_ring_t::pop(uint32_t& value) {
+		cell_t& cell = cells[head & mask];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		if (sequence != head + 1) {
+			return false;
+		}
+		value = cell.value;
+		cell.sequence.store(head + mask + 1, std::memory_order_release);
+		++head;
+		return true;
+	}
+
+	search_queue_t::search_queue_t(world_t& world, size_t worker_count, size_t capacity) :
+		world(world),
+		slots(std::max<size_t>(capacity, 1)),
+		completions(std::max<size_t>(capacity, 1)) {
+		free_slots.reserve(slots.size());
+		for (size_t ii = slots.size(); ii > 0; --ii) {
+			free_slots.push_back(static_cast<uint32_t>(ii - 1));
+		}
+		worker_count = std::max<size_t>(worker_count, 1);
+		workers.reserve(worker_count);
+		for (size_t ii = 0; ii < worker_count; ++ii) {
+			workers.emplace_back(&search_queue_t::worker_main, this);
+		}
+	}
+
+	search_queue_t::~search_queue_t() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+			for (auto& queue : pending) {
+				queue.clear();
+			}
+			for (auto& slot : slots) {
+				slot.cancel_requested.store(true, std::memory_order_relaxed);
+			}
+		}
+		work_available.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	search_ticket_t search_queue_t::submit(
+		world_position_t origin,
+		const goal_t* goals,
+		size_t goal_count,
+		const search_options_native& options,
+		search_priority priority
+	) {
+		search_ticket_t ticket;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (free_slots.empty() || stopping) {
+				return 0;
+			}
+			uint32_t slot_index = free_slots.back();
+			free_slots.pop_back();
+
+			slot_t& slot = slots[slot_index];
+			// Generations stay below 2^31 so tickets survive a round trip through a signed 64-bit handle
+			slot.generation = slot.generation >= 0x7fffffff ? 1 : slot.generation + 1;
+			slot.state = slot_state::Queued;
+			slot.cancel_requested.store(false, std::memory_order_relaxed);
+			slot.origin = origin;
+			slot.goals.assign(goals, goals + goal_count);
+			slot.options = options;
+			pending[static_cast<size_t>(priority)].push_back(slot_index);
+			in_flight_count.fetch_add(1, std::memory_order_release);
+			ticket = (search_ticket_t(slot.generation) << 32) | slot_index;
+		}
+		work_available.notify_one();
+		return ticket;
+	}
+
+	bool search_queue_t::cancel(search_ticket_t ticket) {
+		uint32_t slot_index = static_cast<uint32_t>(ticket);
+		uint32_t generation = static_cast<uint32_t>(ticket >> 32);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (slot_index >= slots.size()) {
+			return false;
+		}
+		slot_t& slot = slots[slot_index];
+		if (slot.generation != generation || (slot.state != slot_state::Queued && slot.state != slot_state::Running)) {
+			return false;
+		}
+		slot.cancel_requested.store(true, std::memory_order_relaxed);
+		return true;
+	}
+
+	void search_queue_t::release(uint32_t slot_index) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slots[slot_index].state = slot_state::Free;
+			free_slots.push_back(slot_index);
+		}
+		in_flight_count.fetch_sub(1, std::memory_order_release);
+	}
+
+	void search_queue_t::complete(uint32_t slot_index) {
+		// The ring has a cell for every slot and a slot is only reused after its cell was popped, so the
+		// ring cannot be full here
+		completions.push(slot_index);
+		// The push is a release store and must not be reordered after the load of poll_waiters: without
+		// the fence a poller that registered and then saw the ring empty could be skipped here
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (poll_waiters.load(std::memory_order_seq_cst) != 0) {
+			std::lock_guard<std::mutex> lock(completion_mutex);
+			completion_available.notify_one();
+		}
+	}
+
+	void search_queue_t::worker_main() {
+		// path_finder_t carries large lookup tables; keep it off the worker's stack
+		auto pathfinder = std::make_unique<path_finder_t>(world);
+		for (;;) {
+			uint32_t slot_index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				work_available.wait(lock, [&]() {
+					return stopping || std::any_of(std::begin(pending), std::end(pending), [](const std::deque<uint32_t>& queue) {
+						return !queue.empty();
+					});
+				});
+				if (stopping) {
+					return;
+				}
+				auto queue = std::find_if(std::begin(pending), std::end(pending), [](const std::deque<uint32_t>& queue) {
+					return !queue.empty();
+				});
+				slot_index = queue->front();
+				queue->pop_front();
+				slots[slot_index].state = slot_state::Running;
+			}
+
+			slot_t& slot = slots[slot_index];
+			if (slot.cancel_requested.load(std::memory_order_relaxed)) {
+				slot.result.path.clear();
+				slot.result.operations = 0;
+				slot.result.cost = 0;
+				slot.result.incomplete = true;
+				slot.status = slot.result.status = search_status::Interrupted;
+			} else {
+				search_request_native request{slot.origin, slot.goals.data(), slot.goals.size(), slot.options};
+				current_cancel_flag = &slot.cancel_requested;
+				slot.status = pathfinder->search_native(request, slot.result, current_search_cancelled);
+				current_cancel_flag = nullptr;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				slot.state = slot_state::Done;
+			}
+			complete(slot_index);
+		}
+	}
@@ -0,0 +1,167 @@
+#pragma once
+#include "pf.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace screeps {
+
+	// Nonzero handle for a submitted search: slot generation in the high word, slot index in the low word
+	using search_ticket_t = uint64_t;
+
+	enum class search_priority : uint8_t {
+		High,
+		Normal,
+		Low
+	};
+	constexpr size_t k_search_priority_count = 3;
+
+	//
+	// Bounded multi-producer, single-consumer ring of slot indices. Producers claim a cell with a CAS on
+	// the tail and publish it through the cell's sequence number, so workers never block each other or
+	// the thread draining completions.
+	class completion_ring_t {
+		private:
+			struct cell_t {
+				std::atomic<size_t> sequence;
+				uint32_t value;
+			};
+			std::unique_ptr<cell_t[]> cells;
+			size_t mask;
+			alignas(64) std::atomic<size_t> tail{0};
+			alignas(64) size_t head = 0;
+
+		public:
+			// `capacity` is rounded up to a power of two
+			explicit completion_ring_t(size_t capacity);
+
+			// Returns false when the ring is full
+			bool push(uint32_t value);
+
+			// Consumer side; only one thread may pop at a time
+			bool pop(uint32_t& value);
+	};
+
+	//
+	// Runs search_native on a pool of worker threads, each with its own path_finder_t bound to the
+	// queue's world. Pending searches are served highest priority first, in submission order within a
+	// priority. Finished searches land in a completion_ring_t which the owner drains with poll().
+	//
+	// The world's terrain must not be reloaded while searches are in flight, and its native room
+	// callback is invoked concurrently from every worker.
+	class search_queue_t {
+		public:
+			search_queue_t(world_t& world, size_t worker_count, size_t capacity);
+			~search_queue_t();
+
+			search_queue_t(const search_queue_t&) = delete;
+			search_queue_t& operator=(const search_queue_t&) = delete;
+
+			// Returns 0 when `capacity` searches are already in flight
+			search_ticket_t submit(
+				world_position_t origin,
+				const goal_t* goals,
+				size_t goal_count,
+				const search_options_native& options,
+				search_priority priority);
+
+			// Pending searches are dropped before they start and running ones are interrupted; either way the
+			// ticket still completes, flagged as cancelled. Returns false for unknown or already finished tickets.
+			bool cancel(search_ticket_t ticket);
+
+			// Hands up to `max_count` finished tickets to `visit(ticket, cancelled, status, result)`, waiting
+			// up to `timeout` for the first one. `result` stays owned by the queue and is only valid during
+			// the call, which lets each slot keep its path capacity. Only one thread may poll at a time.
+			template <class visit_t>
+			size_t poll(size_t max_count, std::chrono::milliseconds timeout, visit_t&& visit) {
+				size_t count = drain(max_count, visit);
+				if (count == 0 && max_count > 0 && timeout.count() > 0) {
+					// Workers fence between publishing a completion and reading poll_waiters, and only signal while
+					// holding completion_mutex: either they see this waiter, or the drain below sees their cell
+					std::unique_lock<std::mutex> lock(completion_mutex);
+					poll_waiters.fetch_add(1, std::memory_order_seq_cst);
+					auto deadline = std::chrono::steady_clock::now() + timeout;
+					count = drain(max_count, visit);
+					while (count == 0 && completion_available.wait_until(lock, deadline) != std::cv_status::timeout) {
+						count = drain(max_count, visit);
+					}
+					poll_waiters.fetch_sub(1, std::memory_order_relaxed);
+					if (count == 0) {
+						count = drain(max_count, visit);
+					}
+				}
+				return count;
+			}
+
+			// Submitted tickets that have not been returned by poll() yet
+			size_t in_flight() const {
+				return in_flight_count.load(std::memory_order_acquire);
+			}
+
+			size_t worker_count() const {
+				return workers.size();
+			}
+
+		private:
+			enum class slot_state : uint8_t {
+				Free,
+				Queued,
+				Running,
+				Done
+			};
+
+			struct slot_t {
+				uint32_t generation = 0;
+				slot_state state = slot_state::Free;
+				std::atomic<bool> cancel_requested{false};
+				world_position_t origin;
+				std::vector<goal_t> goals;
+				search_options_native options;
+				search_status status = search_status::Error;
+				search_result_native result;
+			};
+
+			world_t& world;
+			std::vector<slot_t> slots;
+			std::vector<uint32_t> free_slots;
+			std::deque<uint32_t> pending[k_search_priority_count];
+			std::mutex mutex;
+			std::condition_variable work_available;
+			bool stopping = false;
+
+			completion_ring_t completions;
+			std::atomic<size_t> in_flight_count{0};
+			std::atomic<uint32_t> poll_waiters{0};
+			std::mutex completion_mutex;
+			std::condition_variable completion_available;
+
+			std::vector<std::thread> workers;
+
+			void worker_main();
+			void complete(uint32_t slot_index);
+			void release(uint32_t slot_index);
+
+			template <class visit_t>
+			size_t drain(size_t max_count, visit_t& visit) {
+				size_t count = 0;
+				uint32_t slot_index;
+				while (count < max_count && completions.pop(slot_index)) {
+					const slot_t& slot = slots[slot_index];
+					visit(
+						(search_ticket_t(slot.generation) << 32) | slot_index,
+						slot.cancel_requested.load(std::memory_order_relaxed),
+						slot.status,
+						static_cast<const search_result_native&>(slot.result));
+					release(slot_index);
+					++count;
+				}
+				return count;
+			}
+	};
+}
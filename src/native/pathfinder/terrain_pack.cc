@@ -0,0 +1,138 @@
+#include "terrain_pack.h"
+#include <cstring>
+
+using namespace screeps;
+
+namespace {
+	constexpr unsigned k_size = 50;
+	constexpr unsigned k_padded = 56; // 7 blocks of 8
+	constexpr uint64_t k_low_bits = 0x0303030303030303ull;
+
+	uint64_t load64(const uint8_t* source) {
+		uint64_t value;
+		std::memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	void store64(uint8_t* target, uint64_t value) {
+		std::memcpy(target, &value, sizeof(value));
+	}
+
+	// Bit 4 of each byte set when that byte's low nibble is nonzero; adding 15 never carries out
+	uint64_t nonzero_nibbles(uint64_t nibbles) {
+		return (nibbles + 0x0f0f0f0f0f0f0f0full) & 0x1010101010101010ull;
+	}
+
+	// Nonzero when any byte is neither 0-3 nor '0'-'3': bits 2-3 must be clear and the high nibble
+	// must be 0 or 3
+	uint64_t invalid_codes(uint64_t word) {
+		uint64_t high = (word >> 4) & 0x0f0f0f0f0f0f0f0full;
+		return (word & 0x0c0c0c0c0c0c0c0cull) | (nonzero_nibbles(high) & nonzero_nibbles(high ^ 0x0303030303030303ull));
+	}
+
+	// Transposes the 8x8 byte matrix held in rows[] (byte j of row i is element (i, j))
+	void transpose8(uint64_t (&rows)[8]) {
+		for (int ii = 0; ii < 4; ++ii) {
+			uint64_t top = rows[ii];
+			uint64_t bottom = rows[ii + 4];
+			rows[ii] = (top & 0x00000000ffffffffull) | (bottom << 32);
+			rows[ii + 4] = (top >> 32) | (bottom & 0xffffffff00000000ull);
+		}
+		for (int ii = 0; ii < 8; ii += (ii & 1) != 0 ? 3 : 1) { // 0, 1, 4, 5
+			uint64_t top = rows[ii];
+			uint64_t bottom = rows[ii + 2];
+			rows[ii] = (top & 0x0000ffff0000ffffull) | ((bottom & 0x0000ffff0000ffffull) << 16);
+			rows[ii + 2] = ((top >> 16) & 0x0000ffff0000ffffull) | (bottom & 0xffff0000ffff0000ull);
+		}
+		for (int ii = 0; ii < 8; ii += 2) {
+			uint64_t top = rows[ii];
+			uint64_t bottom = rows[ii + 1];
+			rows[ii] = (top & 0x00ff00ff00ff00ffull) | ((bottom & 0x00ff00ff00ff00ffull) << 8);
+			rows[ii + 1] = ((top >> 8) & 0x00ff00ff00ff00ffull) | (bottom & 0xff00ff00ff00ff00ull);
+		}
+	}
+
+	// Folds eight codes (one per byte, 0-3) into two packed bytes, returned in bits 0-15
+	unsigned fold8(uint64_t codes) {
+		uint64_t pairs = codes | (codes >> 6); // byte 0: c0 | c1 << 2, byte 2: c2 | c3 << 2, ...
+		uint64_t quads = pairs | (pairs >> 12); // byte 0: c0-c3, byte 4: c4-c7
+		return static_cast<unsigned>((quads & 0xff) | ((quads >> 24) & 0xff00));
+	}
+}
+
+	bool terrain_packer_t::pack(const uint8_t* data, size_t length, uint8_t* out) {
+		if (length == k_packed_bytes) {
+			std::memcpy(out, data, k_packed_bytes);
+			return true;
+		} else if (length != k_code_bytes) {
+			return false;
+		}
+
+		// Normalized codes, y-major with padding rows so the 8x8 blocks never leave the buffer
+		alignas(8) uint8_t codes[k_padded * k_size + 8] = {};
+		uint64_t invalid = 0;
+		size_t ii = 0;
+		for (; ii + 8 <= k_code_bytes; ii += 8) {
+			uint64_t word = load64(data + ii);
+			invalid |= invalid_codes(word);
+			store64(codes + ii, word & k_low_bits);
+		}
+		for (; ii < k_code_bytes; ++ii) {
+			uint8_t code = data[ii];
+			invalid |= (code & 0x0c) | ((code >> 4) != 0 && (code >> 4) != 3);
+			codes[ii] = code & 3;
+		}
+		if (invalid != 0) {
+			return false;
+		}
+
+		// x-major codes; row x holds y 0-49, and the last block of a row spills into the next one, so
+		// blocks run from the highest y down and each row's start is written last
+		alignas(8) uint8_t columns[k_padded * k_size + 8];
+		for (unsigned bx = 0; bx < k_padded; bx += 8) {
+			for (unsigned by = k_padded - 8;; by -= 8) {
+				uint64_t rows[8];
+				for (unsigned kk = 0; kk < 8; ++kk) {
+					rows[kk] = load64(codes + (by + kk) * k_size + bx);
+				}
+				transpose8(rows);
+				for (unsigned kk = 0; kk < 8; ++kk) {
+					store64(columns + (bx + kk) * k_size + by, rows[kk]);
+				}
+				if (by == 0) {
+					break;
+				}
+			}
+		}
+
+		for (ii = 0; ii + 8 <= k_code_bytes; ii += 8) {
+			unsigned packed = fold8(load64(columns + ii));
+			out[ii / 4] = static_cast<uint8_t>(packed);
+			out[ii / 4 + 1] = static_cast<uint8_t>(packed >> 8);
+		}
+		for (; ii < k_code_bytes; ii += 4) {
+			out[ii / 4] = static_cast<uint8_t>(columns[ii] | columns[ii + 1] << 2 | columns[ii + 2] << 4 | columns[ii + 3] << 6);
+		}
+		return true;
+	}
+
+	bool terrain_packer_t::pack_reference(const uint8_t* data, size_t length, uint8_t* out) {
+		if (length == k_packed_bytes) {
+			std::memcpy(out, data, k_packed_bytes);
+			return true;
+		} else if (length != k_code_bytes) {
+			return false;
+		}
+		std::memset(out, 0, k_packed_bytes);
+		for (unsigned xx = 0; xx < k_size; ++xx) {
+			for (unsigned yy = 0; yy < k_size; ++yy) {
+				uint8_t code = data[yy * k_size + xx];
+				if (code > 3 && (code < '0' || code > '3')) {
+					return false;
+				}
+				unsigned tile = xx * k_size + yy;
+				out[tile / 4] |= (code & 3) << (tile % 4 * 2);
+			}
+		}
+		return true;
+	}
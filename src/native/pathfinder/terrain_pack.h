@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace screeps {
+
+	//
+	// Converts raw Screeps terrain into the packed layout rooms are stored in: 2 bits per tile
+	// (1 = wall, 2 = swamp), tile x * 50 + y, four tiles per byte starting at the low bits.
+	//
+	// The game's own format lists tiles y-major (terrain[y * 50 + x]), so codes are normalized and
+	// validated 8 bytes per word, transposed in 8x8 blocks with 64-bit shuffles, then folded four
+	// codes to a byte. Everything stays in two 3 KB stack buffers.
+	class terrain_packer_t {
+		public:
+			static constexpr size_t k_packed_bytes = 625;
+			static constexpr size_t k_code_bytes = 2500;
+
+			// `length` picks the format: k_packed_bytes is already packed and copied as is, k_code_bytes
+			// is the y-major tile list as codes 0-3 or digits '0'-'3'. Returns false for any other length
+			// or an invalid code; `out` is then left unspecified.
+			static bool pack(const uint8_t* data, size_t length, uint8_t* out);
+
+			// Tile-by-tile version of pack(), for tests and benchmarks
+			static bool pack_reference(const uint8_t* data, size_t length, uint8_t* out);
+	};
+}
@@ -0,0 +1,78 @@
+#include "terrain_query.h"
+
+using namespace screeps;
+
+namespace {
+	// Terrain and matrix of the room a run of tiles falls in, looked up again only when the room changes
+	struct room_cursor_t {
+		const world_t& world;
+		const cost_matrix_registry_t* matrices;
+		map_position_t room{0, 0};
+		const uint8_t* terrain = nullptr;
+		const uint8_t* matrix = nullptr;
+		bool valid = false;
+
+		// Local index of `tile`, after moving to its room
+		unsigned seek(uint32_t tile) {
+			world_position_t pos(tile & 0xffff, tile >> 16);
+			map_position_t next = pos.map_position();
+			if (!valid || next.id != room.id) {
+				room = next;
+				terrain = world.room_terrain(room);
+				matrix = matrices == nullptr ? nullptr : matrices->get(room);
+				valid = true;
+			}
+			return (pos.xx % 50) * 50 + pos.yy % 50;
+		}
+	};
+}
+
+	void terrain_query_t::terrain_at(const world_t& world, const uint32_t* tiles, size_t count, uint8_t* out) {
+		room_cursor_t cursor{world, nullptr};
+		for (size_t ii = 0; ii < count; ++ii) {
+			unsigned index = cursor.seek(tiles[ii]);
+			out[ii] = cursor.terrain == nullptr ? k_no_terrain : (cursor.terrain[index / 4] >> (index % 4 * 2)) & 0x03;
+		}
+	}
+
+	void terrain_query_t::move_costs(
+		const world_t& world,
+		const uint32_t* tiles,
+		size_t count,
+		const cost_matrix_registry_t* matrices,
+		uint8_t plain_cost,
+		uint8_t swamp_cost,
+		uint8_t* out
+	) {
+		const uint8_t code_costs[4] = {plain_cost, k_impassable, swamp_cost, k_impassable};
+		room_cursor_t cursor{world, matrices};
+		for (size_t ii = 0; ii < count; ++ii) {
+			unsigned index = cursor.seek(tiles[ii]);
+			if (cursor.terrain == nullptr) {
+				out[ii] = k_impassable;
+			} else if (cursor.matrix != nullptr && cursor.matrix[index] != 0) {
+				out[ii] = cursor.matrix[index];
+			} else {
+				out[ii] = code_costs[(cursor.terrain[index / 4] >> (index % 4 * 2)) & 0x03];
+			}
+		}
+	}
+
+	bool terrain_query_t::walkable_mask(
+		const world_t& world,
+		map_position_t room,
+		room_tile_t min,
+		room_tile_t max,
+		const uint8_t* cost_matrix,
+		room_grid_t::row_t* out
+	) {
+		room_grid_t grid;
+		if (!grid.load(world, room, cost_matrix)) {
+			return false;
+		}
+		room_grid_t::row_t mask = (room_grid_t::row_t(1) << (max.yy - min.yy + 1)) - 1;
+		for (unsigned xx = min.xx; xx <= max.xx; ++xx) {
+			out[xx - min.xx] = (grid.row(xx) >> min.yy) & mask;
+		}
+		return true;
+	}
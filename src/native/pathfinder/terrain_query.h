@@ -0,0 +1,46 @@
+#pragma once
+#include "cost_matrix_registry.h"
+#include "pf.h"
+#include "room_analysis.h"
+#include <cstdint>
+
+namespace screeps {
+
+	//
+	// Batched reads of the world's packed terrain, so callers can answer movement checks from the
+	// native store instead of keeping a terrain copy of their own. Tiles are packed world tiles
+	// (x | y << 16); rooms are resolved once per run of tiles in the same room, so batches sorted or
+	// grouped by room are cheapest. Masks come from the 64-bit rows of room_grid_t.
+	class terrain_query_t {
+		public:
+			static constexpr uint8_t k_no_terrain = 255;
+			static constexpr uint8_t k_impassable = 255;
+
+			// Terrain code per tile: 0 plain, 1 wall, 2 swamp, 3 wall on swamp (a wall in the game), and
+			// k_no_terrain in rooms without terrain loaded
+			static void terrain_at(const world_t& world, const uint32_t* tiles, size_t count, uint8_t* out);
+
+			// Cost of stepping onto each tile, as the search prices it: a nonzero registered matrix value
+			// overrides terrain and 255 blocks, walls and rooms without terrain are k_impassable. Overlays
+			// are not applied. `matrices` may be nullptr for terrain alone.
+			static void move_costs(
+				const world_t& world,
+				const uint32_t* tiles,
+				size_t count,
+				const cost_matrix_registry_t* matrices,
+				uint8_t plain_cost,
+				uint8_t swamp_cost,
+				uint8_t* out);
+
+			// Walkable bits of the local rectangle [min_x, max_x] x [min_y, max_y] of `room`: out[x - min_x]
+			// has bit (y - min_y) set when (x, y) is walkable, under `cost_matrix` when it is not nullptr.
+			// Returns false when the room has no terrain loaded.
+			static bool walkable_mask(
+				const world_t& world,
+				map_position_t room,
+				room_tile_t min,
+				room_tile_t max,
+				const uint8_t* cost_matrix,
+				room_grid_t::row_t* out);
+	};
+}
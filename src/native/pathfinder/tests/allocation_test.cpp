@@ -0,0 +1,235 @@
+// Proves that once the arenas are warm, searches make no heap allocations: the same tick of requests
+// is replayed through the synchronous (plain and room-routed) and the asynchronous C ABI while every
+// operator new is counted.
+#include "pathfinder_exports.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	std::atomic<bool> counting{false};
+	std::atomic<uint64_t> allocations{0};
+
+	void* counted_allocate(size_t size) {
+		if (counting.load(std::memory_order_relaxed)) {
+			allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		void* pointer = std::malloc(size == 0 ? 1 : size);
+		if (pointer == nullptr) {
+			throw std::bad_alloc();
+		}
+		return pointer;
+	}
+}
+
+void* operator new(size_t size) {
+	return counted_allocate(size);
+}
+
+void* operator new[](size_t size) {
+	return counted_allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace {
+	constexpr int k_world_size = 6;
+
+	std::string room_name(int rx, int ry) {
+		return "W" + std::to_string(rx) + "N" + std::to_string(ry);
+	}
+
+	std::vector<uint8_t> cost_matrix(2500, 0);
+
+	// Every third room carries a cost matrix and one room is blocked, so both callback paths run
+	bool room_callback(uint8_t room_x, uint8_t room_y, const uint8_t** matrix, int* length, bool* block, void*) {
+		int rx = 127 - room_x;
+		int ry = 127 - room_y;
+		*matrix = nullptr;
+		*length = 0;
+		*block = rx == 2 && ry == 3;
+		if ((rx + ry) % 3 == 0) {
+			*matrix = cost_matrix.data();
+			*length = 2500;
+		}
+		return true;
+	}
+
+	struct request_t {
+		ScreepsPathfinderPoint origin;
+		std::vector<ScreepsPathfinderGoal> goals;
+		ScreepsPathfinderOptionsNative options;
+	};
+
+	std::vector<std::string> goal_rooms;
+
+	std::vector<request_t> make_tick(std::mt19937& rng) {
+		std::vector<request_t> requests;
+		goal_rooms.reserve(256);
+		for (int ii = 0; ii < 64; ++ii) {
+			request_t request{};
+			int rx = rng() % k_world_size;
+			int ry = rng() % k_world_size;
+			request.origin.x = 2 + rng() % 46;
+			request.origin.y = 2 + rng() % 46;
+			std::snprintf(request.origin.roomName, sizeof(request.origin.roomName), "%s", room_name(rx, ry).c_str());
+			int goal_count = 1 + ii % 3;
+			for (int gg = 0; gg < goal_count; ++gg) {
+				goal_rooms.push_back(room_name(std::min(k_world_size - 1, rx + static_cast<int>(rng() % 2)), std::min(k_world_size - 1, ry + static_cast<int>(rng() % 2))));
+				request.goals.push_back(ScreepsPathfinderGoal{static_cast<int>(2 + rng() % 46), static_cast<int>(2 + rng() % 46), nullptr, static_cast<int>(rng() % 3)});
+			}
+			request.options.plainCost = 1;
+			request.options.swampCost = 5;
+			request.options.maxRooms = 16;
+			request.options.maxOps = 20000;
+			request.options.flee = ii % 8 == 7;
+			request.options.heuristicWeight = ii % 5 == 0 ? 1.0 : 1.2;
+			requests.push_back(request);
+		}
+		size_t next_room = 0;
+		for (auto& request : requests) {
+			for (auto& goal : request.goals) {
+				goal.roomName = goal_rooms[next_room++].c_str();
+			}
+		}
+		return requests;
+	}
+
+	bool run_sync_tick(std::vector<request_t>& requests) {
+		ScreepsPathfinder_AdvanceEpoch(nullptr);
+		// Every other search is restricted to its room route, with one room of margin
+		ScreepsRouteOptionsNative route_options{nullptr, 0, 1, 0, 1};
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			request_t& request = requests[ii];
+			ScreepsPathfinderResultNative result{};
+			int code = ii % 2 == 0
+				? ScreepsPathfinder_Search(nullptr, &request.origin, request.goals.data(), static_cast<int>(request.goals.size()), &request.options, &result)
+				: ScreepsPathfinder_SearchRouted(nullptr, &request.origin, request.goals.data(), static_cast<int>(request.goals.size()), &request.options, &route_options, &result);
+			// -2: the origin lies in the blocked room
+			if (code != 0 && code != -2) {
+				std::fprintf(stderr, "Search failed with %d\n", code);
+				return false;
+			}
+			ScreepsPathfinder_FreeResult(nullptr, &result);
+		}
+		return true;
+	}
+
+	bool run_async_tick(std::vector<request_t>& requests, std::vector<ScreepsPathfinderCompletionNative>& completions) {
+		ScreepsPathfinder_AdvanceEpoch(nullptr);
+		for (auto& request : requests) {
+			if (ScreepsPathfinder_Submit(nullptr, &request.origin, request.goals.data(), static_cast<int>(request.goals.size()), &request.options, 1) <= 0) {
+				std::fprintf(stderr, "Submit failed\n");
+				return false;
+			}
+		}
+		size_t received = 0;
+		while (received < requests.size()) {
+			int count = ScreepsPathfinder_PollCompletions(nullptr, completions.data(), static_cast<int>(completions.size()), 1000);
+			if (count <= 0) {
+				std::fprintf(stderr, "PollCompletions failed with %d\n", count);
+				return false;
+			}
+			for (int ii = 0; ii < count; ++ii) {
+				if (completions[ii].status != 0 && completions[ii].status != -2) {
+					std::fprintf(stderr, "async search failed with %d\n", completions[ii].status);
+					return false;
+				}
+				ScreepsPathfinder_FreeResult(nullptr, &completions[ii].result);
+			}
+			received += static_cast<size_t>(count);
+		}
+		return true;
+	}
+}
+
+int main() {
+	std::mt19937 rng(7);
+	std::vector<std::vector<uint8_t>> terrain;
+	std::vector<std::string> names;
+	for (int rx = 0; rx < k_world_size; ++rx) {
+		for (int ry = 0; ry < k_world_size; ++ry) {
+			std::vector<uint8_t> bits(625, 0);
+			for (int ii = 0; ii < 2500; ++ii) {
+				int xx = ii / 50;
+				int yy = ii % 50;
+				int roll = rng() % 100;
+				uint8_t code = roll < 10 ? 1 : (roll < 20 ? 2 : 0);
+				// WxNy rooms grow westwards and northwards, so W0N0 is the south-east corner of the world
+				bool world_edge = (rx == 0 && xx == 49) || (ry == 0 && yy == 49) || (rx == k_world_size - 1 && xx == 0) || (ry == k_world_size - 1 && yy == 0);
+				if (world_edge || ((xx == 0 || yy == 0 || xx == 49 || yy == 49) && (xx + yy) % 9 < 3)) {
+					code = 1;
+				}
+				bits[ii / 4] |= code << (ii % 4 * 2);
+			}
+			terrain.push_back(std::move(bits));
+			names.push_back(room_name(rx, ry));
+		}
+	}
+	std::vector<ScreepsTerrainRoom> rooms;
+	for (size_t ii = 0; ii < terrain.size(); ++ii) {
+		rooms.push_back(ScreepsTerrainRoom{names[ii].c_str(), terrain[ii].data(), static_cast<int>(terrain[ii].size())});
+	}
+	if (ScreepsPathfinder_LoadTerrain(nullptr, rooms.data(), static_cast<int>(rooms.size())) != 0) {
+		std::fprintf(stderr, "LoadTerrain failed\n");
+		return 1;
+	}
+	for (int ii = 0; ii < 2500; ++ii) {
+		// A road row across the room interior; matrix costs override terrain, so the sealed edges stay 0
+		int xx = ii / 50;
+		cost_matrix[ii] = xx == 0 || xx == 49 ? 0 : (ii % 50 == 25 ? 1 : (ii % 97 == 0 ? 255 : 0));
+	}
+	ScreepsPathfinder_SetRoomCallback(nullptr, room_callback, nullptr);
+
+	std::vector<request_t> requests = make_tick(rng);
+	std::vector<ScreepsPathfinderCompletionNative> completions(requests.size());
+	// A single worker keeps the async warm-up deterministic: it sees every request before counting starts
+	if (ScreepsPathfinder_StartWorkers(nullptr, 1, static_cast<int>(requests.size())) != 0) {
+		std::fprintf(stderr, "StartWorkers failed\n");
+		return 1;
+	}
+
+	// Queue slots are handed out in a different order each tick, so give every slot time to grow its goal
+	// and path buffers to the largest request it will see
+	for (int warmup = 0; warmup < 8; ++warmup) {
+		if (!run_sync_tick(requests) || !run_async_tick(requests, completions)) {
+			return 1;
+		}
+	}
+
+	int failures = 0;
+	counting = true;
+	bool ok = run_sync_tick(requests);
+	counting = false;
+	uint64_t sync_allocations = allocations.exchange(0);
+	std::printf("sync:  %zu searches, %llu heap allocations\n", requests.size(), static_cast<unsigned long long>(sync_allocations));
+	failures += !ok || sync_allocations != 0;
+
+	counting = true;
+	ok = run_async_tick(requests, completions);
+	counting = false;
+	uint64_t async_allocations = allocations.exchange(0);
+	std::printf("async: %zu searches, %llu heap allocations\n", requests.size(), static_cast<unsigned long long>(async_allocations));
+	failures += !ok || async_allocations != 0;
+
+	ScreepsPathfinder_StopWorkers(nullptr);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Adaptive A* under a room cap: searches to a few goals with maxRooms 3, 4 and 6 run once cold and then
+// for several rounds that read and feed the learned tables. Which rooms a search gets under the cap
+// depends on where it started and on how it expands, so neither the tables nor the tile by tile
+// expansion of feeding searches may cost a later search anything: a learned round must reach every goal
+// the cold round reached, at no greater cost.
+//
+// The world is a 4x4 block of rooms, W3N3 to W0N0, whose room edges are walled apart from isolated exits.
+#include "pathfinder_exports.h"
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr int k_rooms = 4;
+	// World room coordinate of the first room; rooms are W3N3 (124, 124) to W0N0 (127, 127)
+	constexpr int k_first_room = 124;
+	constexpr int k_tiles = k_rooms * 50;
+
+	int failures = 0;
+
+	std::vector<bool> walls(k_tiles * k_tiles, true);
+
+	bool is_wall(int xx, int yy) {
+		return walls[xx * k_tiles + yy];
+	}
+
+	std::string room_name(int rx, int ry) {
+		return "W" + std::to_string(127 - (k_first_room + rx)) + "N" + std::to_string(127 - (k_first_room + ry));
+	}
+
+	void to_point(int xx, int yy, ScreepsPathfinderPoint& point) {
+		point.x = xx % 50;
+		point.y = yy % 50;
+		std::snprintf(point.roomName, sizeof(point.roomName), "%s", room_name(xx / 50, yy / 50).c_str());
+	}
+
+	void generate_terrain(std::mt19937& rng) {
+		for (int xx = 0; xx < k_tiles; ++xx) {
+			for (int yy = 0; yy < k_tiles; ++yy) {
+				int lx = xx % 50;
+				int ly = yy % 50;
+				bool wall = rng() % 100 < 20;
+				if (lx == 0 || ly == 0 || lx == 49 || ly == 49) {
+					// Isolated exits, lined up with the neighbouring room's
+					int along = lx == 0 || lx == 49 ? ly : lx;
+					bool world_edge = xx == 0 || yy == 0 || xx == k_tiles - 1 || yy == k_tiles - 1;
+					wall = world_edge || along % 8 != 4;
+				}
+				walls[xx * k_tiles + yy] = wall;
+			}
+		}
+	}
+
+	bool load_world(ScreepsWorld* world) {
+		std::vector<std::vector<uint8_t>> bits;
+		std::vector<std::string> names;
+		for (int rx = 0; rx < k_rooms; ++rx) {
+			for (int ry = 0; ry < k_rooms; ++ry) {
+				std::vector<uint8_t> room(625, 0);
+				for (int ii = 0; ii < 2500; ++ii) {
+					if (walls[(rx * 50 + ii / 50) * k_tiles + ry * 50 + ii % 50]) {
+						room[ii / 4] |= 1 << (ii % 4 * 2);
+					}
+				}
+				bits.push_back(std::move(room));
+				names.push_back(room_name(rx, ry));
+			}
+		}
+		std::vector<ScreepsTerrainRoom> rooms;
+		for (size_t ii = 0; ii < bits.size(); ++ii) {
+			rooms.push_back(ScreepsTerrainRoom{names[ii].c_str(), bits[ii].data(), static_cast<int>(bits[ii].size())});
+		}
+		return ScreepsPathfinder_LoadTerrain(world, rooms.data(), static_cast<int>(rooms.size())) == 0;
+	}
+
+	void random_open_tile(std::mt19937& rng, int rx, int ry, int& xx, int& yy) {
+		do {
+			xx = rx * 50 + 1 + static_cast<int>(rng() % 48);
+			yy = ry * 50 + 1 + static_cast<int>(rng() % 48);
+		} while (is_wall(xx, yy));
+	}
+
+	struct request_t {
+		ScreepsPathfinderPoint origin;
+		ScreepsPathfinderPoint target;
+		int max_rooms;
+	};
+
+	// Cost of the search, or max() when it is incomplete
+	int search(ScreepsWorld* world, const request_t& request) {
+		ScreepsPathfinderGoal goal{request.target.x, request.target.y, request.target.roomName, 1};
+		ScreepsPathfinderOptionsNative options{};
+		options.maxRooms = request.max_rooms;
+		options.maxOps = 1000000;
+		options.maxCost = std::numeric_limits<int>::max();
+		options.plainCost = 1;
+		options.swampCost = 5;
+		options.heuristicWeight = 1.0;
+		options.skipRoomCallback = true;
+		options.learnHeuristic = true;
+		ScreepsPathfinderResultNative result{};
+		if (ScreepsPathfinder_Search(world, &request.origin, &goal, 1, &options, &result) != 0) {
+			std::fprintf(stderr, "FAILED: search from %d,%d %s\n", request.origin.x, request.origin.y, request.origin.roomName);
+			++failures;
+			return std::numeric_limits<int>::max();
+		}
+		int cost = result.incomplete ? std::numeric_limits<int>::max() : result.cost;
+		ScreepsPathfinder_FreeResult(world, &result);
+		return cost;
+	}
+}
+
+int main() {
+	std::mt19937 rng(50);
+	generate_terrain(rng);
+	ScreepsWorld* world = ScreepsPathfinder_CreateWorld();
+	if (world == nullptr || !load_world(world)) {
+		std::fprintf(stderr, "could not load the test world\n");
+		return 1;
+	}
+
+	// A few goals in the middle of the block, each sought from every room at each room cap
+	const int goal_rooms[][2] = {{1, 1}, {2, 2}, {1, 2}};
+	const int room_caps[] = {3, 4, 6};
+	std::vector<request_t> requests;
+	for (const auto& room : goal_rooms) {
+		int gx = 0;
+		int gy = 0;
+		random_open_tile(rng, room[0], room[1], gx, gy);
+		for (int max_rooms : room_caps) {
+			for (int rx = 0; rx < k_rooms; ++rx) {
+				for (int ry = 0; ry < k_rooms; ++ry) {
+					for (int repeat = 0; repeat < 2; ++repeat) {
+						int ox = 0;
+						int oy = 0;
+						random_open_tile(rng, rx, ry, ox, oy);
+						request_t request{};
+						to_point(ox, oy, request.origin);
+						to_point(gx, gy, request.target);
+						request.max_rooms = max_rooms;
+						requests.push_back(request);
+					}
+				}
+			}
+		}
+	}
+
+	// Round 0 searches without tables; every later round reads and feeds what the ones before learned
+	std::vector<int> cold;
+	int costlier = 0;
+	int lost = 0;
+	for (int round = 0; round < 4; ++round) {
+		if (ScreepsPathfinder_SetLearnedHeuristics(world, round == 0 ? 0 : 4096) != 0) {
+			std::fprintf(stderr, "FAILED: set learned heuristics for round %d\n", round);
+			++failures;
+		}
+		for (size_t ii = 0; ii < requests.size(); ++ii) {
+			int cost = search(world, requests[ii]);
+			if (round == 0) {
+				cold.push_back(cost);
+			} else if (cost > cold[ii]) {
+				const request_t& request = requests[ii];
+				std::fprintf(stderr, "FAILED: round %d, maxRooms %d, %d,%d %s to %d,%d %s: %s (cold %d)\n",
+					round, request.max_rooms, request.origin.x, request.origin.y, request.origin.roomName,
+					request.target.x, request.target.y, request.target.roomName,
+					cost == std::numeric_limits<int>::max() ? "incomplete" : std::to_string(cost).c_str(), cold[ii]);
+				++failures;
+				++(cost == std::numeric_limits<int>::max() ? lost : costlier);
+			}
+		}
+	}
+	if (ScreepsPathfinder_LearnedHeuristicGrids(world) == 0) {
+		std::fprintf(stderr, "FAILED: no tables were learned\n");
+		++failures;
+	}
+
+	ScreepsPathfinder_DestroyWorld(world);
+	std::printf("learned heuristic: %zu searches per round, %d costlier and %d incomplete after learning, %d failures\n",
+		requests.size(), costlier, lost, failures);
+	return failures == 0 ? 0 : 1;
+}
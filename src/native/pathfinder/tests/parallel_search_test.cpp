@@ -0,0 +1,248 @@
+// Checks hash-distributed parallel searches (options.parallelThreads > 1) through the C ABI against the
+// sequential search and an exact Dijkstra over the same move rules. Every parallel path must lead back to
+// the origin one walkable step at a time, cost what it reports, reach the goal whenever the sequential
+// search does, and stay within the heuristic weight of the optimum.
+//
+// Terrain is walls and plains only, and room edges are walled apart from isolated exit tiles. Jump point
+// search is exact on such terrain, so at weight 1 the sequential cost is the optimum as well.
+#include "pathfinder_exports.h"
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr int k_rooms = 3;
+	// World room coordinate of the first room; rooms are W2N2 (125, 125) to W0N0 (127, 127)
+	constexpr int k_first_room = 125;
+	constexpr int k_tiles = k_rooms * 50;
+	constexpr int k_unreached = std::numeric_limits<int>::max();
+
+	int failures = 0;
+
+	void check(bool condition, const char* what, int request) {
+		if (!condition) {
+			std::fprintf(stderr, "FAILED: %s (request %d)\n", what, request);
+			++failures;
+		}
+	}
+
+	// Terrain of the whole block, indexed by block-local tile coordinates
+	std::vector<bool> walls(k_tiles * k_tiles, true);
+
+	bool is_wall(int xx, int yy) {
+		return xx < 0 || yy < 0 || xx >= k_tiles || yy >= k_tiles || walls[xx * k_tiles + yy];
+	}
+
+	std::string room_name(int rx, int ry) {
+		return "W" + std::to_string(127 - (k_first_room + rx)) + "N" + std::to_string(127 - (k_first_room + ry));
+	}
+
+	void to_point(int xx, int yy, ScreepsPathfinderPoint& point) {
+		point.x = xx % 50;
+		point.y = yy % 50;
+		std::snprintf(point.roomName, sizeof(point.roomName), "%s", room_name(xx / 50, yy / 50).c_str());
+	}
+
+	bool from_point(const ScreepsPathfinderPoint& point, int& xx, int& yy) {
+		int west = 0;
+		int north = 0;
+		if (std::sscanf(point.roomName, "W%dN%d", &west, &north) != 2) {
+			return false;
+		}
+		xx = (127 - west - k_first_room) * 50 + point.x;
+		yy = (127 - north - k_first_room) * 50 + point.y;
+		return xx >= 0 && yy >= 0 && xx < k_tiles && yy < k_tiles;
+	}
+
+	// The move rules of path_finder_t::astar: a tile on a room edge cannot move along that edge, and
+	// only leaves the room straight across it
+	bool can_move(int xx, int yy, int nx, int ny) {
+		if (xx % 50 == 0) {
+			return nx % 50 == 49 ? yy == ny : xx != nx;
+		} else if (xx % 50 == 49) {
+			return nx % 50 == 0 ? yy == ny : xx != nx;
+		} else if (yy % 50 == 0) {
+			return ny % 50 == 49 ? xx == nx : yy != ny;
+		} else if (yy % 50 == 49) {
+			return ny % 50 == 0 ? xx == nx : yy != ny;
+		}
+		return true;
+	}
+
+	// Exact cost from (ox, oy) to the nearest tile within `range` of (gx, gy), plain cost 1
+	int reference_cost(int ox, int oy, int gx, int gy, int range) {
+		std::vector<int> distance(k_tiles * k_tiles, k_unreached);
+		using entry_t = std::pair<int, int>;
+		std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> open;
+		distance[ox * k_tiles + oy] = 0;
+		open.emplace(0, ox * k_tiles + oy);
+		while (!open.empty()) {
+			auto [cost, index] = open.top();
+			open.pop();
+			if (cost != distance[index]) {
+				continue;
+			}
+			int xx = index / k_tiles;
+			int yy = index % k_tiles;
+			if (std::max(std::abs(xx - gx), std::abs(yy - gy)) <= range) {
+				return cost;
+			}
+			for (int dx = -1; dx <= 1; ++dx) {
+				for (int dy = -1; dy <= 1; ++dy) {
+					int nx = xx + dx;
+					int ny = yy + dy;
+					if ((dx == 0 && dy == 0) || is_wall(nx, ny) || !can_move(xx, yy, nx, ny)) {
+						continue;
+					}
+					int next = nx * k_tiles + ny;
+					if (cost + 1 < distance[next]) {
+						distance[next] = cost + 1;
+						open.emplace(cost + 1, next);
+					}
+				}
+			}
+		}
+		return k_unreached;
+	}
+
+	// Walks the path from the origin (it is stored end first) and returns its cost, or -1 when a step is
+	// not a legal move onto a walkable tile
+	int walk_path(const ScreepsPathfinderResultNative& result, int ox, int oy) {
+		int xx = ox;
+		int yy = oy;
+		for (int step = result.pathLength - 1; step >= 0; --step) {
+			int nx = 0;
+			int ny = 0;
+			if (!from_point(result.path[step], nx, ny) || std::max(std::abs(nx - xx), std::abs(ny - yy)) != 1 ||
+				is_wall(nx, ny) || !can_move(xx, yy, nx, ny)) {
+				return -1;
+			}
+			xx = nx;
+			yy = ny;
+		}
+		return result.pathLength;
+	}
+
+	void generate_terrain(std::mt19937& rng) {
+		for (int xx = 0; xx < k_tiles; ++xx) {
+			for (int yy = 0; yy < k_tiles; ++yy) {
+				int lx = xx % 50;
+				int ly = yy % 50;
+				bool edge = lx == 0 || ly == 0 || lx == 49 || ly == 49;
+				bool world_edge = xx == 0 || yy == 0 || xx == k_tiles - 1 || yy == k_tiles - 1;
+				bool wall = rng() % 100 < 22;
+				if (edge) {
+					// Isolated exits, lined up with the neighbouring room's
+					int along = lx == 0 || lx == 49 ? ly : lx;
+					wall = world_edge || along % 6 != 3;
+				} else if (lx % 12 == 6 && ly > 8 && ly < 42) {
+					// Long walls the search has to find its way around
+					wall = true;
+				}
+				walls[xx * k_tiles + yy] = wall;
+			}
+		}
+	}
+
+	bool load_world(ScreepsWorld* world) {
+		std::vector<std::vector<uint8_t>> bits;
+		std::vector<std::string> names;
+		for (int rx = 0; rx < k_rooms; ++rx) {
+			for (int ry = 0; ry < k_rooms; ++ry) {
+				std::vector<uint8_t> room(625, 0);
+				for (int ii = 0; ii < 2500; ++ii) {
+					if (walls[(rx * 50 + ii / 50) * k_tiles + ry * 50 + ii % 50]) {
+						room[ii / 4] |= 1 << (ii % 4 * 2);
+					}
+				}
+				bits.push_back(std::move(room));
+				names.push_back(room_name(rx, ry));
+			}
+		}
+		std::vector<ScreepsTerrainRoom> rooms;
+		for (size_t ii = 0; ii < bits.size(); ++ii) {
+			rooms.push_back(ScreepsTerrainRoom{names[ii].c_str(), bits[ii].data(), static_cast<int>(bits[ii].size())});
+		}
+		return ScreepsPathfinder_LoadTerrain(world, rooms.data(), static_cast<int>(rooms.size())) == 0;
+	}
+
+	void random_open_tile(std::mt19937& rng, int& xx, int& yy) {
+		do {
+			xx = static_cast<int>(rng() % k_tiles);
+			yy = static_cast<int>(rng() % k_tiles);
+		} while (is_wall(xx, yy) || xx % 50 == 0 || yy % 50 == 0 || xx % 50 == 49 || yy % 50 == 49);
+	}
+}
+
+int main() {
+	std::mt19937 rng(46);
+	generate_terrain(rng);
+	ScreepsWorld* world = ScreepsPathfinder_CreateWorld();
+	if (world == nullptr || !load_world(world)) {
+		std::fprintf(stderr, "could not load the test world\n");
+		return 1;
+	}
+
+	const int thread_counts[] = {2, 4};
+	const double weights[] = {1.0, 1.2};
+	int searches = 0;
+	for (int request = 0; request < 40; ++request) {
+		int ox = 0;
+		int oy = 0;
+		int gx = 0;
+		int gy = 0;
+		random_open_tile(rng, ox, oy);
+		random_open_tile(rng, gx, gy);
+		int range = request % 2;
+		int optimum = reference_cost(ox, oy, gx, gy, range);
+
+		ScreepsPathfinderPoint origin{};
+		ScreepsPathfinderPoint target{};
+		to_point(ox, oy, origin);
+		to_point(gx, gy, target);
+		ScreepsPathfinderGoal goal{target.x, target.y, target.roomName, range};
+
+		for (double weight : weights) {
+			ScreepsPathfinderOptionsNative options{};
+			options.maxRooms = 16;
+			options.maxOps = 1000000;
+			options.maxCost = std::numeric_limits<int>::max();
+			options.plainCost = 1;
+			options.swampCost = 5;
+			options.heuristicWeight = weight;
+			options.skipRoomCallback = true;
+
+			ScreepsPathfinderResultNative sequential{};
+			check(ScreepsPathfinder_Search(world, &origin, &goal, 1, &options, &sequential) == 0, "sequential search", request);
+			check(sequential.incomplete == (optimum == k_unreached), "sequential search reaches exactly the reachable goals", request);
+			check(weight != 1.0 || sequential.incomplete || sequential.cost == optimum, "sequential search is exact at weight 1", request);
+
+			for (int threads : thread_counts) {
+				options.parallelThreads = threads;
+				ScreepsPathfinderResultNative parallel{};
+				check(ScreepsPathfinder_Search(world, &origin, &goal, 1, &options, &parallel) == 0, "parallel search", request);
+				check(parallel.incomplete == sequential.incomplete, "parallel search reaches the goal when the sequential one does", request);
+				check(walk_path(parallel, ox, oy) == parallel.cost, "parallel path leads back to the origin and costs what it reports", request);
+				if (!parallel.incomplete) {
+					int ex = 0;
+					int ey = 0;
+					check(parallel.pathLength > 0 && from_point(parallel.path[0], ex, ey) && std::max(std::abs(ex - gx), std::abs(ey - gy)) <= range,
+						"parallel path ends at the goal", request);
+					check(parallel.cost <= optimum * weight, "parallel cost within the weight of the optimum", request);
+					check(weight != 1.0 || parallel.cost == sequential.cost, "parallel cost matches the sequential cost at weight 1", request);
+				}
+				ScreepsPathfinder_FreeResult(world, &parallel);
+				++searches;
+			}
+			ScreepsPathfinder_FreeResult(world, &sequential);
+		}
+	}
+
+	ScreepsPathfinder_DestroyWorld(world);
+	std::printf("parallel search: %d searches, %d failures\n", searches, failures);
+	return failures == 0 ? 0 : 1;
+}
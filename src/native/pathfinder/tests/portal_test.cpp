@@ -0,0 +1,205 @@
+// Searches across portals through the C ABI: a path that takes a portal must hop from its source straight
+// to its destination, cost less than walking and expand from waypoints to the same tiles, and once
+// ExpirePortals drops a portal no path may hop through it any more. Permanent portals outlive every expiry.
+//
+// The world is a column of three plain rooms, W0N0 to W0N2, walled off from the rooms around it; both
+// portals lead from W0N0 to W0N2.
+#include "pathfinder_exports.h"
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* what) {
+		if (!condition) {
+			std::fprintf(stderr, "FAILED: %s\n", what);
+			++failures;
+		}
+	}
+
+	ScreepsPathfinderPoint point(int x, int y, const char* room) {
+		ScreepsPathfinderPoint result{};
+		result.x = x;
+		result.y = y;
+		std::snprintf(result.roomName, sizeof(result.roomName), "%s", room);
+		return result;
+	}
+
+	bool same(const ScreepsPathfinderPoint& left, const ScreepsPathfinderPoint& right) {
+		return left.x == right.x && left.y == right.y && std::string(left.roomName) == right.roomName;
+	}
+
+	// Tile coordinates in the column, W0N0 at the bottom
+	bool column_position(const ScreepsPathfinderPoint& pos, int& xx, int& yy) {
+		int north = 0;
+		if (std::sscanf(pos.roomName, "W0N%d", &north) != 1 || north < 0 || north > 2) {
+			return false;
+		}
+		xx = pos.x;
+		yy = (2 - north) * 50 + pos.y;
+		return true;
+	}
+
+	// Walks the path from the origin (it is stored end first). Returns its cost, or -1 when a step is
+	// neither a move to a neighbouring tile nor a hop through one of `portals`. `hops` counts hops
+	// through each portal.
+	int walk_path(const ScreepsPathfinderResultNative& result, const ScreepsPathfinderPoint& origin,
+		const std::vector<ScreepsPortalNative>& portals, std::vector<int>& hops) {
+		hops.assign(portals.size(), 0);
+		ScreepsPathfinderPoint previous = origin;
+		int cost = 0;
+		for (int step = result.pathLength - 1; step >= 0; --step) {
+			const ScreepsPathfinderPoint& pos = result.path[step];
+			bool hopped = false;
+			for (size_t ii = 0; ii < portals.size(); ++ii) {
+				if (same(previous, portals[ii].source) && same(pos, portals[ii].destination)) {
+					++hops[ii];
+					hopped = true;
+				}
+			}
+			if (!hopped) {
+				int px = 0;
+				int py = 0;
+				int xx = 0;
+				int yy = 0;
+				if (!column_position(previous, px, py) || !column_position(pos, xx, yy) ||
+					std::max(std::abs(xx - px), std::abs(yy - py)) != 1) {
+					return -1;
+				}
+				++cost;
+			}
+			previous = pos;
+		}
+		return cost;
+	}
+
+	bool load_world(ScreepsWorld* world) {
+		const char* names[] = {"W0N0", "W0N1", "W0N2"};
+		std::vector<std::vector<uint8_t>> bits(3, std::vector<uint8_t>(625, 0));
+		for (int room = 0; room < 3; ++room) {
+			for (int ii = 0; ii < 2500; ++ii) {
+				int x = ii / 50;
+				int y = ii % 50;
+				// Open only towards the neighbours in the column
+				if (x == 0 || x == 49 || (y == 49 && room == 0) || (y == 0 && room == 2)) {
+					bits[room][ii / 4] |= 1 << (ii % 4 * 2);
+				}
+			}
+		}
+		std::vector<ScreepsTerrainRoom> rooms;
+		for (int room = 0; room < 3; ++room) {
+			rooms.push_back(ScreepsTerrainRoom{names[room], bits[room].data(), static_cast<int>(bits[room].size())});
+		}
+		return ScreepsPathfinder_LoadTerrain(world, rooms.data(), static_cast<int>(rooms.size())) == 0;
+	}
+
+	// Searches with full and waypoint-only results, checks the waypoints expand to the full path, and
+	// returns the full path's cost as walked (-1 when broken) along with its hops
+	int search(ScreepsWorld* world, const ScreepsPathfinderPoint& origin, const ScreepsPathfinderPoint& target,
+		const std::vector<ScreepsPortalNative>& portals, std::vector<int>& hops, const char* what) {
+		ScreepsPathfinderGoal goal{target.x, target.y, target.roomName, 0};
+		ScreepsPathfinderOptionsNative options{};
+		options.maxRooms = 16;
+		options.maxOps = 100000;
+		options.maxCost = std::numeric_limits<int>::max();
+		options.plainCost = 1;
+		options.swampCost = 5;
+		options.heuristicWeight = 1.0;
+		options.skipRoomCallback = true;
+
+		hops.assign(portals.size(), 0);
+		ScreepsPathfinderResultNative full{};
+		int code = ScreepsPathfinder_Search(world, &origin, &goal, 1, &options, &full);
+		if (code != 0 || full.incomplete) {
+			std::fprintf(stderr, "FAILED: %s: search did not reach the goal (%d)\n", what, code);
+			++failures;
+			return -1;
+		}
+		int cost = walk_path(full, origin, portals, hops);
+		if (cost != full.cost) {
+			std::fprintf(stderr, "FAILED: %s: path walks for %d but reports %d\n", what, cost, full.cost);
+			++failures;
+		}
+		if (full.pathLength == 0 || !same(full.path[0], target)) {
+			std::fprintf(stderr, "FAILED: %s: path does not end at the goal\n", what);
+			++failures;
+		}
+
+		options.waypointsOnly = true;
+		ScreepsPathfinderResultNative sparse{};
+		if (ScreepsPathfinder_Search(world, &origin, &goal, 1, &options, &sparse) == 0) {
+			int count = ScreepsPathfinder_PathTileCount(world, &origin, sparse.path, sparse.pathLength);
+			std::vector<ScreepsPathfinderPoint> tiles(count > 0 ? count : 0);
+			int written = ScreepsPathfinder_ExpandPath(world, &origin, sparse.path, sparse.pathLength, 0, tiles.data(), static_cast<int>(tiles.size()));
+			bool matches = count == full.pathLength && written == count;
+			for (int ii = 0; matches && ii < count; ++ii) {
+				matches = same(tiles[ii], full.path[ii]);
+			}
+			if (!matches) {
+				std::fprintf(stderr, "FAILED: %s: waypoints expand to %d tiles, not the %d of the full path\n", what, written, full.pathLength);
+				++failures;
+			}
+			ScreepsPathfinder_FreeResult(world, &sparse);
+		} else {
+			std::fprintf(stderr, "FAILED: %s: waypoint search\n", what);
+			++failures;
+		}
+		ScreepsPathfinder_FreeResult(world, &full);
+		return cost;
+	}
+}
+
+int main() {
+	ScreepsWorld* world = ScreepsPathfinder_CreateWorld();
+	if (world == nullptr || !load_world(world)) {
+		std::fprintf(stderr, "could not load the test world\n");
+		return 1;
+	}
+
+	const ScreepsPathfinderPoint origin = point(12, 25, "W0N0");
+	const ScreepsPathfinderPoint target = point(12, 25, "W0N2");
+	std::vector<ScreepsPortalNative> portals{
+		// Next to both ends, gone at tick 50
+		ScreepsPortalNative{point(10, 25, "W0N0"), point(10, 25, "W0N2"), 50},
+		// Further off, permanent
+		ScreepsPortalNative{point(40, 25, "W0N0"), point(40, 25, "W0N2"), 0},
+	};
+	std::vector<int> hops;
+
+	int walking = search(world, origin, target, portals, hops, "walking");
+	check(walking == 100, "walking takes the straight line through W0N1");
+	check(hops[0] == 0 && hops[1] == 0, "no hops before portals are loaded");
+
+	check(ScreepsPathfinder_LoadPortals(world, portals.data(), static_cast<int>(portals.size())) == 0, "load portals");
+	int through = search(world, origin, target, portals, hops, "near portal");
+	check(hops[0] == 1 && hops[1] == 0, "path hops through the near portal");
+	check(through == 4, "near portal path costs the walk to and from its ends");
+	check(through < walking, "near portal path is cheaper than walking");
+
+	// An expiry before the near portal's tick keeps it
+	check(ScreepsPathfinder_ExpirePortals(world, 49) == 0, "expire at tick 49");
+	search(world, origin, target, portals, hops, "before expiry");
+	check(hops[0] == 1, "near portal survives an earlier expiry");
+
+	check(ScreepsPathfinder_ExpirePortals(world, 50) == 0, "expire at tick 50");
+	int permanent = search(world, origin, target, portals, hops, "after expiry");
+	check(hops[0] == 0, "no path hops through an expired portal");
+	check(hops[1] == 1, "path hops through the permanent portal");
+	check(permanent == 56, "permanent portal path costs the walk to and from its ends");
+
+	check(ScreepsPathfinder_ExpirePortals(world, 1000000) == 0, "expire far ahead");
+	search(world, origin, target, portals, hops, "late expiry");
+	check(hops[1] == 1, "permanent portal survives every expiry");
+
+	check(ScreepsPathfinder_LoadPortals(world, nullptr, 0) == 0, "clear portals");
+	int cleared = search(world, origin, target, portals, hops, "cleared");
+	check(hops[0] == 0 && hops[1] == 0 && cleared == walking, "clearing the table brings back walking");
+
+	ScreepsPathfinder_DestroyWorld(world);
+	std::printf("portals: %d failures\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+// Saves the precompute cache over an existing file, which std::rename refused to do on Windows, and
+// checks that the file round-trips and no temporary is left behind.
+#include "precompute_cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+using namespace screeps;
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* what) {
+		if (!condition) {
+			std::fprintf(stderr, "FAILED: %s\n", what);
+			++failures;
+		}
+	}
+}
+
+int main() {
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "screeps_precompute_cache_test.bin";
+	std::string name = path.string();
+	std::string temporary = name + ".tmp";
+	std::filesystem::remove(path);
+
+	uint8_t plain[precompute_cache_t::k_terrain_bytes] = {};
+	uint8_t walled[precompute_cache_t::k_terrain_bytes] = {};
+	walled[0] = 0x55;
+	const uint16_t first[4] = {1, 2, 3, 4};
+	const uint16_t second[4] = {5, 6, 7, 8};
+	constexpr auto kind = precompute_cache_t::table_kind::Landmarks;
+
+	precompute_cache_t cache;
+	cache.store(plain, kind, 2, first, sizeof(first));
+	check(cache.save(name.c_str()), "first save");
+	check(!std::filesystem::exists(temporary), "first save leaves no temporary");
+
+	// The second save replaces the file written by the first
+	cache.store(plain, kind, 2, second, sizeof(second));
+	cache.store(walled, kind, 2, first, sizeof(first));
+	check(cache.save(name.c_str()), "second save over an existing file");
+	check(!std::filesystem::exists(temporary), "second save leaves no temporary");
+
+	precompute_cache_t loaded;
+	check(loaded.load(name.c_str()), "load after the second save");
+	check(loaded.entry_count() == 2, "both entries of the second save are read back");
+	const uint8_t* payload = loaded.find(plain, kind, 2, sizeof(second));
+	check(payload != nullptr && std::equal(payload, payload + sizeof(second), reinterpret_cast<const uint8_t*>(second)), "the second save's payload wins");
+	check(loaded.find(walled, kind, 2, sizeof(first)) != nullptr, "entry added by the second save");
+
+	// Saving again from the loaded cache keeps only what it used
+	check(loaded.save(name.c_str()), "third save from a loaded cache");
+	check(loaded.load(name.c_str()) && loaded.entry_count() == 2, "third save round-trips");
+
+	std::filesystem::remove(path);
+	std::printf("precompute cache: %d failures\n", failures);
+	return failures == 0 ? 0 : 1;
+}
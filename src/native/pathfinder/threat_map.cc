@@ -0,0 +1,119 @@
+#include "threat_map.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace screeps;
+
+namespace {
+	// Summed-area table with one spare row and column, so a square reaching the far edge still has
+	// somewhere to cancel
+	constexpr unsigned k_stride = 51;
+
+	void add_square(uint32_t* table, int xx, int yy, int range, uint32_t value) {
+		unsigned x0 = std::max(xx - range, 0);
+		unsigned y0 = std::max(yy - range, 0);
+		unsigned x1 = std::min(xx + range, 49) + 1;
+		unsigned y1 = std::min(yy + range, 49) + 1;
+		// Unsigned wraparound cancels out once the table is summed
+		table[x0 * k_stride + y0] += value;
+		table[x0 * k_stride + y1] -= value;
+		table[x1 * k_stride + y0] -= value;
+		table[x1 * k_stride + y1] += value;
+	}
+}
+
+	uint32_t threat_map_t::tower_damage(uint32_t strength, unsigned range) {
+		range = std::clamp(range, k_tower_optimal_range, k_tower_falloff_range);
+		// The game takes off 75% of the damage linearly between the optimal and the falloff range
+		constexpr unsigned span = k_tower_falloff_range - k_tower_optimal_range;
+		return strength * (4 * span - 3 * (range - k_tower_optimal_range)) / (4 * span);
+	}
+
+	void threat_map_t::accumulate(const threat_source_t* sources, size_t count, uint32_t* threat) {
+		uint32_t table[k_stride * k_stride];
+		std::memset(table, 0, sizeof(table));
+		for (size_t ii = 0; ii < count; ++ii) {
+			const threat_source_t& source = sources[ii];
+			if (source.xx >= 50 || source.yy >= 50) {
+				continue;
+			}
+			switch (source.kind) {
+				case threat_kind::Tower: {
+					// Nested squares: the falloff floor everywhere, plus each step's drop inside its range
+					uint32_t previous = tower_damage(source.strength, k_tower_falloff_range);
+					add_square(table, source.xx, source.yy, 49, previous);
+					for (unsigned range = k_tower_falloff_range - 1; range >= k_tower_optimal_range; --range) {
+						uint32_t damage = tower_damage(source.strength, range);
+						if (damage != previous) {
+							add_square(table, source.xx, source.yy, range, damage - previous);
+							previous = damage;
+						}
+					}
+					break;
+				}
+				case threat_kind::Melee:
+					add_square(table, source.xx, source.yy, 1 + source.reach, source.strength);
+					break;
+				case threat_kind::Ranged:
+					add_square(table, source.xx, source.yy, 3 + source.reach, source.strength);
+					break;
+			}
+		}
+
+		// Columns first, a whole row of y at a time, then the running sum down each row
+		for (unsigned xx = 1; xx < 50; ++xx) {
+			uint32_t* row = table + xx * k_stride;
+			const uint32_t* above = row - k_stride;
+			for (unsigned yy = 0; yy < 50; ++yy) {
+				row[yy] += above[yy];
+			}
+		}
+		for (unsigned xx = 0; xx < 50; ++xx) {
+			const uint32_t* row = table + xx * k_stride;
+			uint32_t sum = 0;
+			for (unsigned yy = 0; yy < 50; ++yy) {
+				sum += row[yy];
+				threat[xx * 50 + yy] = sum;
+			}
+		}
+	}
+
+	void threat_map_t::build(
+		const threat_source_t* sources,
+		size_t count,
+		const threat_profile_t& profile,
+		const uint8_t* terrain,
+		const uint8_t* base,
+		uint8_t* out
+	) {
+		uint32_t threat[k_tiles];
+		accumulate(sources, count, threat);
+		if (base == nullptr) {
+			std::memset(out, 0, k_tiles);
+		} else if (base != out) {
+			std::memcpy(out, base, k_tiles);
+		}
+
+		// Cost under the threat per terrain code; 0 marks walls, which stay walls
+		const uint8_t terrain_cost[4] = {profile.plain_cost, 0, profile.swamp_cost, 0};
+		uint32_t per_cost = std::max<uint32_t>(profile.threat_per_cost, 1);
+		for (unsigned tile = 0; tile < k_tiles; ++tile) {
+			uint32_t amount = threat[tile];
+			uint8_t value = out[tile];
+			if (amount == 0 || value == k_blocked) {
+				continue;
+			}
+			unsigned under = value != 0 ? value : terrain_cost[0x03 & terrain[tile / 4] >> (tile % 4 * 2)];
+			if (under == 0) {
+				continue;
+			}
+			if (profile.block_threshold != 0 && amount >= profile.block_threshold) {
+				out[tile] = k_blocked;
+				continue;
+			}
+			unsigned added = std::min<uint32_t>(amount / per_cost, k_blocked);
+			if (added != 0) {
+				out[tile] = static_cast<uint8_t>(std::max<unsigned>(under, std::min<unsigned>(under + added, profile.max_cost)));
+			}
+		}
+	}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace screeps {
+
+	enum class threat_kind : uint8_t {
+		Tower = 0, // whole room, full strength up to range 5 and falling to a quarter at range 20
+		Melee, // attack: range 1
+		Ranged // ranged attack: range 3
+	};
+
+	// One hostile to fold into a threat map. Tiles are local to the room; `reach` widens the range of
+	// creeps by the tiles they can move before they strike and is ignored for towers.
+	struct threat_source_t {
+		uint8_t xx;
+		uint8_t yy;
+		threat_kind kind;
+		uint8_t reach;
+		uint16_t strength; // damage per tick at full strength
+	};
+
+	//
+	// How accumulated threat turns into matrix values. A threatened tile costs what it cost before
+	// (the base matrix value, else plain_cost / swamp_cost) plus one per `threat_per_cost` damage, up
+	// to `max_cost`. Threat at or above `block_threshold` blocks the tile; 0 never blocks.
+	struct threat_profile_t {
+		uint8_t plain_cost = 1;
+		uint8_t swamp_cost = 5;
+		uint8_t max_cost = 200;
+		uint16_t threat_per_cost = 60;
+		uint32_t block_threshold = 0;
+	};
+
+	//
+	// Builds threat maps and threat-weighted cost matrices ([x * 50 + y], the layout look() reads) from
+	// lists of hostile towers and creeps. Every source adds its strength over squares of Chebyshev
+	// range: a creep is one square, a tower one square per falloff step plus the whole room. Squares are
+	// four corner writes into a summed-area table, so a source costs O(1) per step rather than O(tiles),
+	// and the table is summed once in column-wide passes the compiler vectorizes.
+	class threat_map_t {
+		public:
+			static constexpr size_t k_tiles = 2500;
+			static constexpr uint8_t k_blocked = 255;
+			static constexpr unsigned k_tower_optimal_range = 5;
+			static constexpr unsigned k_tower_falloff_range = 20;
+
+			// Damage a tower of `strength` deals at Chebyshev range `range`, rounded down like the game
+			static uint32_t tower_damage(uint32_t strength, unsigned range);
+
+			// Writes the summed damage of `sources` per tile into `threat`. Sources outside the room or of
+			// an unknown kind are skipped.
+			static void accumulate(const threat_source_t* sources, size_t count, uint32_t* threat);
+
+			// Writes `base` (zeros when nullptr) with the threat of `sources` priced in by `profile` into
+			// `out`. `terrain` is the room's packed terrain; walls the base leaves at 0 stay walls. `base`
+			// may be `out` to update a matrix in place.
+			static void build(
+				const threat_source_t* sources,
+				size_t count,
+				const threat_profile_t& profile,
+				const uint8_t* terrain,
+				const uint8_t* base,
+				uint8_t* out);
+	};
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifndef SCREEPS_PATHFINDER_TRACE
+#define SCREEPS_PATHFINDER_TRACE 0
+#endif
+#ifndef SCREEPS_PATHFINDER_TRACE_CAPACITY
+#define SCREEPS_PATHFINDER_TRACE_CAPACITY (1 << 18)
+#endif
+
+namespace screeps {
+
+	enum class trace_event_kind : uint8_t {
+		Push = 1, // node opened; cost is f
+		Update, // open node re-parented with a lower f
+		Close, // node popped and expanded; cost is f
+		JumpStart, // jump scan leaving a neighbour; cost is the tile cost being followed
+		JumpEnd, // where the scan stopped; cost is g there, or UINT32_MAX when it ran into an obstacle
+		RoomLoad // room coordinates instead of a tile; cost is the room slot, UINT32_MAX when blocked
+	};
+
+	struct trace_event_t {
+		uint16_t xx;
+		uint16_t yy;
+		uint32_t cost;
+		trace_event_kind kind;
+	};
+
+	//
+	// Fixed-size ring of search events, compiled in with SCREEPS_PATHFINDER_TRACE. Recording is a
+	// single store into preallocated storage; once the ring is full the oldest events are overwritten
+	// and counted as dropped.
+	//
+	// Dump format, little-endian:
+	//   header  "PFTR", u16 version (1), u16 event size (12), u32 event count, u32 dropped events
+	//   events  u16 x, u16 y (world tile coordinates), u32 cost, u8 kind, 3 bytes padding; oldest first
+	class trace_ring_t {
+		public:
+			static constexpr size_t k_capacity = SCREEPS_PATHFINDER_TRACE_CAPACITY;
+			static constexpr size_t k_header_bytes = 16;
+			static constexpr size_t k_event_bytes = 12;
+			static_assert((k_capacity & (k_capacity - 1)) == 0, "trace capacity must be a power of two");
+
+			trace_ring_t() : events(new trace_event_t[k_capacity]) {}
+
+			void record(trace_event_kind kind, uint32_t xx, uint32_t yy, uint32_t cost) {
+				events[recorded++ & (k_capacity - 1)] = trace_event_t{static_cast<uint16_t>(xx), static_cast<uint16_t>(yy), cost, kind};
+			}
+
+			void clear() {
+				recorded = 0;
+			}
+
+			size_t size() const {
+				return recorded < k_capacity ? static_cast<size_t>(recorded) : k_capacity;
+			}
+
+			uint64_t dropped() const {
+				return recorded - size();
+			}
+
+			size_t dump_size() const {
+				return k_header_bytes + size() * k_event_bytes;
+			}
+
+			// Writes the dump and returns its length, or 0 when `capacity` is below dump_size()
+			size_t dump(uint8_t* out, size_t capacity) const {
+				if (capacity < dump_size()) {
+					return 0;
+				}
+				uint8_t* cursor = out;
+				*cursor++ = 'P';
+				*cursor++ = 'F';
+				*cursor++ = 'T';
+				*cursor++ = 'R';
+				cursor = put(cursor, 1, 2);
+				cursor = put(cursor, k_event_bytes, 2);
+				cursor = put(cursor, size(), 4);
+				cursor = put(cursor, dropped() > UINT32_MAX ? UINT32_MAX : dropped(), 4);
+				for (uint64_t ii = recorded - size(); ii < recorded; ++ii) {
+					const trace_event_t& event = events[ii & (k_capacity - 1)];
+					cursor = put(cursor, event.xx, 2);
+					cursor = put(cursor, event.yy, 2);
+					cursor = put(cursor, event.cost, 4);
+					cursor = put(cursor, static_cast<uint8_t>(event.kind), 4);
+				}
+				return static_cast<size_t>(cursor - out);
+			}
+
+		private:
+			std::unique_ptr<trace_event_t[]> events;
+			uint64_t recorded = 0;
+
+			static uint8_t* put(uint8_t* out, uint64_t value, size_t bytes) {
+				for (size_t ii = 0; ii < bytes; ++ii) {
+					out[ii] = static_cast<uint8_t>(value >> (ii * 8));
+				}
+				return out + bytes;
+			}
+	};
+}